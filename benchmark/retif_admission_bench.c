@@ -0,0 +1,750 @@
+/**
+ * @file retif_admission_bench.c
+ * @brief Measures the CPU cost of the admission control, without the daemon
+ *
+ * The benchmark links the scheduler of the daemon and loads its plugins in
+ * process, so it needs neither root privileges nor the daemon socket. The
+ * plugins use the simulated kernel backend, which only records the policies
+ * in memory, so no thread is ever moved to a real-time scheduling class.
+ *
+ * For each point of the sweep (resident tasks, CPUs per plugin and number of
+ * plugins) the scheduler is initialized from scratch and filled with the
+ * resident tasks. Then a reservation is repeatedly created, attached,
+ * detached and destroyed on top of them, measuring each operation with the
+ * monotonic clock. Finally, the resident tasks are removed and batches of
+ * random tasks are offered to the empty plugins until a given load, counting
+ * how many of them are accepted: the sweep can be repeated for each placement
+ * heuristic and schedulability test, to compare how densely they pack the
+ * tasks and at which cost. The results are printed in JSON format.
+ */
+
+#define _GNU_SOURCE
+
+#include "logger.h"
+#include "retif_config.h"
+#include "retif_kernel.h"
+#include "retif_plugin.h"
+#include "retif_scheduler.h"
+#include "retif_task.h"
+#include "retif_taskset.h"
+#include "vector.h"
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_POINTS 16
+#define MAX_KINDS 8
+
+#define DEF_TASKS "0,100,1000,10000"
+#define DEF_CPUS "1,4,16"
+#define DEF_PLUGINS "1,2,4"
+#define DEF_KINDS "EDF,FP,RM,RR"
+#define DEF_ITERATIONS 1000000
+#define DEF_FILL 0.5
+#define DEF_PERIOD_MIN 10000
+#define DEF_PERIOD_MAX 100000
+#define DEF_SEED 1
+#define DEF_PLACEMENTS "worst-fit"
+#define DEF_ADMISSIONS "both"
+#define DEF_DEADLINE 1.0
+#define DEF_LOAD 1.0
+#define DEF_UTIL_MIN 0.05 // utilization of the offered tasks
+#define DEF_UTIL_MAX 0.6
+
+#define MAX_CPUS 256 // CPUs of the simulated system
+#define OFFERED_BATCH 16 // tasks offered with each batch
+#define RESIDENT_PID 1000 // owner of the resident tasks
+#define MEASURED_PID 2000 // owner of the measured task
+#define OFFERED_PID 3000 // owner of the tasks offered for acceptance
+
+// symbols required by the daemon sources
+struct LOGGER logger;
+char *conf_file_path = NULL;
+
+enum OPERATION
+{
+    OP_CREATE,
+    OP_ATTACH,
+    OP_DETACH,
+    OP_DESTROY,
+    OP_NUM
+};
+
+static const char *op_names[OP_NUM] = {"create", "attach", "detach",
+    "destroy"};
+
+// comma-separated list of integers, the values of a sweep
+struct sweep
+{
+    int v[MAX_POINTS];
+    int n;
+};
+
+struct bench_conf
+{
+    struct sweep ntask; // resident tasks
+    struct sweep ncpu; // CPUs of each plugin
+    struct sweep nplugin; // plugins
+    char *kinds[MAX_KINDS]; // plugins, cycled over the plugins of a point
+    int nkind;
+    char *placements[MAX_KINDS]; // placement heuristics, one sweep each
+    int nplacement;
+    char *admissions[MAX_KINDS]; // schedulability tests, one sweep each
+    int nadmission;
+    double deadline; // minimum ratio between deadline and period
+    double load; // utilization offered for acceptance over the capacity
+    int iterations; // reservations created and destroyed for each point
+    double fill; // utilization of the resident tasks over the capacity
+    unsigned int seed;
+    char *dir; // directory of the plugins
+    char *output; // file name, NULL for standard output
+};
+
+struct acceptance
+{
+    int offered; // tasks offered
+    int accepted; // tasks accepted
+    double offered_util; // utilization offered
+    double accepted_util; // utilization accepted
+};
+
+struct samples
+{
+    uint64_t *lat; // latencies [nanoseconds]
+    size_t n; // number of latencies
+    uint64_t failed; // operations that did not succeed
+    uint64_t busy; // sum of latencies [nanoseconds]
+};
+
+// -----------------------------------------------------------------------------
+// UTILS
+// -----------------------------------------------------------------------------
+
+static uint64_t bench_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_record(struct samples *s, uint64_t start, int failed)
+{
+    uint64_t lat = bench_now() - start;
+
+    s->lat[s->n++] = lat;
+    s->busy += lat;
+    s->failed += failed;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted samples
+static uint64_t bench_percentile(struct samples *s, double pct)
+{
+    double pos = pct / 100.0 * s->n;
+    size_t rank = (size_t) pos;
+
+    if (s->n == 0)
+        return 0;
+
+    if (rank < pos || rank == 0)
+        rank++;
+
+    return s->lat[(rank > s->n ? s->n : rank) - 1];
+}
+
+// random parameters with the given utilization, the deadline is drawn between
+// the given ratio of the period and the period
+static void bench_params(struct rtf_params *p, double util, double deadline,
+    unsigned int *seed)
+{
+    uint64_t period = DEF_PERIOD_MIN +
+                      rand_r(seed) % (DEF_PERIOD_MAX - DEF_PERIOD_MIN + 1);
+    double ratio = deadline + (1 - deadline) * rand_r(seed) / RAND_MAX;
+
+    memset(p, 0, sizeof(struct rtf_params));
+    p->period = period;
+    p->deadline = period * ratio;
+    p->runtime = period * util < 1 ? 1 : period * util;
+    p->priority = 1 + rand_r(seed) % 98;
+}
+
+// -----------------------------------------------------------------------------
+// SCHEDULER SETUP
+// -----------------------------------------------------------------------------
+
+static int bench_conf_plugins(struct bench_conf *bc, configuration_t *conf,
+    int nplugin, int ncpu, const char *placement, const char *admission)
+{
+    conf_plugin_t plg;
+    char *kind;
+
+    memset(conf, 0, sizeof(configuration_t));
+    vector_initialize((vector_t *) &conf->plugins, VECTOR_ISIZE(conf->plugins));
+
+    // the procfs limit is not enforced, nothing is scheduled for real
+    conf->system.sched_max_util = 0;
+
+    for (int i = 0; i < nplugin; i++)
+    {
+        kind = bc->kinds[i % bc->nkind];
+
+        memset(&plg, 0, sizeof(conf_plugin_t));
+        plg.name = strdup(kind);
+        plg.priority_min = 1;
+        plg.priority_max = 99;
+        parse_placement(placement, &plg);
+        parse_admission(admission, &plg);
+
+        if (asprintf(&plg.plugin_path, "%s/sched_%s.so", bc->dir, kind) < 0)
+            return -1;
+
+        vector_initialize((vector_t *) &plg.cores, VECTOR_ISIZE(plg.cores));
+
+        // plugins index their per-cpu data by cpu number
+        for (int cpu = 0; cpu < ncpu; cpu++)
+            vector_push_back((vector_t *) &plg.cores, &cpu);
+
+        vector_push_back((vector_t *) &conf->plugins, &plg);
+    }
+
+    return 0;
+}
+
+static void bench_conf_destroy(configuration_t *conf)
+{
+    conf_plugin_t *plg;
+
+    VECTOR_FOREACH (conf->plugins, plg)
+    {
+        free(plg->name);
+        free(plg->plugin_path);
+        free(plg->cgroup);
+        free(plg->cores.data);
+    }
+
+    free(conf->plugins.data);
+}
+
+// -----------------------------------------------------------------------------
+// MEASUREMENT
+// -----------------------------------------------------------------------------
+
+static int bench_fill(struct rtf_scheduler *s, struct bench_conf *bc,
+    int ntask, int ncpu, int nplugin, unsigned int *seed)
+{
+    struct rtf_params p;
+    double util = bc->fill * ncpu * nplugin / (ntask ? ntask : 1);
+    int accepted = 0;
+
+    if (util > bc->fill)
+        util = bc->fill;
+
+    for (int i = 0; i < ntask; i++)
+    {
+        bench_params(&p, util, bc->deadline, seed);
+
+        if (rtf_scheduler_task_create(s, &p, RESIDENT_PID) != RTF_NO)
+            accepted++;
+    }
+
+    return accepted;
+}
+
+static void bench_loop(struct rtf_scheduler *s, struct bench_conf *bc,
+    struct samples *smp, unsigned int *seed)
+{
+    struct rtf_params p;
+    rtf_id_t id;
+    uint64_t start;
+    int res;
+    int ret;
+
+    for (int i = 0; i < bc->iterations; i++)
+    {
+        bench_params(&p, 0.01, bc->deadline, seed);
+
+        start = bench_now();
+        rtf_scheduler_task_create_batch(s, &p, 1, MEASURED_PID, &id, &res);
+        bench_record(&smp[OP_CREATE], start, res == RTF_NO);
+
+        if (res == RTF_NO)
+            continue;
+
+        start = bench_now();
+        ret = rtf_scheduler_task_attach(s, id, getpid());
+        bench_record(&smp[OP_ATTACH], start, ret != RTF_OK);
+
+        start = bench_now();
+        ret = rtf_scheduler_task_detach(s, id);
+        bench_record(&smp[OP_DETACH], start, ret != RTF_OK);
+
+        start = bench_now();
+        ret = rtf_scheduler_task_destroy(s, id);
+        bench_record(&smp[OP_DESTROY], start, ret != RTF_OK);
+    }
+
+    for (int op = 0; op < OP_NUM; op++)
+        qsort(smp[op].lat, smp[op].n, sizeof(uint64_t), bench_cmp);
+}
+
+// offers batches of random tasks to the empty plugins until the load
+static void bench_accept(struct rtf_scheduler *s, struct bench_conf *bc,
+    int ncpu, int nplugin, struct acceptance *acc, unsigned int *seed)
+{
+    struct rtf_params p[OFFERED_BATCH];
+    double util[OFFERED_BATCH];
+    rtf_id_t id[OFFERED_BATCH];
+    int res[OFFERED_BATCH];
+    double capacity = bc->load * ncpu * nplugin;
+    int num;
+
+    memset(acc, 0, sizeof(struct acceptance));
+
+    while (acc->offered_util < capacity)
+    {
+        for (num = 0; num < OFFERED_BATCH && acc->offered_util < capacity;
+             num++)
+        {
+            util[num] = DEF_UTIL_MIN + (DEF_UTIL_MAX - DEF_UTIL_MIN) *
+                                           rand_r(seed) / RAND_MAX;
+            bench_params(&p[num], util[num], bc->deadline, seed);
+            acc->offered_util += util[num];
+        }
+
+        rtf_scheduler_task_create_batch(s, p, num, OFFERED_PID, id, res);
+        acc->offered += num;
+
+        for (int i = 0; i < num; i++)
+        {
+            if (res[i] == RTF_NO)
+                continue;
+
+            acc->accepted++;
+            acc->accepted_util += util[i];
+        }
+    }
+
+    rtf_scheduler_delete(s, OFFERED_PID);
+}
+
+static void bench_print_point(FILE *out, int first, int ntask, int ncpu,
+    int nplugin, const char *placement, const char *admission, int resident,
+    struct samples *smp, struct acceptance *acc)
+{
+    struct samples *s;
+
+    fprintf(out, "%s\n    {\n", first ? "" : ",");
+    fprintf(out, "      \"tasks\": %d,\n      \"resident\": %d,\n", ntask,
+        resident);
+    fprintf(out, "      \"cpus\": %d,\n      \"plugins\": %d,\n", ncpu,
+        nplugin);
+    fprintf(out, "      \"placement\": \"%s\",\n", placement);
+    fprintf(out, "      \"admission\": \"%s\",\n", admission);
+    fprintf(out, "      \"acceptance\": {\n");
+    fprintf(out, "        \"offered\": %d,\n        \"accepted\": %d,\n",
+        acc->offered, acc->accepted);
+    fprintf(out, "        \"ratio\": %.4f,\n",
+        acc->offered ? acc->accepted / (double) acc->offered : 0.0);
+    fprintf(out, "        \"util_ratio\": %.4f\n      },\n",
+        acc->offered_util ? acc->accepted_util / acc->offered_util : 0.0);
+    fprintf(out, "      \"operations\": {");
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        s = &smp[op];
+
+        fprintf(out, "%s\n        \"%s\": {\n", op ? "," : "", op_names[op]);
+        fprintf(out, "          \"count\": %zu,\n", s->n);
+        fprintf(out, "          \"failed\": %lu,\n", s->failed);
+        fprintf(out, "          \"mean_ns\": %.1f,\n",
+            s->n ? s->busy / (double) s->n : 0.0);
+        fprintf(out, "          \"p50_ns\": %lu,\n", bench_percentile(s, 50));
+        fprintf(out, "          \"p99_ns\": %lu,\n", bench_percentile(s, 99));
+        fprintf(out, "          \"max_ns\": %lu\n        }",
+            s->n ? s->lat[s->n - 1] : 0);
+    }
+
+    fprintf(out, "\n      }\n    }");
+}
+
+static int bench_point(FILE *out, struct bench_conf *bc, struct rtf_kernel *k,
+    int first, int ntask, int ncpu, int nplugin, const char *placement,
+    const char *admission, struct samples *smp)
+{
+    struct acceptance acc;
+    configuration_t conf;
+    struct rtf_scheduler s;
+    struct rtf_taskset ts;
+    unsigned int seed = bc->seed;
+    int resident;
+
+    if (bench_conf_plugins(bc, &conf, nplugin, ncpu, placement,
+            admission) < 0)
+        return -1;
+
+    rtf_taskset_init_linked(&ts, TASKSET_LINK_SCHED);
+
+    if (rtf_scheduler_init(&conf, &s, &ts, k) < 0)
+    {
+        bench_conf_destroy(&conf);
+        return -1;
+    }
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        smp[op].n = 0;
+        smp[op].failed = 0;
+        smp[op].busy = 0;
+    }
+
+    resident = bench_fill(&s, bc, ntask, ncpu, nplugin, &seed);
+    bench_loop(&s, bc, smp, &seed);
+    rtf_scheduler_delete(&s, RESIDENT_PID);
+    bench_accept(&s, bc, ncpu, nplugin, &acc, &seed);
+    bench_print_point(out, first, ntask, ncpu, nplugin, placement, admission,
+        resident, smp, &acc);
+
+    rtf_scheduler_destroy(&s);
+    rtf_taskset_destroy(&ts);
+    free(s.plugin);
+    bench_conf_destroy(&conf);
+
+    return 0;
+}
+
+// one point for each number of plugins, CPUs and resident tasks
+static int bench_sweep(FILE *out, struct bench_conf *bc, struct rtf_kernel *k,
+    const char *placement, const char *admission, int *first,
+    struct samples *smp)
+{
+    for (int p = 0; p < bc->nplugin.n; p++)
+    {
+        for (int c = 0; c < bc->ncpu.n; c++)
+        {
+            for (int n = 0; n < bc->ntask.n; n++, *first = 0)
+            {
+                if (bench_point(out, bc, k, *first, bc->ntask.v[n],
+                        bc->ncpu.v[c], bc->nplugin.v[p], placement, admission,
+                        smp) < 0)
+                    return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// COMMAND LINE
+// -----------------------------------------------------------------------------
+
+static void bench_usage(char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -n LIST   resident tasks, comma-separated (default %s)\n"
+        "  -c LIST   CPUs of each plugin, comma-separated, at most %d\n"
+        "            (default %s)\n"
+        "  -k LIST   plugins, comma-separated (default %s)\n"
+        "  -g NAMES  plugins to load, cycled (default %s)\n"
+        "  -p NAMES  placement heuristics, comma-separated, one sweep each\n"
+        "            (default %s)\n"
+        "  -a NAMES  schedulability tests of EDF, comma-separated, one sweep\n"
+        "            each (default %s)\n"
+        "  -l LOAD   utilization offered for acceptance over the capacity\n"
+        "            (default %.2f)\n"
+        "  -r RATIO  minimum deadline over period of the tasks (default %.2f)\n"
+        "  -i NUM    reservations created and destroyed for each point\n"
+        "            (default %d)\n"
+        "  -u FILL   utilization of the resident tasks over the capacity\n"
+        "            (default %.2f)\n"
+        "  -s SEED   seed of the random parameters (default %d)\n"
+        "  -d DIR    directory of the plugins (default %s)\n"
+        "  -o FILE   write the JSON results in FILE (default stdout)\n",
+        name, DEF_TASKS, MAX_CPUS, DEF_CPUS, DEF_PLUGINS, DEF_KINDS,
+        DEF_PLACEMENTS, DEF_ADMISSIONS, DEF_LOAD, DEF_DEADLINE, DEF_ITERATIONS,
+        DEF_FILL, DEF_SEED,
+        RETIF_BENCH_PLUGINS_DIR);
+}
+
+static int bench_parse_list(char *arg, struct sweep *l, int min, int max)
+{
+    char *tok;
+    char *save;
+    char *end;
+    long v;
+
+    l->n = 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        v = strtol(tok, &end, 10);
+
+        if (*end != '\0' || v < min || v > max || l->n == MAX_POINTS)
+            return -1;
+
+        l->v[l->n++] = v;
+    }
+
+    return l->n ? 0 : -1;
+}
+
+static int bench_parse_kinds(char *arg, struct bench_conf *conf)
+{
+    char *tok;
+    char *save;
+
+    conf->nkind = 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        if (conf->nkind == MAX_KINDS)
+            return -1;
+
+        conf->kinds[conf->nkind++] = tok;
+    }
+
+    return conf->nkind ? 0 : -1;
+}
+
+static int bench_parse_placements(char *arg, struct bench_conf *conf)
+{
+    conf_plugin_t plg;
+    char *tok;
+    char *save;
+
+    conf->nplacement = 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        if (conf->nplacement == MAX_KINDS || parse_placement(tok, &plg) < 0)
+            return -1;
+
+        conf->placements[conf->nplacement++] = tok;
+    }
+
+    return conf->nplacement ? 0 : -1;
+}
+
+static int bench_parse_admissions(char *arg, struct bench_conf *conf)
+{
+    conf_plugin_t plg;
+    char *tok;
+    char *save;
+
+    conf->nadmission = 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        if (conf->nadmission == MAX_KINDS || parse_admission(tok, &plg) < 0)
+            return -1;
+
+        conf->admissions[conf->nadmission++] = tok;
+    }
+
+    return conf->nadmission ? 0 : -1;
+}
+
+static int bench_parse(int argc, char *argv[], struct bench_conf *conf)
+{
+    static char ntask[] = DEF_TASKS;
+    static char ncpu[] = DEF_CPUS;
+    static char nplugin[] = DEF_PLUGINS;
+    static char kinds[] = DEF_KINDS;
+    static char placements[] = DEF_PLACEMENTS;
+    static char admissions[] = DEF_ADMISSIONS;
+    int opt;
+    int res = 0;
+
+    bench_parse_list(ntask, &conf->ntask, 0, 0x7fffffff);
+    bench_parse_list(ncpu, &conf->ncpu, 1, MAX_CPUS);
+    bench_parse_list(nplugin, &conf->nplugin, 1, 0x7fff);
+    bench_parse_kinds(kinds, conf);
+    bench_parse_placements(placements, conf);
+    bench_parse_admissions(admissions, conf);
+    conf->load = DEF_LOAD;
+    conf->deadline = DEF_DEADLINE;
+    conf->iterations = DEF_ITERATIONS;
+    conf->fill = DEF_FILL;
+    conf->seed = DEF_SEED;
+    conf->dir = RETIF_BENCH_PLUGINS_DIR;
+    conf->output = NULL;
+
+    while ((opt = getopt(argc, argv, "n:c:k:g:p:a:l:r:i:u:s:d:o:h")) != -1 &&
+           !res)
+    {
+        switch (opt)
+        {
+        case 'n':
+            res = bench_parse_list(optarg, &conf->ntask, 0, 0x7fffffff);
+            break;
+        case 'c':
+            res = bench_parse_list(optarg, &conf->ncpu, 1, MAX_CPUS);
+            break;
+        case 'k':
+            res = bench_parse_list(optarg, &conf->nplugin, 1, 0x7fff);
+            break;
+        case 'g':
+            res = bench_parse_kinds(optarg, conf);
+            break;
+        case 'p':
+            res = bench_parse_placements(optarg, conf);
+            break;
+        case 'a':
+            res = bench_parse_admissions(optarg, conf);
+            break;
+        case 'l':
+            conf->load = atof(optarg);
+            res = conf->load <= 0 ? -1 : 0;
+            break;
+        case 'r':
+            conf->deadline = atof(optarg);
+            res = (conf->deadline <= 0 || conf->deadline > 1) ? -1 : 0;
+            break;
+        case 'i':
+            conf->iterations = atoi(optarg);
+            res = conf->iterations < 1 ? -1 : 0;
+            break;
+        case 'u':
+            conf->fill = atof(optarg);
+            res = (conf->fill < 0 || conf->fill > 1) ? -1 : 0;
+            break;
+        case 's':
+            conf->seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            conf->dir = optarg;
+            break;
+        case 'o':
+            conf->output = optarg;
+            break;
+        default:
+            res = -1;
+        }
+    }
+
+    if (res == 0 && optind < argc)
+        res = -1;
+
+    return res;
+}
+
+// -----------------------------------------------------------------------------
+// MAIN
+// -----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    struct bench_conf conf;
+    struct rtf_kernel kernel;
+    struct samples smp[OP_NUM];
+    FILE *out = stdout;
+    int first = 1;
+
+    if (bench_parse(argc, argv, &conf) < 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // keep the standard output for the results
+    logger.loglvl = ERR;
+    logger.handler = LOG_FILE;
+    logger.output = stderr;
+
+    if (rtf_kernel_init(&kernel, &rtf_kernel_simulated, NULL) < 0)
+        return EXIT_FAILURE;
+
+    // the simulated system has the CPUs of the largest point, the ones that
+    // do not exist are alone in their core and cache
+    kernel.cpu = realloc(kernel.cpu, MAX_CPUS * sizeof(struct rtf_kernel_cpu));
+
+    if (kernel.cpu == NULL)
+        return EXIT_FAILURE;
+
+    for (int i = kernel.num_of_cpu; i < MAX_CPUS; i++)
+        kernel.cpu[i] = (struct rtf_kernel_cpu) {i, i};
+
+    kernel.num_of_cpu = MAX_CPUS;
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        smp[op].lat = calloc(conf.iterations, sizeof(uint64_t));
+
+        if (smp[op].lat == NULL)
+            return EXIT_FAILURE;
+    }
+
+    if (conf.output != NULL && (out = fopen(conf.output, "w")) == NULL)
+    {
+        fprintf(stderr, "Unable to open %s: %s\n", conf.output,
+            strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "{\n  \"config\": {\n");
+    fprintf(out, "    \"iterations\": %d,\n    \"fill\": %.2f,\n",
+        conf.iterations, conf.fill);
+    fprintf(out, "    \"seed\": %u,\n    \"plugins\": [", conf.seed);
+
+    for (int i = 0; i < conf.nkind; i++)
+        fprintf(out, "%s\"%s\"", i ? ", " : "", conf.kinds[i]);
+
+    fprintf(out, "],\n    \"placements\": [");
+
+    for (int i = 0; i < conf.nplacement; i++)
+        fprintf(out, "%s\"%s\"", i ? ", " : "", conf.placements[i]);
+
+    fprintf(out, "],\n    \"admissions\": [");
+
+    for (int i = 0; i < conf.nadmission; i++)
+        fprintf(out, "%s\"%s\"", i ? ", " : "", conf.admissions[i]);
+
+    fprintf(out, "],\n    \"load\": %.2f,\n", conf.load);
+    fprintf(out, "    \"deadline\": %.2f,\n", conf.deadline);
+    fprintf(out, "    \"kernel\": \"%s\",\n", kernel.ops->name);
+    fprintf(out, "    \"clock\": \"CLOCK_MONOTONIC\"\n  },\n");
+    fprintf(out, "  \"points\": [");
+
+    for (int pl = 0; pl < conf.nplacement; pl++)
+    {
+        for (int ad = 0; ad < conf.nadmission; ad++)
+        {
+            if (bench_sweep(out, &conf, &kernel, conf.placements[pl],
+                    conf.admissions[ad], &first, smp) == 0)
+                continue;
+
+            fprintf(stderr, "Unable to initialize the scheduler.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    for (int op = 0; op < OP_NUM; op++)
+        free(smp[op].lat);
+
+    rtf_task_pool_destroy();
+    rtf_kernel_destroy(&kernel);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,620 @@
+/**
+ * @file retif_bench.c
+ * @brief Measures the latency of the requests served by the daemon
+ *
+ * The benchmark connects to a running daemon and spawns a set of workers,
+ * which share the connection. Each worker owns a part of the tasks and, for
+ * each round, performs on all of its tasks every operation of the mix, one
+ * operation at a time: create, modify, attach, info, detach and destroy.
+ * Tasks are always created and destroyed, but these operations are measured
+ * only if they are part of the mix. Threads are attached to a sleeping
+ * thread owned by the worker.
+ *
+ * The latency of each request is measured with the monotonic clock. At the
+ * end, percentiles, maximum and throughput of each operation are printed in
+ * JSON format.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <retif.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEF_TASKS 1024
+#define DEF_THREADS 1
+#define DEF_ROUNDS 10
+#define DEF_PERIOD_MIN 10000
+#define DEF_PERIOD_MAX 100000
+#define DEF_RUNTIME_MIN 10
+#define DEF_RUNTIME_MAX 100
+#define DEF_PRIORITY_MIN 10
+#define DEF_PRIORITY_MAX 50
+#define DEF_SEED 1
+
+enum OPERATION
+{
+    OP_CREATE,
+    OP_MODIFY,
+    OP_ATTACH,
+    OP_INFO,
+    OP_DETACH,
+    OP_DESTROY,
+    OP_NUM
+};
+
+static const char *op_names[OP_NUM] = {"create", "modify", "attach", "info",
+    "detach", "destroy"};
+
+// uniform distribution over [min, max]
+struct range
+{
+    uint64_t min;
+    uint64_t max;
+};
+
+struct bench_conf
+{
+    int ntask; // tasks, split among the workers
+    int nthread; // workers
+    int rounds; // times each worker goes through its tasks
+    unsigned int seed; // seed of the random parameters
+    struct range period; // [microseconds]
+    struct range runtime; // [microseconds]
+    struct range priority;
+    int mix[OP_NUM]; // whether each operation is measured
+    char *output; // file name, NULL for standard output
+};
+
+struct samples
+{
+    uint64_t *lat; // latencies [nanoseconds]
+    size_t n; // number of latencies
+    uint64_t failed; // requests that did not return RTF_OK
+    uint64_t busy; // sum of latencies [nanoseconds]
+};
+
+struct sleeper
+{
+    pthread_t thread;
+    pid_t tid;
+    sem_t ready;
+};
+
+struct worker
+{
+    pthread_t thread;
+    int ntask;
+    unsigned int seed;
+    struct bench_conf *conf;
+    struct sleeper sleeper;
+    struct rtf_task *t;
+    struct rtf_params *p;
+    struct samples s[OP_NUM];
+};
+
+// -----------------------------------------------------------------------------
+// UTILS
+// -----------------------------------------------------------------------------
+
+static uint64_t bench_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_rand(struct range *r, unsigned int *seed)
+{
+    if (r->max <= r->min)
+        return r->min;
+
+    return r->min + rand_r(seed) % (r->max - r->min + 1);
+}
+
+static void bench_record(struct samples *s, uint64_t start, int ret)
+{
+    uint64_t lat = bench_now() - start;
+
+    s->lat[s->n++] = lat;
+    s->busy += lat;
+
+    if (ret != RTF_OK)
+        s->failed++;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted samples
+static uint64_t bench_percentile(struct samples *s, double pct)
+{
+    double pos = pct / 100.0 * s->n;
+    size_t rank = (size_t) pos;
+
+    if (s->n == 0)
+        return 0;
+
+    if (rank < pos || rank == 0)
+        rank++;
+
+    return s->lat[(rank > s->n ? s->n : rank) - 1];
+}
+
+static void bench_params(struct bench_conf *conf, struct rtf_params *p,
+    unsigned int *seed)
+{
+    uint64_t period = bench_rand(&conf->period, seed);
+
+    rtf_params_init(p);
+    rtf_params_set_period(p, period);
+    rtf_params_set_deadline(p, period);
+    rtf_params_set_runtime(p, bench_rand(&conf->runtime, seed));
+    rtf_params_set_priority(p, bench_rand(&conf->priority, seed));
+}
+
+// -----------------------------------------------------------------------------
+// WORKERS
+// -----------------------------------------------------------------------------
+
+static void *bench_sleeper(void *arg)
+{
+    struct sleeper *sl = arg;
+
+    sl->tid = syscall(SYS_gettid);
+    sem_post(&sl->ready);
+
+    while (1)
+        pause();
+
+    return NULL;
+}
+
+static void bench_round(struct worker *w)
+{
+    struct bench_conf *conf = w->conf;
+    struct rtf_task_info info;
+    int *mix = conf->mix;
+    uint64_t start;
+    int ret;
+
+    for (int i = 0; i < w->ntask; i++)
+    {
+        bench_params(conf, &w->p[i], &w->seed);
+        rtf_task_init(&w->t[i]);
+
+        start = bench_now();
+        ret = rtf_task_create(&w->t[i], &w->p[i]);
+
+        if (mix[OP_CREATE])
+            bench_record(&w->s[OP_CREATE], start, ret);
+
+        // refused, the other operations would fail for sure
+        if (ret != RTF_OK)
+            w->t[i].task_id = 0;
+    }
+
+    for (int i = 0; i < w->ntask && mix[OP_MODIFY]; i++)
+    {
+        if (w->t[i].task_id == 0)
+            continue;
+
+        bench_params(conf, &w->p[i], &w->seed);
+
+        start = bench_now();
+        ret = rtf_task_change(&w->t[i], &w->p[i]);
+        bench_record(&w->s[OP_MODIFY], start, ret);
+    }
+
+    for (int i = 0; i < w->ntask && mix[OP_ATTACH]; i++)
+    {
+        if (w->t[i].task_id == 0)
+            continue;
+
+        start = bench_now();
+        ret = rtf_task_attach(&w->t[i], w->sleeper.tid);
+        bench_record(&w->s[OP_ATTACH], start, ret);
+    }
+
+    for (int i = 0; i < w->ntask && mix[OP_INFO]; i++)
+    {
+        if (w->t[i].task_id == 0)
+            continue;
+
+        start = bench_now();
+        ret = rtf_task_info(w->t[i].task_id, &info);
+        bench_record(&w->s[OP_INFO], start, ret);
+    }
+
+    for (int i = 0; i < w->ntask && mix[OP_DETACH]; i++)
+    {
+        if (w->t[i].task_id == 0)
+            continue;
+
+        start = bench_now();
+        ret = rtf_task_detach(&w->t[i]);
+        bench_record(&w->s[OP_DETACH], start, ret);
+    }
+
+    for (int i = 0; i < w->ntask; i++)
+    {
+        if (w->t[i].task_id == 0)
+            continue;
+
+        start = bench_now();
+        ret = rtf_task_release(&w->t[i]);
+
+        if (mix[OP_DESTROY])
+            bench_record(&w->s[OP_DESTROY], start, ret);
+    }
+}
+
+static void *bench_worker(void *arg)
+{
+    struct worker *w = arg;
+
+    for (int r = 0; r < w->conf->rounds; r++)
+        bench_round(w);
+
+    return NULL;
+}
+
+static int bench_worker_init(struct worker *w, struct bench_conf *conf,
+    int ntask, unsigned int seed)
+{
+    size_t nsamples = (size_t) ntask * conf->rounds;
+
+    memset(w, 0, sizeof(struct worker));
+    w->conf = conf;
+    w->ntask = ntask;
+    w->seed = seed;
+
+    w->t = calloc(ntask, sizeof(struct rtf_task));
+    w->p = calloc(ntask, sizeof(struct rtf_params));
+
+    if ((w->t == NULL || w->p == NULL) && ntask > 0)
+        return -1;
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        if (!conf->mix[op])
+            continue;
+
+        w->s[op].lat = calloc(nsamples + 1, sizeof(uint64_t));
+
+        if (w->s[op].lat == NULL)
+            return -1;
+    }
+
+    if (sem_init(&w->sleeper.ready, 0, 0) < 0)
+        return -1;
+
+    if (pthread_create(&w->sleeper.thread, NULL, bench_sleeper, &w->sleeper))
+        return -1;
+
+    sem_wait(&w->sleeper.ready);
+
+    return 0;
+}
+
+static void bench_worker_destroy(struct worker *w)
+{
+    pthread_cancel(w->sleeper.thread);
+    pthread_join(w->sleeper.thread, NULL);
+    sem_destroy(&w->sleeper.ready);
+
+    for (int op = 0; op < OP_NUM; op++)
+        free(w->s[op].lat);
+
+    free(w->t);
+    free(w->p);
+}
+
+// -----------------------------------------------------------------------------
+// RESULTS
+// -----------------------------------------------------------------------------
+
+// merges the samples of all the workers, in the first one
+static void bench_merge(struct worker *w, int nthread, int op)
+{
+    struct samples *all = &w[0].s[op];
+
+    for (int i = 1; i < nthread; i++)
+    {
+        memcpy(all->lat + all->n, w[i].s[op].lat,
+            w[i].s[op].n * sizeof(uint64_t));
+        all->n += w[i].s[op].n;
+        all->failed += w[i].s[op].failed;
+        all->busy += w[i].s[op].busy;
+    }
+
+    qsort(all->lat, all->n, sizeof(uint64_t), bench_cmp);
+}
+
+static void bench_print(FILE *out, struct bench_conf *conf, struct worker *w,
+    uint64_t elapsed)
+{
+    struct samples *s;
+    uint64_t total = 0;
+    int first = 1;
+
+    fprintf(out, "{\n  \"config\": {\n");
+    fprintf(out, "    \"tasks\": %d,\n    \"concurrency\": %d,\n", conf->ntask,
+        conf->nthread);
+    fprintf(out, "    \"rounds\": %d,\n    \"seed\": %u,\n", conf->rounds,
+        conf->seed);
+    fprintf(out, "    \"period_us\": [%" PRIu64 ", %" PRIu64 "],\n",
+        conf->period.min, conf->period.max);
+    fprintf(out, "    \"runtime_us\": [%" PRIu64 ", %" PRIu64 "],\n",
+        conf->runtime.min, conf->runtime.max);
+    fprintf(out, "    \"priority\": [%" PRIu64 ", %" PRIu64 "],\n",
+        conf->priority.min, conf->priority.max);
+    fprintf(out, "    \"clock\": \"CLOCK_MONOTONIC\"\n  },\n");
+    fprintf(out, "  \"operations\": {");
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        if (!conf->mix[op])
+            continue;
+
+        s = &w[0].s[op];
+        total += s->n;
+
+        // throughput over the time spent in the operation by the workers
+        fprintf(out, "%s\n    \"%s\": {\n", first ? "" : ",", op_names[op]);
+        fprintf(out, "      \"count\": %zu,\n", s->n);
+        fprintf(out, "      \"failed\": %" PRIu64 ",\n", s->failed);
+        fprintf(out, "      \"p50_ns\": %" PRIu64 ",\n",
+            bench_percentile(s, 50));
+        fprintf(out, "      \"p99_ns\": %" PRIu64 ",\n",
+            bench_percentile(s, 99));
+        fprintf(out, "      \"p99.9_ns\": %" PRIu64 ",\n",
+            bench_percentile(s, 99.9));
+        fprintf(out, "      \"max_ns\": %" PRIu64 ",\n",
+            s->n ? s->lat[s->n - 1] : 0);
+        fprintf(out, "      \"throughput_ops\": %.1f\n    }",
+            s->busy ? s->n * 1e9 * conf->nthread / s->busy : 0.0);
+        first = 0;
+    }
+
+    fprintf(out, "\n  },\n");
+    fprintf(out, "  \"elapsed_s\": %.6f,\n", elapsed / 1e9);
+    fprintf(out, "  \"throughput_ops\": %.1f\n}\n",
+        elapsed ? total * 1e9 / elapsed : 0.0);
+}
+
+// -----------------------------------------------------------------------------
+// COMMAND LINE
+// -----------------------------------------------------------------------------
+
+static void bench_usage(char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -n NUM        tasks, split among the workers (default %d)\n"
+        "  -c NUM        concurrent workers (default %d)\n"
+        "  -i NUM        rounds over the tasks (default %d)\n"
+        "  -p MIN[:MAX]  period, uniform [us] (default %d:%d)\n"
+        "  -r MIN[:MAX]  runtime, uniform [us] (default %d:%d)\n"
+        "  -P MIN[:MAX]  priority, uniform (default %d:%d)\n"
+        "  -m OPS        comma-separated operations to measure, among\n"
+        "                create,modify,attach,info,detach,destroy or all\n"
+        "                (default all)\n"
+        "  -s SEED       seed of the random parameters (default %d)\n"
+        "  -o FILE       write the JSON results in FILE (default stdout)\n",
+        name, DEF_TASKS, DEF_THREADS, DEF_ROUNDS, DEF_PERIOD_MIN,
+        DEF_PERIOD_MAX, DEF_RUNTIME_MIN, DEF_RUNTIME_MAX, DEF_PRIORITY_MIN,
+        DEF_PRIORITY_MAX, DEF_SEED);
+}
+
+static int bench_parse_range(char *arg, struct range *r)
+{
+    char *end;
+
+    r->min = strtoull(arg, &end, 10);
+    r->max = r->min;
+
+    if (*end == ':')
+        r->max = strtoull(end + 1, &end, 10);
+
+    return (*end != '\0' || r->max < r->min) ? -1 : 0;
+}
+
+static int bench_parse_mix(char *arg, int *mix)
+{
+    char *tok;
+    char *save;
+    int op;
+
+    memset(mix, 0, OP_NUM * sizeof(int));
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        if (strcmp(tok, "all") == 0)
+        {
+            for (op = 0; op < OP_NUM; op++)
+                mix[op] = 1;
+            continue;
+        }
+
+        for (op = 0; op < OP_NUM && strcmp(tok, op_names[op]) != 0; op++)
+            ;
+
+        if (op == OP_NUM)
+            return -1;
+
+        mix[op] = 1;
+    }
+
+    return 0;
+}
+
+static int bench_parse(int argc, char *argv[], struct bench_conf *conf)
+{
+    int opt;
+    int res = 0;
+
+    conf->ntask = DEF_TASKS;
+    conf->nthread = DEF_THREADS;
+    conf->rounds = DEF_ROUNDS;
+    conf->seed = DEF_SEED;
+    conf->period = (struct range){DEF_PERIOD_MIN, DEF_PERIOD_MAX};
+    conf->runtime = (struct range){DEF_RUNTIME_MIN, DEF_RUNTIME_MAX};
+    conf->priority = (struct range){DEF_PRIORITY_MIN, DEF_PRIORITY_MAX};
+    conf->output = NULL;
+
+    for (int op = 0; op < OP_NUM; op++)
+        conf->mix[op] = 1;
+
+    while ((opt = getopt(argc, argv, "n:c:i:p:r:P:m:s:o:h")) != -1 && !res)
+    {
+        switch (opt)
+        {
+        case 'n':
+            conf->ntask = atoi(optarg);
+            res = conf->ntask < 1 ? -1 : 0;
+            break;
+        case 'c':
+            conf->nthread = atoi(optarg);
+            res = conf->nthread < 1 ? -1 : 0;
+            break;
+        case 'i':
+            conf->rounds = atoi(optarg);
+            res = conf->rounds < 1 ? -1 : 0;
+            break;
+        case 'p':
+            res = bench_parse_range(optarg, &conf->period);
+            break;
+        case 'r':
+            res = bench_parse_range(optarg, &conf->runtime);
+            break;
+        case 'P':
+            res = bench_parse_range(optarg, &conf->priority);
+            break;
+        case 'm':
+            res = bench_parse_mix(optarg, conf->mix);
+            break;
+        case 's':
+            conf->seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            conf->output = optarg;
+            break;
+        default:
+            res = -1;
+        }
+    }
+
+    if (res == 0 && optind < argc)
+        res = -1;
+
+    return res;
+}
+
+// -----------------------------------------------------------------------------
+// MAIN
+// -----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    struct bench_conf conf;
+    struct worker *w;
+    uint64_t start;
+    uint64_t elapsed;
+    FILE *out = stdout;
+    int ntask;
+
+    if (bench_parse(argc, argv, &conf) < 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (conf.nthread > conf.ntask)
+        conf.nthread = conf.ntask;
+
+    if (rtf_connect() < 0)
+    {
+        fprintf(stderr, "Unable to connect with the daemon.\n");
+        return EXIT_FAILURE;
+    }
+
+    w = calloc(conf.nthread, sizeof(struct worker));
+
+    if (w == NULL)
+        return EXIT_FAILURE;
+
+    for (int i = 0; i < conf.nthread; i++)
+    {
+        // spread the remainder over the first workers
+        ntask = conf.ntask / conf.nthread + (i < conf.ntask % conf.nthread);
+
+        if (bench_worker_init(&w[i], &conf, ntask, conf.seed + i) < 0)
+        {
+            fprintf(stderr, "Unable to initialize worker %d: %s\n", i,
+                strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    start = bench_now();
+
+    for (int i = 0; i < conf.nthread; i++)
+        if (pthread_create(&w[i].thread, NULL, bench_worker, &w[i]) != 0)
+            return EXIT_FAILURE;
+
+    for (int i = 0; i < conf.nthread; i++)
+        pthread_join(w[i].thread, NULL);
+
+    elapsed = bench_now() - start;
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        if (!conf.mix[op])
+            continue;
+
+        // the first worker must hold the samples of all the others
+        w[0].s[op].lat = realloc(w[0].s[op].lat,
+            ((size_t) conf.ntask * conf.rounds + 1) * sizeof(uint64_t));
+
+        if (w[0].s[op].lat == NULL)
+            return EXIT_FAILURE;
+
+        bench_merge(w, conf.nthread, op);
+    }
+
+    if (conf.output != NULL && (out = fopen(conf.output, "w")) == NULL)
+    {
+        fprintf(stderr, "Unable to open %s: %s\n", conf.output,
+            strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    bench_print(out, &conf, w, elapsed);
+
+    if (out != stdout)
+        fclose(out);
+
+    for (int i = 0; i < conf.nthread; i++)
+        bench_worker_destroy(&w[i]);
+
+    free(w);
+
+    return EXIT_SUCCESS;
+}
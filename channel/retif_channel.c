@@ -2,8 +2,14 @@
 #include "logger.h"
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#define CHANNEL_ISIZE 128
+#define CHANNEL_BSIZE 4096 // initial size of the body of requests [bytes]
+#define CHANNEL_OSIZE 4096 // initial size of the queue of replies [bytes]
+#define CHANNEL_OMAX (64 << 20) // max replies queued for a client [bytes]
+
 // -----------------------------------------------------------------------------
 // CHANNEL ACCESS METHODS
 // -----------------------------------------------------------------------------
@@ -21,16 +27,294 @@ int rtf_access_connect(struct rtf_access *c)
     return usocket_connect(&(c->sock), CHANNEL_PATH_ACCESS);
 }
 
-int rtf_access_recv(struct rtf_access *c)
+int rtf_access_recv(struct rtf_access *c, struct rtf_reply *rep)
+{
+    return usocket_recv(&(c->sock), (void *) rep, sizeof(struct rtf_reply));
+}
+
+int rtf_access_send(struct rtf_access *c, struct rtf_request *req)
+{
+    req->size = 0;
+    return usocket_send(&(c->sock), (void *) req, sizeof(struct rtf_request));
+}
+
+int rtf_access_recv_data(struct rtf_access *c, void *data, size_t size)
+{
+    return usocket_recv(&(c->sock), data, size);
+}
+
+// the socket of the client is blocking, hence no timeout is needed
+int rtf_access_send_data(struct rtf_access *c, struct rtf_request *req,
+    void *data, size_t size)
+{
+    req->size = size;
+    return usocket_sendallto(&(c->sock), (void *) req,
+        sizeof(struct rtf_request), data, size, c->sock.socket, -1);
+}
+
+// -----------------------------------------------------------------------------
+// CHANNEL CARRIER PRIVATE METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @internal
+ *
+ * Grows all per-client arrays so that they can be indexed by @p cli_id. New
+ * slots are zeroed, hence new clients start in the EMPTY state. Returns 0 in
+ * case of success, -1 if memory cannot be allocated.
+ *
+ * @endinternal
+ */
+static int rtf_carrier_reserve(struct rtf_carrier *c, int cli_id)
+{
+    int conn_max;
+    int grow;
+
+    if (cli_id < c->conn_max)
+        return 0;
+
+    conn_max = c->conn_max ? c->conn_max : CHANNEL_ISIZE;
+
+    while (conn_max <= cli_id)
+        conn_max *= 2;
+
+    grow = conn_max - c->conn_max;
+
+#define CARRIER_GROW(field)                                                    \
+    {                                                                          \
+        void *ptr = realloc(c->field, conn_max * sizeof(*(c->field)));         \
+        if (ptr == NULL)                                                       \
+            return -1;                                                         \
+        c->field = ptr;                                                        \
+        memset(c->field + c->conn_max, 0, grow * sizeof(*(c->field)));         \
+    }
+
+    CARRIER_GROW(last_req);
+    CARRIER_GROW(last_body);
+    CARRIER_GROW(last_len);
+    CARRIER_GROW(last_cap);
+    CARRIER_GROW(out_buf);
+    CARRIER_GROW(out_off);
+    CARRIER_GROW(out_len);
+    CARRIER_GROW(out_cap);
+    CARRIER_GROW(sending);
+    CARRIER_GROW(client);
+    CARRIER_GROW(queued);
+    CARRIER_GROW(ready);
+    CARRIER_GROW(backlog);
+
+#undef CARRIER_GROW
+
+    c->conn_max = conn_max;
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Appends @p cli_id to the ready list, unless it is already present
+ *
+ * @endinternal
+ */
+static void rtf_carrier_enqueue(struct rtf_carrier *c, int cli_id)
+{
+    if (c->queued[cli_id])
+        return;
+
+    c->queued[cli_id] = 1;
+    c->ready[c->nready].cli_id = cli_id;
+    c->ready[c->nready].req = NULL;
+    c->ready[c->nready++].body = NULL;
+}
+
+/**
+ * @internal
+ *
+ * Grows the body buffer of @p cli_id, doubling it until @p size bytes fit.
+ * The buffer is kept until the client closes, so it is reallocated only when
+ * a body larger than all the previous ones arrives. Returns 0 in case of
+ * success, -1 if memory cannot be allocated.
+ *
+ * @endinternal
+ */
+static int rtf_carrier_reserve_body(struct rtf_carrier *c, int cli_id,
+    size_t size)
+{
+    size_t cap = c->last_cap[cli_id] ? c->last_cap[cli_id] : CHANNEL_BSIZE;
+    void *buf;
+
+    while (cap < size)
+        cap *= 2;
+
+    buf = realloc(c->last_body[cli_id], cap);
+
+    if (buf == NULL)
+        return -1;
+
+    c->last_body[cli_id] = buf;
+    c->last_cap[cli_id] = cap;
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Receives one request from @p cli_id. Descriptors are non-blocking, so a
+ * read that would block means that no (more) data is available. Clients may
+ * pipeline several requests, so a request can arrive in pieces: the bytes
+ * received so far are kept in last_len and the request is reported only once
+ * complete, together with the body announced by its header (if any). If a
+ * full request was received, the descriptor is put in the backlog, because
+ * edge-triggered notification will not report data already queued behind it.
+ * Returns the size of the request if complete, 0 if no complete request is
+ * available or -1 if the client closed the connection, announced a body
+ * larger than RTF_BODY_MAX or an error occurred.
+ *
+ * @endinternal
+ */
+static int rtf_carrier_recv(struct rtf_carrier *c, int cli_id)
+{
+    struct rtf_request *req = &(c->last_req[cli_id]);
+    size_t len = c->last_len[cli_id];
+    size_t hsize = sizeof(struct rtf_request);
+    char *buf;
+    size_t want;
+    int n;
+
+    do
+    {
+        if (len < hsize)
+        {
+            buf = (char *) req + len;
+            want = hsize - len;
+        }
+        else
+        {
+            if (req->size > RTF_BODY_MAX)
+                return -1;
+
+            if (req->size > c->last_cap[cli_id] &&
+                rtf_carrier_reserve_body(c, cli_id, req->size) < 0)
+                return -1;
+
+            buf = (char *) c->last_body[cli_id] + (len - hsize);
+            want = hsize + req->size - len;
+        }
+
+        n = usocket_recvfrom(&(c->sock), buf, want, cli_id);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            c->last_len[cli_id] = len;
+            return 0;
+        }
+        else if (n <= 0)
+        {
+            return -1;
+        }
+
+        len += n;
+    } while (len < hsize || len < hsize + req->size);
+
+    c->last_len[cli_id] = 0;
+    c->queued[cli_id] = 1;
+    c->backlog[c->nbacklog++] = cli_id;
+
+    return len;
+}
+
+/**
+ * @internal
+ *
+ * Appends @p size bytes to the replies queued for @p cli_id, moving the ones
+ * not sent yet to the beginning of the queue first. Returns 0 in case of
+ * success, -1 if the queue would exceed CHANNEL_OMAX or memory cannot be
+ * allocated.
+ *
+ * @endinternal
+ */
+static int rtf_carrier_queue(struct rtf_carrier *c, int cli_id, void *data,
+    size_t size)
 {
-    return usocket_recv(&(c->sock), (void *) &(c->rep),
-        sizeof(struct rtf_reply));
+    size_t len = c->out_len[cli_id] - c->out_off[cli_id];
+    size_t cap = c->out_cap[cli_id] ? c->out_cap[cli_id] : CHANNEL_OSIZE;
+    char *buf;
+
+    if (len + size > CHANNEL_OMAX)
+        return -1;
+
+    if (c->out_off[cli_id] > 0)
+    {
+        memmove(c->out_buf[cli_id], c->out_buf[cli_id] + c->out_off[cli_id],
+            len);
+        c->out_off[cli_id] = 0;
+        c->out_len[cli_id] = len;
+    }
+
+    while (cap < len + size)
+        cap *= 2;
+
+    if (cap != c->out_cap[cli_id])
+    {
+        buf = realloc(c->out_buf[cli_id], cap);
+
+        if (buf == NULL)
+            return -1;
+
+        c->out_buf[cli_id] = buf;
+        c->out_cap[cli_id] = cap;
+    }
+
+    memcpy(c->out_buf[cli_id] + len, data, size);
+    c->out_len[cli_id] = len + size;
+
+    return 0;
 }
 
-int rtf_access_send(struct rtf_access *c)
+/**
+ * @internal
+ *
+ * Sends the replies queued for @p cli_id until the socket buffer is full. The
+ * descriptor is watched for writability as long as something is left, so
+ * that the update resumes sending when the client drains its socket. Returns
+ * 0 in case of success, -1 if the client cannot be written.
+ *
+ * @endinternal
+ */
+static int rtf_carrier_flush(struct rtf_carrier *c, int cli_id)
 {
-    return usocket_send(&(c->sock), (void *) &(c->req),
-        sizeof(struct rtf_request));
+    int n;
+
+    while (c->out_off[cli_id] < c->out_len[cli_id])
+    {
+        n = usocket_sendto(&(c->sock), c->out_buf[cli_id] + c->out_off[cli_id],
+            c->out_len[cli_id] - c->out_off[cli_id], cli_id);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if (c->sending[cli_id])
+                return 0;
+
+            c->sending[cli_id] = 1;
+            return usocket_watch_send(&(c->sock), cli_id, 1);
+        }
+        else if (n <= 0)
+        {
+            return -1;
+        }
+
+        c->out_off[cli_id] += n;
+    }
+
+    c->out_off[cli_id] = 0;
+    c->out_len[cli_id] = 0;
+
+    if (!c->sending[cli_id])
+        return 0;
+
+    c->sending[cli_id] = 0;
+    return usocket_watch_send(&(c->sock), cli_id, 0);
 }
 
 // -----------------------------------------------------------------------------
@@ -47,7 +331,7 @@ int rtf_access_send(struct rtf_access *c)
  */
 int rtf_carrier_init(struct rtf_carrier *c)
 {
-    memset(c, 0, sizeof(struct rtf_access));
+    memset(c, 0, sizeof(struct rtf_carrier));
 
     if (usocket_init(&(c->sock), TCP) < 0)
         return -1;
@@ -61,7 +345,14 @@ int rtf_carrier_init(struct rtf_carrier *c)
     if (usocket_listen(&(c->sock), BACKLOG_MAX) < 0)
         return -1;
 
-    usocket_prepare_recv(&(c->sock));
+    if (usocket_prepare_recv(&(c->sock)) < 0)
+    {
+        LOG(ERR, "Unable to create epoll instance: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (rtf_carrier_reserve(c, CHANNEL_ISIZE - 1) < 0)
+        return -1;
 
     return 0;
 }
@@ -69,118 +360,144 @@ int rtf_carrier_init(struct rtf_carrier *c)
 /**
  * @internal
  *
- * Receives new data from clients and updates their current states following
- * this FSM schema:
- *  main socket --> do nothing, incoming connection are handled internally
- *  empty descriptor and no data received --> nothing to do
+ * Waits for clients that have been sent data, receives one request from each
+ * of them and updates their current states following this FSM schema:
+ *  no data received (read would block) --> nothing to do
  *  empty descriptor but some data received --> a new client is CONNECTED
  *  connected client and data received --> do nothing, daemon will react
  *  receive error --> set as ERROR
  *  receive disconnection --> set as DISCONNECTED
  *
+ * Clients with queued replies are reported also when they become writable,
+ * then the replies are sent; a client that cannot be written is treated as
+ * disconnected.
+ *
+ * Only the descriptors reported by epoll (plus those in the backlog) are
+ * touched, so the cost of an update does not depend on the number of
+ * connected clients. Clients that produced data or failed are returned in
+ * the ready list, with a pointer to the received request (and its body) for
+ * CONNECTED ones.
+ *
  * @endinternal
  */
-void rtf_carrier_update(struct rtf_carrier *c)
+int rtf_carrier_update(struct rtf_carrier *c,
+    struct rtf_carrier_event **events)
 {
-    int i, n;
+    int i, n, cli_id, nready;
+    int ready[EPOLL_MAX_EVENTS];
 
-    n = usocket_get_maxfd(&(c->sock));
-    memset(&(c->last_n), 0, (sizeof(int)) * (n + 1));
-
-    if (usocket_recvall(&(c->sock), (void *) &(c->last_req),
-            (int *) &(c->last_n), sizeof(struct rtf_request)) < 0)
-        return;
+    // do not sleep if some client may still have unread requests
+    n = usocket_recvall(&(c->sock), ready, c->nbacklog ? 0 : -1);
 
-    // FIXME:
-    /*  When receiving using a socket, 0 means the other side closed
-        the connection, -1 means an error occurred.
-        Here, when 0 bytes received, could means no update, cause when daemon
-        is waken up, last_n is setted to 0.
-        We need to discriminate 0 from -1.
-    */
+    c->nready = 0;
 
-    for (i = 0; i <= n; i++)
+    for (i = 0; i < c->nbacklog; i++)
     {
-        if (i == c->sock.socket)
+        if (!c->queued[c->backlog[i]])
             continue;
-        else if (c->client[i].state == EMPTY && c->last_n[i] == 0)
-            continue;
-        else if (c->client[i].state == EMPTY && c->last_n[i] > 0)
-            c->client[i].state = CONNECTED;
-        else if (c->client[i].state == CONNECTED && c->last_n[i] >= 0)
+
+        c->ready[c->nready].cli_id = c->backlog[i];
+        c->ready[c->nready].req = NULL;
+        c->ready[c->nready++].body = NULL;
+    }
+
+    c->nbacklog = 0;
+
+    for (i = 0; i < n; i++)
+        if (rtf_carrier_reserve(c, ready[i]) == 0)
+            rtf_carrier_enqueue(c, ready[i]);
+
+    for (i = 0; i < c->nready; i++)
+        c->queued[c->ready[i].cli_id] = 0;
+
+    for (i = 0, nready = 0; i < c->nready; i++)
+    {
+        cli_id = c->ready[i].cli_id;
+        n = rtf_carrier_recv(c, cli_id);
+
+        if (n >= 0 && c->sending[cli_id] && rtf_carrier_flush(c, cli_id) < 0)
+            n = -1;
+
+        if (n == 0)
             continue;
-        else if (c->last_n[i] < 0)
-            c->client[i].state = DISCONNECTED;
-        else
-            c->client[i].state = ERROR;
+        else if (c->client[cli_id].state == EMPTY && n > 0)
+            c->client[cli_id].state = CONNECTED;
+        else if (n < 0)
+            c->client[cli_id].state = DISCONNECTED;
+        else if (c->client[cli_id].state != CONNECTED)
+            c->client[cli_id].state = ERROR;
+
+        c->ready[nready].cli_id = cli_id;
+        c->ready[nready].req = NULL;
+        c->ready[nready].body = NULL;
+
+        if (c->client[cli_id].state == CONNECTED)
+        {
+            c->ready[nready].req = &(c->last_req[cli_id]);
+            if (c->last_req[cli_id].size > 0)
+                c->ready[nready].body = c->last_body[cli_id];
+        }
+
+        nready++;
     }
+
+    c->nready = nready;
+    *events = c->ready;
+
+    return nready;
 }
 
 /**
  * @internal
  *
- * Sends a reply packet to a client associated with descriptor @p cli_id
+ * Sends a reply packet to a client associated with descriptor @p cli_id. The
+ * reply goes through the queue of the client, so that a partial write never
+ * splits it and it never overtakes the replies queued before. If these are
+ * still waiting for the client to drain its socket, nothing is sent now.
  *
  * @endinternal
  */
 int rtf_carrier_send(struct rtf_carrier *c, struct rtf_reply *r, int cli_id)
 {
-    return usocket_sendto(&(c->sock), (void *) r, sizeof(struct rtf_reply),
-        cli_id);
+    return rtf_carrier_send_data(c, r, NULL, 0, cli_id);
 }
 
 /**
  * @internal
  *
- * Returns the highest number of valid client connection among all
- * the possible set of descriptor
+ * Sends a reply packet followed by a variable-length body to a client. Both
+ * are copied in the queue of the client, so that the daemon never waits for
+ * a slow client: what does not fit its socket buffer is sent by the next
+ * updates, as the client drains it.
  *
  * @endinternal
  */
-int rtf_carrier_get_conn(struct rtf_carrier *c)
+int rtf_carrier_send_data(struct rtf_carrier *c, struct rtf_reply *r,
+    void *data, size_t size, int cli_id)
 {
-    return usocket_get_maxfd(&(c->sock));
-}
+    if (rtf_carrier_queue(c, cli_id, r, sizeof(struct rtf_reply)) < 0)
+        return -1;
 
-/**
- * @internal
- *
- * Returns the last request made by the client associated with descriptor @p
- * cli_id
- *
- * @endinternal
- */
-struct rtf_request rtf_carrier_get_req(struct rtf_carrier *c, int cli_id)
-{
-    return c->last_req[cli_id];
-}
+    if (size > 0 && rtf_carrier_queue(c, cli_id, data, size) < 0)
+        return -1;
 
-/**
- * @internal
- *
- * Checks if the client associated with descriptor @p cli_id has been sent
- * a request during the last daemon loop
- *
- * @endinternal
- */
-int rtf_carrier_is_updated(struct rtf_carrier *c, int cli_id)
-{
-    if (c->last_n[cli_id] > 0)
-        return 1;
+    if (!c->sending[cli_id] && rtf_carrier_flush(c, cli_id) < 0)
+        return -1;
 
-    return 0;
+    return sizeof(struct rtf_reply) + size;
 }
 
 /**
  * @internal
  *
- * Clears the request of @p cli_id setting last num of bytes received to 0
+ * Return the number of slots in the client table, so that every valid client
+ * connection descriptor is lower than the returned value
  *
  * @endinternal
  */
-void rtf_carrier_req_clear(struct rtf_carrier *c, int cli_id)
+int rtf_carrier_get_conn(struct rtf_carrier *c)
 {
-    c->last_n[cli_id] = 0;
+    return c->conn_max;
 }
 
 /**
@@ -244,7 +561,7 @@ void rtf_carrier_dump(struct rtf_carrier *c)
 {
     struct rtf_client *client;
 
-    for (int i = 0; i < CHANNEL_MAX_SIZE; i++)
+    for (int i = 0; i < c->conn_max; i++)
     {
         client = &(c->client[i]);
 
@@ -256,7 +573,26 @@ void rtf_carrier_dump(struct rtf_carrier *c)
     }
 }
 
+/**
+ * @internal
+ *
+ * Removes the descriptor from the epoll instance and the backlog, drops the
+ * replies still queued, then closes it.
+ *
+ * @endinternal
+ */
 void rtf_carrier_close(struct rtf_carrier *c, int cli_id)
 {
+    c->queued[cli_id] = 0;
+    c->last_len[cli_id] = 0;
+    free(c->last_body[cli_id]);
+    c->last_body[cli_id] = NULL;
+    c->last_cap[cli_id] = 0;
+    free(c->out_buf[cli_id]);
+    c->out_buf[cli_id] = NULL;
+    c->out_off[cli_id] = 0;
+    c->out_len[cli_id] = 0;
+    c->out_cap[cli_id] = 0;
+    c->sending[cli_id] = 0;
     usocket_remove_connection(&c->sock, cli_id);
 }
@@ -21,7 +21,6 @@
 
 #define CHANNEL_PATH_CARRIER "/run/retif_channel.sock"
 #define CHANNEL_PATH_ACCESS "/run/retif_channel.sock"
-#define CHANNEL_MAX_SIZE SET_MAX_SIZE
 
 /**
  * @brief Data-structure that each client must use to communicate with daemon
@@ -29,19 +28,52 @@
 struct rtf_access
 {
     struct usocket sock;
-    struct rtf_request req;
-    struct rtf_reply rep;
+};
+
+/**
+ * @brief A client that produced data or failed during the last update
+ *
+ * The request and its body point inside the carrier and are valid until the
+ * next update. The request is NULL if the client has no request to serve,
+ * e.g. because it has closed the connection or an error occurred.
+ */
+struct rtf_carrier_event
+{
+    int cli_id; /** Id descriptor of the client */
+    struct rtf_request *req; /** Request received, NULL on failures */
+    void *body; /** Body that follows the request, NULL if none */
 };
 
 /**
  * @brief Data-structure that the server use to keep info about clients
+ *
+ * Per-client arrays are indexed by connection descriptor and grow on demand,
+ * so that the number of clients is bounded only by the descriptor limit of
+ * the daemon. The ready list contains only the clients that produced data
+ * or failed during the last update, while the backlog keeps descriptors that
+ * may still have unread requests (descriptors are watched edge-triggered).
+ * Replies that do not fit the socket buffer of a client are queued and sent
+ * once the descriptor becomes writable again.
  */
 struct rtf_carrier
 {
     struct usocket sock;
-    int last_n[CHANNEL_MAX_SIZE];
-    struct rtf_request last_req[CHANNEL_MAX_SIZE];
-    struct rtf_client client[CHANNEL_MAX_SIZE];
+    int conn_max; /** Current size of per-client arrays */
+    struct rtf_request *last_req; /** Last request received from clients */
+    void **last_body; /** Body of the last request, allocated on demand */
+    size_t *last_len; /** Bytes of the last request received so far */
+    size_t *last_cap; /** Size of last_body */
+    char **out_buf; /** Replies not sent yet, allocated on demand */
+    size_t *out_off; /** Bytes of out_buf already sent */
+    size_t *out_len; /** Bytes of out_buf in use */
+    size_t *out_cap; /** Size of out_buf */
+    char *sending; /** Whether the descriptor is watched for writability */
+    struct rtf_client *client; /** State and pid of each client */
+    char *queued; /** Whether the descriptor is in the ready list */
+    int nready; /** Number of clients ready in the last update */
+    struct rtf_carrier_event *ready; /** Clients ready in the last update */
+    int nbacklog; /** Number of descriptors to be read again */
+    int *backlog; /** Descriptors to be read again in the next update */
 };
 
 // -----------------------------------------------------------------------------
@@ -52,9 +84,14 @@ int rtf_access_init(struct rtf_access *c);
 
 int rtf_access_connect(struct rtf_access *c);
 
-int rtf_access_recv(struct rtf_access *c);
+int rtf_access_recv(struct rtf_access *c, struct rtf_reply *rep);
 
-int rtf_access_send(struct rtf_access *c);
+int rtf_access_send(struct rtf_access *c, struct rtf_request *req);
+
+int rtf_access_recv_data(struct rtf_access *c, void *data, size_t size);
+
+int rtf_access_send_data(struct rtf_access *c, struct rtf_request *req,
+    void *data, size_t size);
 
 // -----------------------------------------------------------------------------
 // CHANNEL CARRIER METHODS
@@ -74,19 +111,25 @@ int rtf_carrier_init(struct rtf_carrier *c);
 /**
  * @brief Receives new data from clients
  *
- * Receives new data from clients and updates their current states
+ * Receives new data from clients and updates their current states. Returns
+ * in @p events the list of clients that produced data or failed, which stays
+ * valid until the next update.
  *
  * @param c pointer to channel data structure of the daemon
+ * @param events set to point to the list of ready clients
+ * @return the number of ready clients in @p events
  */
-void rtf_carrier_update(struct rtf_carrier *c);
+int rtf_carrier_update(struct rtf_carrier *c,
+    struct rtf_carrier_event **events);
 
 /**
  * @brief Sends a reply to a client
  *
- * Sends a reply packet to a client associated with descriptor @p cli_id and
- * returns -1 in case of errors, 0 if client has closed the connection,
- * a positive value that indicates the number of bytes sent in case of
- * success
+ * Sends a reply packet to a client associated with descriptor @p cli_id. If
+ * the socket buffer of the client is full, the reply is queued and sent, in
+ * order, once the client drains it. Returns -1 in case of errors, e.g. if
+ * the client has closed the connection or has too many replies queued, the
+ * number of bytes sent or queued in case of success
  *
  * @param c pointer to channel data structure of the daemon
  * @param rep pointer to a reply packet that will be sent to the client
@@ -96,51 +139,34 @@ void rtf_carrier_update(struct rtf_carrier *c);
 int rtf_carrier_send(struct rtf_carrier *c, struct rtf_reply *rep, int cli_id);
 
 /**
- * @brief Returns the highest number of client connection descriptor
+ * @brief Sends a reply followed by a variable-length body to a client
  *
- * Return the highest number of valid client connection among all
- * the possible set of descriptor
- *
- * @param c pointer to channel data structure of the daemon
- * @return the highest number of descriptor [0-SET_MAX_SIZE]
- */
-int rtf_carrier_get_conn(struct rtf_carrier *c);
-
-/**
- * @brief Returns the last request made by the client
- *
- * Returns the last request made by the client associated with descriptor
- * @p cli_id, as a structure of type rtf_request.
- *
- * @param c pointer to channel data structure of the daemon
- * @param cli_id id descriptor of the client
- * @return copy of request data structure
- */
-struct rtf_request rtf_carrier_get_req(struct rtf_carrier *c, int cli_id);
-
-/**
- * @brief Checks if given client has sent something
- *
- * Checks if the client associated with descriptor @p cli_id has been sent
- * a request during the last daemon loop. Returns 1 if something was sent
- * or 0 otherwise
+ * Sends a reply packet to a client associated with descriptor @p cli_id,
+ * immediately followed by @p size bytes of data. The data are copied, what
+ * does not fit the socket buffer of the client is sent later without blocking
+ * the daemon. Returns -1 in case of errors, the number of bytes sent or
+ * queued in case of success
  *
  * @param c pointer to channel data structure of the daemon
+ * @param rep pointer to a reply packet that will be sent to the client
+ * @param data pointer to the data that follow the reply
+ * @param size number of bytes of data
  * @param cli_id id descriptor of the client
- * @return 1 if something was sent, 0 otherwise
+ * @return the number of byte sent in case of success
  */
-int rtf_carrier_is_updated(struct rtf_carrier *c, int cli_id);
+int rtf_carrier_send_data(struct rtf_carrier *c, struct rtf_reply *rep,
+    void *data, size_t size, int cli_id);
 
 /**
- * @brief Clears the request of @p cli_id
+ * @brief Returns the upper bound of client connection descriptors
  *
- * Reset the client request, so that the request will be recognized
- * as served
+ * Return the number of slots in the client table, so that every valid client
+ * connection descriptor is lower than the returned value
  *
  * @param c pointer to channel data structure of the daemon
- * @param cli_id id descriptor of the client
+ * @return the number of client slots
  */
-void rtf_carrier_req_clear(struct rtf_carrier *c, int cli_id);
+int rtf_carrier_get_conn(struct rtf_carrier *c);
 
 /**
  * @brief Returns the current state of the client
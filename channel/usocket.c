@@ -11,11 +11,14 @@
 #include "logger.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 
 // ---------------------------------------------
@@ -26,7 +29,7 @@
  * @internal
  *
  * Creates a server unix-domain-socket and initializes the communication
- * data structure with an empty fd-set and the given socket descriptor.
+ * data structure with no epoll instance and the given socket descriptor.
  * Returns -1 if socket creation fails, 0 otherwise.
  *
  * @endinternal
@@ -42,9 +45,10 @@ int usocket_init(struct usocket *us, int socktype)
         return -1;
 
     us->socket = sock;
-    us->conn_set_max = 0;
     us->filepath = NULL;
-    FD_ZERO(&(us->conn_set));
+    us->epoll_fd = -1;
+    us->ucred_max = 0;
+    us->ucredp = NULL;
     return 0;
 }
 
@@ -77,13 +81,14 @@ int usocket_connect(struct usocket *us, char *filepath)
  * Receives @p size data from the socket contained in @p us and copies it in @p
  * elem buffer. Returns -1 in case of errors, 0 if server has closed the
  * connection, a positive value that indicates the number of bytes received in
- * case of success
+ * case of success. Waits for the whole @p size, so that a message is never
+ * split across two calls when several of them are queued on the socket.
  *
  * @endinternal
  */
 int usocket_recv(struct usocket *us, void *elem, size_t size)
 {
-    return recv(us->socket, elem, size, 0);
+    return recv(us->socket, elem, size, MSG_WAITALL);
 }
 
 /**
@@ -98,7 +103,7 @@ int usocket_recv(struct usocket *us, void *elem, size_t size)
  */
 int usocket_send(struct usocket *us, void *elem, size_t size)
 {
-    return send(us->socket, elem, size, 0);
+    return send(us->socket, elem, size, MSG_NOSIGNAL);
 }
 
 // ---------------------------------------------
@@ -172,9 +177,8 @@ int usocket_accept(struct usocket *us)
 /**
  * @internal
  *
- * Receives @p size data from one of the fd-set contained in @p us and copies it
- * in
- * @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
+ * Receives @p size data from one of the descriptors watched by @p us and copies
+ * it in @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
  * connection, a positive value that indicates the number of bytes received in
  * case of success
  *
@@ -188,16 +192,108 @@ int usocket_recvfrom(struct usocket *us, void *elem, size_t size, int i)
 /**
  * @internal
  *
- * Sends @p size data from one of the fd-set contained in @p us copying from @p
- * elem buffer. Returns -1 in case of errors, 0 if client has closed the
+ * Sends @p size data to one of the descriptors watched by @p us copying from
+ * @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
  * connection, a positive value that indicates the number of bytes sent in case
- * of success
+ * of success. A client that has gone away yields EPIPE, not a SIGPIPE.
  *
  * @endinternal
  */
 int usocket_sendto(struct usocket *us, void *elem, size_t size, int i)
 {
-    return send(i, elem, size, 0);
+    return send(i, elem, size, MSG_NOSIGNAL);
+}
+
+/**
+ * @internal
+ *
+ * Returns the milliseconds left before @p deadline, 0 if it has expired
+ *
+ * @endinternal
+ */
+static int usocket_ms_left(struct timespec *deadline)
+{
+    struct timespec now;
+    long ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (deadline->tv_sec - now.tv_sec) * 1000 +
+         (deadline->tv_nsec - now.tv_nsec) / 1000000;
+
+    return ms > 0 ? ms : 0;
+}
+
+/**
+ * @internal
+ *
+ * Sends a header and a body with a single sendmsg() whenever possible. Partial
+ * writes can happen with large bodies on non-blocking descriptors, so the
+ * remaining data is sent once the descriptor becomes writable again. The
+ * timeout bounds the whole send, so that a client that drains its socket
+ * slowly cannot stall the caller for a timeout per chunk.
+ *
+ * @endinternal
+ */
+int usocket_sendallto(struct usocket *us, void *head, size_t hsize, void *body,
+    size_t size, int i, int timeout)
+{
+    struct iovec iov[2] = {{head, hsize}, {body, size}};
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2};
+    struct pollfd pfd = {.fd = i, .events = POLLOUT};
+    struct timespec deadline;
+    size_t sent = 0;
+    ssize_t n;
+    int left = -1;
+
+    if (timeout >= 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000L;
+
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+    }
+
+    while (msg.msg_iovlen > 0)
+    {
+        n = sendmsg(i, &msg, MSG_NOSIGNAL);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if (timeout >= 0 && (left = usocket_ms_left(&deadline)) == 0)
+                return -1;
+
+            if (poll(&pfd, 1, left) <= 0)
+                return -1;
+            continue;
+        }
+        else if (n < 0)
+        {
+            return -1;
+        }
+
+        sent += n;
+
+        // skip what has been sent
+        while (msg.msg_iovlen > 0 && (size_t) n >= msg.msg_iov->iov_len)
+        {
+            n -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+
+        if (msg.msg_iovlen > 0)
+        {
+            msg.msg_iov->iov_base = (char *) msg.msg_iov->iov_base + n;
+            msg.msg_iov->iov_len -= n;
+        }
+    }
+
+    return sent;
 }
 
 /**
@@ -251,98 +347,104 @@ int usocket_timeout(struct usocket *us, int ms)
 /**
  * @internal
  *
- * Gets the current max number of descriptor in fd-set. In case fd-set is
- * empty or someway the greater descriptor is lower than the main socket,
- * the main socket descriptor number is returned.
+ * Creates the epoll instance in @p us and places the main socket into the
+ * watched set. The main socket is watched in level-triggered mode, so that
+ * pending connections not accepted in one round are reported again.
  *
  * @endinternal
  */
-int usocket_get_maxfd(struct usocket *us)
+int usocket_prepare_recv(struct usocket *us)
 {
-    return us->conn_set_max > us->socket ? us->conn_set_max : us->socket;
-}
+    struct epoll_event ev;
 
-/**
- * @internal
- *
- * Initialize the fd-set in @p us and place the main socket into the set.
- *
- * @endinternal
- */
-void usocket_prepare_recv(struct usocket *us)
-{
-    FD_ZERO(&(us->conn_set));
-    FD_SET(us->socket, &(us->conn_set));
-    us->conn_set_max = us->socket;
+    us->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (us->epoll_fd < 0)
+        return -1;
+
+    if (usocket_nonblock(us) < 0)
+        return -1;
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.fd = us->socket;
+
+    return epoll_ctl(us->epoll_fd, EPOLL_CTL_ADD, us->socket, &ev);
 }
 
 /**
  * @internal
  *
- * Put the server waiting for data on fd-set and wakes up the server if one
- * or more client has been communicating with the server. For each client that
- * has been sent data, place @p size data (if available) in the the buffer @p
- * data. Also returns the number of byte received for all client in @p nrecv.
- * Returns 0 in case of success, -1 if errors occurred
+ * Put the server waiting on the epoll instance and wakes up the server if one
+ * or more client has been communicating with the server. New connections are
+ * accepted until the listen backlog is empty, while client descriptors that
+ * became readable (or writable, if watched for it) are placed in @p ready.
+ * Returns the number of ready descriptors, -1 if errors occurred
  *
  * @endinternal
  */
-int usocket_recvall(struct usocket *us, void *data, int nrecv[SET_MAX_SIZE],
-    size_t size)
+int usocket_recvall(struct usocket *us, int ready[EPOLL_MAX_EVENTS],
+    int timeout)
 {
-    int i;
-    fd_set temp_conn_set;
+    int i, n, nready;
+    struct epoll_event events[EPOLL_MAX_EVENTS];
 
-    FD_ZERO(&temp_conn_set);
-    temp_conn_set = us->conn_set;
+    n = epoll_wait(us->epoll_fd, events, EPOLL_MAX_EVENTS, timeout);
 
-    if (select(us->conn_set_max + 1, &temp_conn_set, 0, 0, 0) < 0)
-        return -1;
+    if (n < 0)
+        return errno == EINTR ? 0 : -1;
 
-    for (i = 0; i <= us->conn_set_max; i++)
+    for (i = 0, nready = 0; i < n; i++)
     {
-        if (!FD_ISSET(i, &temp_conn_set))
-            continue;
-
-        if (i == us->socket)
+        if (events[i].data.fd == us->socket)
         {
-            nrecv[i] = usocket_add_connections(us);
+            while (usocket_add_connections(us) >= 0)
+                ;
             continue;
         }
 
-        nrecv[i] = recv(i, data + (i * size), size, 0);
-
-        if (!nrecv[i])
-        {
-            nrecv[i] = -1;
-            FD_CLR(i, &(us->conn_set));
-        }
+        ready[nready++] = events[i].data.fd;
     }
 
-    return 0;
+    return nready;
 }
 
 /**
  * @internal
  *
- * Accept a new connection and add the communication description to the
- * fd set of @p us. Return the socket descriptor number in case of success or
- * -1 in case of error.
+ * Accept a new connection and add the communication descriptor to the
+ * epoll instance of @p us, watching it in edge-triggered mode. Return the
+ * socket descriptor number in case of success or -1 in case of error.
  *
  * @endinternal
  */
 int usocket_add_connections(struct usocket *us)
 {
-    int newfd = usocket_accept(us);
+    struct epoll_event ev;
+    int newfd;
+
+    newfd = accept4(us->socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
     if (newfd < 0)
         return -1;
 
     if (usocket_get_credentials(us, newfd) < 0)
+    {
+        close(newfd);
         return -1;
+    }
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = newfd;
 
-    FD_SET(newfd, &(us->conn_set));
-    us->conn_set_max = us->conn_set_max > newfd ? us->conn_set_max : newfd;
+    if (epoll_ctl(us->epoll_fd, EPOLL_CTL_ADD, newfd, &ev) < 0)
+    {
+        LOG(ERR, "Unable to watch descriptor %d: %s. \n", newfd,
+            strerror(errno));
+        usocket_remove_connection(us, newfd);
+        return -1;
+    }
 
     return newfd;
 }
@@ -350,13 +452,40 @@ int usocket_add_connections(struct usocket *us)
 /**
  * @internal
  *
- * Removes given @p fd from the fd-set of @p us
+ * Watches @p fd also for writability, or stops doing it, keeping the events
+ * set by usocket_add_connections()
+ *
+ * @endinternal
+ */
+int usocket_watch_send(struct usocket *us, int fd, int on)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (on ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+
+    return epoll_ctl(us->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/**
+ * @internal
+ *
+ * Removes given @p fd from the epoll instance of @p us, frees its credentials
+ * and closes it
  *
  * @endinternal
  */
 void usocket_remove_connection(struct usocket *us, int fd)
 {
-    FD_CLR(fd, &(us->conn_set));
+    epoll_ctl(us->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    if (fd < us->ucred_max)
+    {
+        free(us->ucredp[fd]);
+        us->ucredp[fd] = NULL;
+    }
+
     close(fd);
 }
 
@@ -370,7 +499,32 @@ void usocket_remove_connection(struct usocket *us, int fd)
 int usocket_get_credentials(struct usocket *us, int fd)
 {
     struct ucred *ucredp;
+    struct ucred **ucred_new;
     socklen_t len = sizeof(struct ucred);
+    int ucred_max;
+
+    // grow the credentials array so that it can be indexed by descriptor
+    if (fd >= us->ucred_max)
+    {
+        ucred_max = us->ucred_max ? us->ucred_max : BACKLOG_MAX;
+
+        while (ucred_max <= fd)
+            ucred_max *= 2;
+
+        ucred_new = realloc(us->ucredp, ucred_max * sizeof(struct ucred *));
+
+        if (ucred_new == NULL)
+        {
+            LOG(ERR, "Unable to allocate ucred array. %s. \n",
+                strerror(errno));
+            return -1;
+        }
+
+        memset(ucred_new + us->ucred_max, 0,
+            (ucred_max - us->ucred_max) * sizeof(struct ucred *));
+        us->ucredp = ucred_new;
+        us->ucred_max = ucred_max;
+    }
 
     ucredp = calloc(1, len);
 
@@ -384,6 +538,7 @@ int usocket_get_credentials(struct usocket *us, int fd)
     if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, ucredp, &len) == -1)
     {
         LOG(ERR, "Unable to get credentials: %s. \n", strerror(errno));
+        free(ucredp);
         return -1;
     }
 
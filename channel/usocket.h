@@ -12,7 +12,7 @@
 
 #define _GNU_SOURCE
 
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -23,26 +23,25 @@
 #define TCP SOCK_STREAM
 #define UDP SOCK_DGRAM
 
-#define SELECT_MAX_WAIT 50
 #define BACKLOG_MAX 128
-#define SET_MAX_SIZE FD_SETSIZE
+#define EPOLL_MAX_EVENTS 64
 
 /**
  * @brief Contains descriptors needed to implement a client server communication
  *
  * The structure usocket contains a unix domain socket descriptor,
- * the filepath string to which the socket is binded and a file-descriptor
- * sets that contains all sockets used to communicate with clients. The
- * structure can be used both by clients and servers. Client will use only the
- * single socket descriptor while server will use also the file descriptor set
+ * the filepath string to which the socket is binded and an epoll instance
+ * that watches all sockets used to communicate with clients. The structure
+ * can be used both by clients and servers. Client will use only the single
+ * socket descriptor while server will use also the epoll instance
  */
 struct usocket
 {
     int socket; /** Unix-domain socket descriptor */
     char *filepath; /** Path which unix-socket is binded */
-    int conn_set_max; /** Current max number of descriptor */
-    fd_set conn_set; /** Set of descriptors to listen */
-    struct ucred *ucredp[SET_MAX_SIZE]; /** Credentials for connected clients */
+    int epoll_fd; /** Epoll instance that watches server descriptors */
+    int ucred_max; /** Current size of the credentials array */
+    struct ucred **ucredp; /** Credentials for connected clients */
 };
 
 // ---------------------------------------------
@@ -53,7 +52,7 @@ struct usocket
  * @brief Create an unix domain socket
  *
  * Creates a server unix-domain-socket and initializes the communication
- * data structure with an empty fd-set and the given socket descriptor.
+ * data structure with no epoll instance and the given socket descriptor.
  * Returns -1 if socket creation fails, 0 otherwise.
  *
  * @param us pointer to usocket struct that will be initialized with sock info
@@ -117,13 +116,12 @@ int usocket_accept(struct usocket *us);
 /**
  * @brief Recvs data from a connected client
  *
- * Receives @p size data from one of the fd-set contained in @p us and copies it
- * in
- * @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
+ * Receives @p size data from one of the descriptors watched by @p us and copies
+ * it in @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
  * connection, a positive value that indicates the number of bytes received in
  * case of success
  *
- * @param us pointer to usocket structure that contains the descriptors set
+ * @param us pointer to usocket structure that contains the epoll instance
  * @param elem pointer to elem to which copy data received
  * @param size number of bytes to receive
  * @param i the number of descriptor to receive data
@@ -133,18 +131,40 @@ int usocket_recvfrom(struct usocket *us, void *elem, size_t size, int i);
 /**
  * @brief Sends data to a connected client
  *
- * Sends @p size data to one of the fd-set contained in @p us copying from @p
- * elem buffer. Returns -1 in case of errors, 0 if client has closed the
+ * Sends @p size data to one of the descriptors watched by @p us copying from
+ * @p elem buffer. Returns -1 in case of errors, 0 if client has closed the
  * connection, a positive value that indicates the number of bytes sent in case
  * of success
  *
- * @param us pointer to usocket structure that contains the descriptors set
+ * @param us pointer to usocket structure that contains the epoll instance
  * @param elem pointer to elem from which copy data to send off
  * @param size number of bytes to send
  * @param i the number of descriptor to send data
  */
 int usocket_sendto(struct usocket *us, void *elem, size_t size, int i);
 
+/**
+ * @brief Sends a header and a body of data to a connected client
+ *
+ * Sends @p hsize bytes from @p head followed by @p size bytes from @p body to
+ * the descriptor @p i, in a single call whenever possible. Since client
+ * descriptors are non-blocking, if the client is not draining its socket it
+ * waits until the whole message is sent, but for at most @p timeout
+ * milliseconds overall (-1 waits forever). Returns -1 in case of errors or
+ * timeouts, the number of bytes sent otherwise.
+ *
+ * @param us pointer to usocket structure that contains the epoll instance
+ * @param head pointer to the header to send off
+ * @param hsize number of bytes of the header
+ * @param body pointer to the body to send off
+ * @param size number of bytes of the body
+ * @param i the number of descriptor to send data
+ * @param timeout max milliseconds to spend in sending the whole message
+ * @return -1 in case of errors, the number of bytes sent otherwise
+ */
+int usocket_sendallto(struct usocket *us, void *head, size_t hsize, void *body,
+    size_t size, int i, int timeout);
+
 /**
  * @brief Sets the main socket as non-blocking
  *
@@ -177,62 +197,71 @@ int usocket_block(struct usocket *us);
 int usocket_timeout(struct usocket *us, int ms);
 
 /**
- * @brief Get the current max number of descriptor in set
+ * @brief Initializes the epoll instance
  *
- * Gets the current max number of descriptor in fd-set. In case fd-set is
- * empty or someway the greater descriptor is lower than the main socket,
- * the main socket descriptor number is returned.
+ * Creates the epoll instance in @p us and places the main socket into the
+ * watched set. Client descriptors accepted later on are watched in
+ * edge-triggered mode. Returns 0 in case of success, -1 otherwise.
  *
- * @param us pointer to usocket structure that contains the set
- * @return an integer number representing the maximum descriptor number
+ * @param us pointer to usocket structure that contains the main socket
+ * @return 0 in case of success, -1 otherwise
  */
-int usocket_get_maxfd(struct usocket *us);
+int usocket_prepare_recv(struct usocket *us);
 
 /**
- * @brief Initializes the descriptor set
- *
- * Initialize the fd-set in @p us and place the main socket into the set.
- *
- * @param us pointer to usocket structure that contains the empty set
+ * @brief Put server waiting for communication and return ready descriptors
+ *
+ * Put the server waiting on the epoll instance for at most @p timeout
+ * milliseconds (-1 waits forever) and wakes up the server if one or more
+ * client has been communicating with the server. Incoming connections are
+ * accepted internally. The descriptors of clients that have sent data,
+ * closed the connection or became writable while watched for it are placed in
+ * @p ready. Since descriptors are watched
+ * in edge-triggered mode, the caller must read from each of them until the
+ * read would block. Returns the number of ready descriptors, -1 on errors.
+ *
+ * @param us pointer to structure that contains the epoll instance
+ * @param ready array that will contain the ready client descriptors
+ * @param timeout maximum number of milliseconds to wait, -1 to block
+ * @return -1 in case of errors, the number of ready descriptors otherwise
  */
-void usocket_prepare_recv(struct usocket *us);
+int usocket_recvall(struct usocket *us, int ready[EPOLL_MAX_EVENTS],
+    int timeout);
 
 /**
- * @brief Put server waiting for communication and return received data
+ * @brief Accepts a new connection and watches it for incoming data
  *
- * Put the server waiting for data on fd-set and wakes up the server if one
- * or more client has been communicating with the server. For each client that
- * has been sent data, place @p size data (if available) in the the buffer @p
- * data. Also returns the number of byte received for all client in @p nrecv.
- * Returns 0 in case of success, -1 if errors occurred
+ * Accept a new connection and add the communication descriptor to the
+ * epoll instance of @p us. The new descriptor is set as non-blocking.
+ * Return the socket descriptor number in case of success or -1 in case of
+ * error.
  *
- * @param us pointer to structure that contains descriptors set
- * @param data pointer to array of generic type used to store received data
- * @param nrecv array of integers that will contain the number of bytes received
- * @size maximum number of byte receiveable from each descriptor
- * @return -1 in case of errors, 0 in case of success
+ * @param us pointer to usocket structure
+ * @return -1 in case of errors, the new socket descriptor otherwise
  */
-int usocket_recvall(struct usocket *us, void *data, int nrecv[SET_MAX_SIZE],
-    size_t size);
+int usocket_add_connections(struct usocket *us);
 
 /**
- * @brief Accepts a new connection and updates fd set
+ * @brief Watches a client descriptor for writability
  *
- * Accept a new connection and add the communication description to the
- * fd set of @p us. Return the socket descriptor number in case of success or
- * -1 in case of error.
+ * Makes the epoll instance of @p us report @p fd also when it becomes
+ * writable, if @p on is not zero, or only when it becomes readable otherwise.
+ * Used to resume sending data that did not fit the socket buffer.
  *
- * @param us pointer to usocket structure
- * @return -1 in case of errors, the new socket descriptor otherwise
+ * @param us pointer to usocket structure that contains the epoll instance
+ * @param fd descriptor of the client
+ * @param on whether the descriptor must be watched for writability
+ * @return 0 in case of success, -1 otherwise
  */
-int usocket_add_connections(struct usocket *us);
+int usocket_watch_send(struct usocket *us, int fd, int on);
 
 /**
  * @brief Removes given descriptor
  *
- * Removes given @p fd from the fd-set of @p us
+ * Removes given @p fd from the epoll instance of @p us, releases its
+ * credentials and closes it
  *
- * @param us pointer to usocket structure that contains fd-set to modify
+ * @param us pointer to usocket structure that contains the epoll instance
  * @param fd descriptor number that will be removed
  */
 void usocket_remove_connection(struct usocket *us, int fd);
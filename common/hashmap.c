@@ -0,0 +1,252 @@
+/**
+ * @file hashmap.c
+ * @brief Contains the implementation of a hash map of any_t
+ *
+ */
+
+#include "hashmap.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+#define HMAP_IBITS 4 // buckets allocated at the first insertion (log2)
+
+// -----------------------------------------------------
+// PRIVATE METHOD
+// -----------------------------------------------------
+
+/**
+ * @internal
+ *
+ * The function allocate count * dimension memory in the heap.
+ * If the system can not allocate memory, an error message
+ * will be placed in the system log and the programs terminate.
+ *
+ * @endinternal
+ */
+static any_t alloc(int count, size_t dimension)
+{
+    any_t ret = calloc(count, dimension);
+
+    // check if operation was performed
+    if (ret != NULL)
+        return ret;
+
+    // print and exit
+    syslog(LOG_ALERT, "The system is out of memory: %s", strerror(errno));
+    exit(-1);
+}
+
+/**
+ * @internal
+ *
+ * Fibonacci hashing: keys are often consecutive (ids, pids), multiplying by
+ * the golden ratio spreads them over all the buckets.
+ *
+ * @endinternal
+ */
+static inline unsigned int hash(uint64_t key, int bits)
+{
+    return (unsigned int) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+/**
+ * @internal
+ *
+ * Moves all the entries in a table with twice the buckets. The entries are
+ * relinked, not reallocated.
+ *
+ * @endinternal
+ */
+static void grow(struct hmap *h)
+{
+    struct hnode **buckets;
+    struct hnode *e;
+    struct hnode *next;
+    unsigned int b;
+    int bits = h->buckets == NULL ? HMAP_IBITS : h->bits + 1;
+
+    buckets = alloc(1 << bits, sizeof(struct hnode *));
+
+    for (int i = 0; h->buckets != NULL && i < (1 << h->bits); i++)
+    {
+        for (e = h->buckets[i]; e != NULL; e = next)
+        {
+            next = e->next;
+            b = hash(e->key, bits);
+            e->next = buckets[b];
+            buckets[b] = e;
+        }
+    }
+
+    free(h->buckets);
+    h->buckets = buckets;
+    h->bits = bits;
+}
+
+// -----------------------------------------------------
+// PUBLIC METHOD
+// -----------------------------------------------------
+
+/**
+ * @internal
+ *
+ * The buckets are allocated lazily by the first insertion.
+ *
+ * @endinternal
+ */
+void hmap_init(struct hmap *h)
+{
+    h->n = 0;
+    h->bits = 0;
+    h->buckets = NULL;
+}
+
+/**
+ * @internal
+ *
+ * Return the number of entries of the hash map.
+ *
+ * @endinternal
+ */
+int hmap_get_size(struct hmap *h)
+{
+    return h->n;
+}
+
+/**
+ * @internal
+ *
+ * Allocates the entry and links it.
+ *
+ * @endinternal
+ */
+void hmap_add(struct hmap *h, uint64_t key, any_t elem)
+{
+    hmap_link(h, alloc(1, sizeof(struct hnode)), key, elem);
+}
+
+/**
+ * @internal
+ *
+ * The entry is put at the head of its bucket. The table is doubled when the
+ * number of entries exceeds the number of buckets.
+ *
+ * @endinternal
+ */
+void hmap_link(struct hmap *h, struct hnode *e, uint64_t key, any_t elem)
+{
+    unsigned int b;
+
+    if (h->buckets == NULL || h->n >= (1 << h->bits))
+        grow(h);
+
+    b = hash(key, h->bits);
+
+    e->key = key;
+    e->elem = elem;
+    e->next = h->buckets[b];
+
+    h->buckets[b] = e;
+    h->n++;
+}
+
+/**
+ * @internal
+ *
+ * Returns the first element found in the bucket of @p key.
+ *
+ * @endinternal
+ */
+any_t hmap_search(struct hmap *h, uint64_t key)
+{
+    struct hnode *e;
+
+    if (h->n == 0)
+        return NULL;
+
+    for (e = h->buckets[hash(key, h->bits)]; e != NULL; e = e->next)
+        if (e->key == key)
+            return e->elem;
+
+    return NULL;
+}
+
+/**
+ * @internal
+ *
+ * Unlinks the matching entry and frees it.
+ *
+ * @endinternal
+ */
+any_t hmap_remove(struct hmap *h, uint64_t key, any_t elem)
+{
+    struct hnode *e = hmap_unlink(h, key, elem);
+    any_t ret;
+
+    if (e == NULL)
+        return NULL;
+
+    ret = e->elem;
+    free(e);
+
+    return ret;
+}
+
+/**
+ * @internal
+ *
+ * Unlinks the matching entry from its bucket. The table is never shrunk.
+ *
+ * @endinternal
+ */
+struct hnode *hmap_unlink(struct hmap *h, uint64_t key, any_t elem)
+{
+    struct hnode **prec;
+    struct hnode *e;
+
+    if (h->n == 0)
+        return NULL;
+
+    prec = &(h->buckets[hash(key, h->bits)]);
+
+    for (e = *prec; e != NULL; prec = &(e->next), e = e->next)
+    {
+        if (e->key != key || (elem != NULL && e->elem != elem))
+            continue;
+
+        *prec = e->next;
+        h->n--;
+
+        return e;
+    }
+
+    return NULL;
+}
+
+/**
+ * @internal
+ *
+ * Frees all the entries and the buckets. The entries provided by the caller
+ * must have been unlinked before.
+ *
+ * @endinternal
+ */
+void hmap_destroy(struct hmap *h)
+{
+    struct hnode *e;
+    struct hnode *next;
+
+    for (int i = 0; h->buckets != NULL && i < (1 << h->bits); i++)
+    {
+        for (e = h->buckets[i]; e != NULL; e = next)
+        {
+            next = e->next;
+            free(e);
+        }
+    }
+
+    free(h->buckets);
+    hmap_init(h);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file hashmap.h
+ * @brief Contains the interface of a hash map of any_t indexed by integer keys
+ *
+ * This file contains the interface of a simple implementation of a chained
+ * hash map that associates integer keys to any_t elements. Multiple elements
+ * can share the same key, so the map can be used also to index a list by a
+ * non-unique attribute. The table doubles its size as elements are added,
+ * keeping the average chain length under one element. In case of critical
+ * error, the system log mechanism is used to warn the user.
+ */
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include "list.h"
+#include <stdint.h>
+
+// ---------------------------------------------
+// DATA STRUCTURES
+// ---------------------------------------------
+
+/**
+ * @brief Represent each entry of the hash map
+ *
+ * The structure contains the key, the element associated to it and the
+ * pointer to the next entry in the same bucket. If next is NULL that entry
+ * is the last one of the bucket.
+ */
+struct hnode
+{
+    struct hnode *next; /** contains the pointer to next entry in bucket */
+    uint64_t key; /** contains the key of the entry */
+    any_t elem; /** contains the void pointer to the element */
+};
+
+/**
+ * @brief Represent the hash map object
+ *
+ * The structure contains the number of entries, the number of bits used to
+ * index the buckets and the buckets themselves. The buckets are allocated
+ * at the first insertion, so an empty map does not use any memory.
+ */
+struct hmap
+{
+    int n; /** contains the number of entries in the map */
+    int bits; /** contains the log2 of the number of buckets */
+    struct hnode **buckets; /** contains the heads of the bucket chains */
+};
+
+// ---------------------------------------------
+// MAIN METHODS
+// ---------------------------------------------
+
+/**
+ * @brief Initialize the hash map in order to be used
+ *
+ * @param h pointer to the hash map to be initialized
+ */
+void hmap_init(struct hmap *h);
+
+/**
+ * @brief Return the number of entries of the hash map
+ *
+ * @param h pointer to the hash map to be used
+ * @return the number of entries or 0 if empty
+ */
+int hmap_get_size(struct hmap *h);
+
+/**
+ * @brief Associate the provided element to the key
+ *
+ * The function allocate memory and add the entry to the map, growing the
+ * table if needed. The same key can be associated to many elements.
+ *
+ * @param h pointer to the hash map to be used
+ * @param key the key of the element
+ * @param elem void pointer to element to be added to the map
+ */
+void hmap_add(struct hmap *h, uint64_t key, any_t elem);
+
+/**
+ * @brief Link the provided entry to the key
+ *
+ * Same as hmap_add(), but the entry is provided by the caller, so no memory
+ * is allocated for it. The entry can be embedded in the element itself.
+ *
+ * @param h pointer to the hash map to be used
+ * @param e pointer to the entry to be linked, not inside any map
+ * @param key the key of the element
+ * @param elem void pointer to element to be added to the map
+ */
+void hmap_link(struct hmap *h, struct hnode *e, uint64_t key, any_t elem);
+
+/**
+ * @brief Search for an element with the given key
+ *
+ * Returns one of the elements associated to @p key, or NULL if no element
+ * is associated to it.
+ *
+ * @param h pointer to the hash map to be used
+ * @param key the key to be searched for
+ * @return pointer to an element with the given key or NULL if not found
+ */
+any_t hmap_search(struct hmap *h, uint64_t key);
+
+/**
+ * @brief Removes an entry from the hash map
+ *
+ * Removes the entry that associates @p key to @p elem and frees it. If
+ * @p elem is NULL, one of the entries with the given key is removed.
+ * Returns the element of the removed entry, or NULL if there is no entry.
+ *
+ * @param h pointer to the hash map to be used
+ * @param key the key of the entry
+ * @param elem the element of the entry or NULL to match any element
+ * @return NULL if no entry was found or the element of the removed entry
+ */
+any_t hmap_remove(struct hmap *h, uint64_t key, any_t elem);
+
+/**
+ * @brief Unlinks an entry from the hash map
+ *
+ * Same as hmap_remove(), but the entry is not freed and is returned. Must be
+ * used for the entries linked with hmap_link().
+ *
+ * @param h pointer to the hash map to be used
+ * @param key the key of the entry
+ * @param elem the element of the entry or NULL to match any element
+ * @return NULL if no entry was found or the unlinked entry
+ */
+struct hnode *hmap_unlink(struct hmap *h, uint64_t key, any_t elem);
+
+/**
+ * @brief Frees all the memory used by the hash map
+ *
+ * The elements are not freed. The entries linked with hmap_link() must be
+ * unlinked before. The map is left empty and can be used again.
+ *
+ * @param h pointer to the hash map to be destroyed
+ */
+void hmap_destroy(struct hmap *h);
+
+#endif
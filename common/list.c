@@ -88,9 +88,9 @@ static struct node_ptr *merge(struct node_ptr *l1, struct node_ptr *l2,
     struct node_ptr *res;
 
     if (l1 == NULL)
-        return l1;
-    else if (l2 == NULL)
         return l2;
+    else if (l2 == NULL)
+        return l1;
 
     if (cmpfun(l1->elem, l2->elem) < 0)
     {
@@ -190,11 +190,25 @@ int list_get_size(struct list *l)
  */
 void list_add_top(struct list *l, any_t elem)
 {
-    struct node_ptr *n = alloc(1, sizeof(struct node_ptr));
+    list_link_top(l, alloc(1, sizeof(struct node_ptr)), elem);
+}
 
+/**
+ * @internal
+ *
+ * Links the node @p n, provided by the caller, at the top of the list
+ *
+ * @endinternal
+ */
+void list_link_top(struct list *l, struct node_ptr *n, any_t elem)
+{
     n->next = l->root;
+    n->prev = NULL;
     n->elem = elem;
 
+    if (l->root != NULL)
+        l->root->prev = n;
+
     l->n++;
     l->root = n;
 }
@@ -212,20 +226,33 @@ void list_add_top(struct list *l, any_t elem)
  */
 struct node_ptr *list_add_sorted(struct list *l, any_t elem,
     int (*cmpfun)(any_t elem1, any_t elem2))
+{
+    return list_link_sorted(l, alloc(1, sizeof(struct node_ptr)), elem,
+        cmpfun);
+}
+
+/**
+ * @internal
+ *
+ * Links the node @p n, provided by the caller, in a sorted-way. Same
+ * ordering of list_add_sorted().
+ *
+ * @endinternal
+ */
+struct node_ptr *list_link_sorted(struct list *l, struct node_ptr *n,
+    any_t elem, int (*cmpfun)(any_t elem1, any_t elem2))
 {
     struct node_ptr *seek;
     struct node_ptr *prec;
-    struct node_ptr *new;
 
     if (list_is_empty(l) || cmpfun(elem, l->root->elem) <= 0)
     {
-        list_add_top(l, elem);
-        return l->root;
+        list_link_top(l, n, elem);
+        return n;
     }
 
     prec = l->root;
-    new = alloc(1, sizeof(struct node_ptr));
-    new->elem = elem;
+    n->elem = elem;
 
     for (seek = l->root->next; seek != NULL && cmpfun(elem, seek->elem) > 0;)
     {
@@ -233,11 +260,15 @@ struct node_ptr *list_add_sorted(struct list *l, any_t elem,
         seek = seek->next;
     }
 
-    prec->next = new;
-    new->next = seek;
+    prec->next = n;
+    n->prev = prec;
+    n->next = seek;
     l->n++;
 
-    return new;
+    if (seek != NULL)
+        seek->prev = n;
+
+    return n;
 }
 
 /**
@@ -260,6 +291,9 @@ any_t list_remove_top(struct list *l)
     l->root = l->root->next;
     l->n--;
 
+    if (l->root != NULL)
+        l->root->prev = NULL;
+
     elem = n->elem;
     free(n);
 
@@ -375,7 +409,16 @@ any_t list_search_elem(struct list *l, any_t elem,
  */
 void list_sort(struct list *l, int (*cmpfun)(any_t elem1, any_t elem2))
 {
+    struct node_ptr *prec = NULL;
+
     merge_sort(&(l->root), cmpfun);
+
+    // merging relinks only the next pointers
+    for (struct node_ptr *n = l->root; n != NULL; n = n->next)
+    {
+        n->prev = prec;
+        prec = n;
+    }
 }
 
 /**
@@ -415,12 +458,55 @@ any_t list_remove(struct list *l, any_t key,
     prec->next = seek->next;
     elem = seek->elem;
 
+    if (seek->next != NULL)
+        seek->next->prev = prec;
+
     l->n--;
     free(seek);
 
     return elem;
 }
 
+/**
+ * @internal
+ *
+ * Unlinks @p node from the list @p l in constant time and frees it. The
+ * caller must ensure that the node is inside the list. Returns the element
+ * that was contained in the node.
+ *
+ * @endinternal
+ */
+any_t list_remove_node(struct list *l, struct node_ptr *node)
+{
+    any_t elem = list_unlink(l, node);
+
+    free(node);
+
+    return elem;
+}
+
+/**
+ * @internal
+ *
+ * Unlinks @p node from the list @p l in constant time, without freeing it.
+ *
+ * @endinternal
+ */
+any_t list_unlink(struct list *l, struct node_ptr *node)
+{
+    if (node->prev != NULL)
+        node->prev->next = node->next;
+    else
+        l->root = node->next;
+
+    if (node->next != NULL)
+        node->next->prev = node->prev;
+
+    l->n--;
+
+    return node->elem;
+}
+
 /**
  * @internal
  *
@@ -28,13 +28,14 @@ typedef void *any_t;
 /**
  * @brief Represent each node of the list
  *
- * The structure node contains the pointer of the next node
- * in the list and the integer element. If next is NULL
- * that node is the last one.
+ * The structure node contains the pointers of the next and the previous
+ * node in the list and the integer element. If next is NULL
+ * that node is the last one, if prev is NULL that node is the first one.
  */
 struct node_ptr
 {
     struct node_ptr *next; /** contains the pointer to next node in list */
+    struct node_ptr *prev; /** contains the pointer to previous node in list */
     any_t elem; /** contains the void pointer to the element */
 };
 
@@ -124,6 +125,33 @@ void list_add_top(struct list *l, any_t elem);
 struct node_ptr *list_add_sorted(struct list *l, any_t elem,
     int (*cmpfun)(any_t elem1, any_t elem2));
 
+/**
+ * @brief Link the provided node to the top of the list
+ *
+ * Same as list_add_top(), but the node is provided by the caller, so no
+ * memory is allocated. The node can be embedded in the element itself.
+ *
+ * @param l pointer to list to be used
+ * @param n pointer to the node to be linked, not inside any list
+ * @param elem void pointer to element to be added to the list
+ */
+void list_link_top(struct list *l, struct node_ptr *n, any_t elem);
+
+/**
+ * @brief Link the provided node to the list in a sorted way
+ *
+ * Same as list_add_sorted(), but the node is provided by the caller, so no
+ * memory is allocated. The node can be embedded in the element itself.
+ *
+ * @param l pointer to list to be used
+ * @param n pointer to the node to be linked, not inside any list
+ * @param elem void pointer to element to be added to the list
+ * @param cmpfun pointer to the function that will be used to compare elements
+ * @return the pointer to the linked node, @p n
+ */
+struct node_ptr *list_link_sorted(struct list *l, struct node_ptr *n,
+    any_t elem, int (*cmpfun)(any_t elem1, any_t elem2));
+
 /**
  * @brief Remove the top element of the list
  *
@@ -225,6 +253,31 @@ void list_sort(struct list *l, int (*cmpfun)(any_t elem1, any_t elem2));
 any_t list_remove(struct list *l, any_t key,
     int (*cmpfun)(any_t elem, any_t key));
 
+/**
+ * @brief Removes the given node from the list
+ *
+ * Unlinks @p node from the list @p l in constant time and frees it. The
+ * caller must ensure that the node is inside the list. Returns the element
+ * that was contained in the node.
+ *
+ * @param l pointer to the list
+ * @param node pointer to the node to be removed
+ * @return pointer to the element contained in the removed node
+ */
+any_t list_remove_node(struct list *l, struct node_ptr *node);
+
+/**
+ * @brief Unlinks the given node from the list
+ *
+ * Same as list_remove_node(), but the node is not freed. Must be used for
+ * the nodes linked with list_link_top() or list_link_sorted().
+ *
+ * @param l pointer to the list
+ * @param node pointer to the node to be unlinked
+ * @return pointer to the element contained in the unlinked node
+ */
+any_t list_unlink(struct list *l, struct node_ptr *node);
+
 /**
  * @brief Initializes an iterator to point at the list root
  *
@@ -0,0 +1,91 @@
+/**
+ * @file retif_shm.h
+ * @brief Layout of the status page shared by the daemon with its readers
+ *
+ * The daemon publishes a snapshot of its scheduling state in a POSIX shared
+ * memory object, so that monitoring tools can read it without sending any
+ * request. The page starts with a header, followed by the client table, the
+ * plugin table, the per-plugin CPU table (cputot entries for each plugin, in
+ * plugin order) and the task table. The same tables, in the same order, are
+ * the body of the reply to RTF_TASKS_SNAPSHOT.
+ *
+ * The page is protected by a sequence lock: the daemon makes the sequence
+ * number odd before writing and even again when done, while readers copy the
+ * data out and retry if the sequence number was odd or changed meanwhile. The
+ * page can only grow; readers remap it when the size in the header exceeds
+ * the size they have mapped.
+ */
+
+#ifndef RETIF_SHM_H
+#define RETIF_SHM_H
+
+#include "retif_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATUS_SHM_NAME "/retif_status"
+#define STATUS_MAGIC 0x52544653 // "RTFS"
+
+struct rtf_status_page
+{
+    uint32_t magic; /** STATUS_MAGIC once the page is initialized */
+    uint32_t seq; /** Sequence number, odd while the daemon is writing */
+    uint64_t size; /** Size of the whole page in bytes */
+    uint32_t nconnected; /** Entries of the client table */
+    uint32_t nplugin; /** Entries of the plugin table */
+    uint32_t ncpu; /** Entries of the CPU table */
+    uint32_t ntask; /** Entries of the task table */
+};
+
+/**
+ * @brief Returns the size of a page holding the given number of entries
+ */
+static inline size_t rtf_status_page_size(uint32_t nconnected,
+    uint32_t nplugin, uint32_t ncpu, uint32_t ntask)
+{
+    return sizeof(struct rtf_status_page) +
+           nconnected * sizeof(struct rtf_client_info) +
+           nplugin * sizeof(struct rtf_plugin_info) +
+           ncpu * sizeof(struct rtf_cpu_info) +
+           ntask * sizeof(struct rtf_task_info);
+}
+
+/**
+ * @brief Returns the client table of the page
+ */
+static inline struct rtf_client_info *rtf_status_clients(
+    struct rtf_status_page *p)
+{
+    return (struct rtf_client_info *) (p + 1);
+}
+
+/**
+ * @brief Returns the plugin table of the page
+ */
+static inline struct rtf_plugin_info *rtf_status_plugins(
+    struct rtf_status_page *p, uint32_t nconnected)
+{
+    return (struct rtf_plugin_info *) (rtf_status_clients(p) + nconnected);
+}
+
+/**
+ * @brief Returns the CPU table of the page
+ */
+static inline struct rtf_cpu_info *rtf_status_cpus(struct rtf_status_page *p,
+    uint32_t nconnected, uint32_t nplugin)
+{
+    return (struct rtf_cpu_info *) (rtf_status_plugins(p, nconnected) +
+                                    nplugin);
+}
+
+/**
+ * @brief Returns the task table of the page
+ */
+static inline struct rtf_task_info *rtf_status_tasks(struct rtf_status_page *p,
+    uint32_t nconnected, uint32_t nplugin, uint32_t ncpu)
+{
+    return (struct rtf_task_info *) (rtf_status_cpus(p, nconnected, nplugin) +
+                                     ncpu);
+}
+
+#endif // RETIF_SHM_H
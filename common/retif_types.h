@@ -10,13 +10,11 @@
 #define PLUGIN_MAX_PATH 1024
 #endif
 
-#ifndef RETIF_CHANNEL_H
-#    define CHANNEL_MAX_SIZE SET_MAX_SIZE
-#endif
-
 typedef uint32_t rtf_id_t;
 typedef uint32_t plgid_t;
 
+#define RTF_BATCH_MAX 65536 // max number of tasks carried by a batch request
+
 enum REQ_TYPE
 {
     RTF_CONNECTION,
@@ -27,10 +25,13 @@ enum REQ_TYPE
     RTF_PLUGIN_CPU_INFO,
     RTF_TASKS_INFO,
     RTF_TASK_INFO,
+    RTF_TASKS_SNAPSHOT,
     RTF_TASK_MONITOR,
     RTF_TASK_CREATE,
+    RTF_TASK_CREATE_BATCH,
     RTF_TASK_MODIFY,
     RTF_TASK_ATTACH,
+    RTF_TASK_ATTACH_BATCH,
     RTF_TASK_DETACH,
     RTF_TASK_DESTROY,
     RTF_DECONNECTION
@@ -52,14 +53,20 @@ enum REP_TYPE
     RTF_TASKS_INFO_OK,
     RTF_TASK_INFO_OK,
     RTF_TASK_INFO_ERR,
+    RTF_TASKS_SNAPSHOT_OK,
+    RTF_TASKS_SNAPSHOT_ERR,
     RTF_TASK_CREATE_OK,
     RTF_TASK_CREATE_PART,
     RTF_TASK_CREATE_ERR,
+    RTF_TASK_CREATE_BATCH_OK,
+    RTF_TASK_CREATE_BATCH_ERR,
     RTF_TASK_MODIFY_OK,
     RTF_TASK_MODIFY_PART,
     RTF_TASK_MODIFY_ERR,
     RTF_TASK_ATTACH_OK,
     RTF_TASK_ATTACH_ERR,
+    RTF_TASK_ATTACH_BATCH_OK,
+    RTF_TASK_ATTACH_BATCH_ERR,
     RTF_TASK_DETACH_OK,
     RTF_TASK_DETACH_ERR,
     RTF_TASK_DESTROY_OK,
@@ -96,6 +103,7 @@ struct rtf_params
     uint32_t priority; // priority of task [LOW_PRIO, HIGH_PRIO]
     char sched_plugin[PLUGIN_MAX_NAME]; // preferenced plugin to be used
     uint8_t ignore_admission; // preference to avoid test
+    uint32_t numa_node; // preferred NUMA node plus one, 0 for none
 };
 
 struct rtf_client_info
@@ -111,6 +119,7 @@ struct rtf_task_info
     int period;
     float util;
     int pluginid;
+    uint32_t id; // reservation id
 };
 struct rtf_plugin_info
 {
@@ -138,9 +147,52 @@ struct rtf_desc
     rtf_id_t rsvid;
 };
 
+struct rtf_modify
+{
+    rtf_id_t rsvid;
+    struct rtf_params param;
+};
+
+/**
+ * Header of a batch request, followed on the channel by @p num task params
+ * (create) or @p num ids (attach). The reply has the same header, followed by
+ * @p num reservation ids and then @p num results, one int each.
+ */
+struct rtf_batch_info
+{
+    uint32_t num;
+};
+
+// largest body that can follow a request
+#define RTF_BODY_MAX (RTF_BATCH_MAX * sizeof(struct rtf_params))
+
+// body of the reply to a batch of @p num tasks
+#define RTF_BATCH_SIZE(num) ((num) * (sizeof(rtf_id_t) + sizeof(int)))
+
+/**
+ * Header of a snapshot reply, followed on the channel by @p size bytes that
+ * hold the client, plugin, CPU and task tables (see retif_shm.h)
+ */
+struct rtf_snapshot_info
+{
+    uint32_t size;
+    uint32_t nconnected;
+    uint32_t nplugin;
+    uint32_t ncpu;
+    uint32_t ntask;
+};
+
+struct rtf_attach_info
+{
+    int cpu; // CPU the thread was attached to
+    int node; // NUMA node of the CPU
+};
+
 struct rtf_request
 {
     enum REQ_TYPE req_type;
+    uint32_t seq; // sequence number, echoed back in the reply
+    uint32_t size; // bytes of the body that follows the request
     union
     {
         struct
@@ -150,12 +202,15 @@ struct rtf_request
         } q;
         struct rtf_ids ids;
         struct rtf_params param;
+        struct rtf_modify modify;
+        struct rtf_batch_info batch;
     } payload;
 };
 
 struct rtf_reply
 {
     enum REP_TYPE rep_type;
+    uint32_t seq; // sequence number of the request being answered
     union
     {
         float response;
@@ -166,6 +221,9 @@ struct rtf_reply
         struct rtf_task_info task;
         struct rtf_plugin_info plugin;
         struct rtf_cpu_info cpu;
+        struct rtf_attach_info attach;
+        struct rtf_batch_info batch;
+        struct rtf_snapshot_info snapshot;
     } payload;
 };
 
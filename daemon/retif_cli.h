@@ -6,11 +6,17 @@ static char doc[] = "ReTif enables simplified access from userspace to "
 static struct argp_option options[] = {
     {"loglevel", 'l', "LEVEL", 0, "Set the logging verbosity level"},
     {"output", 'o', "FILE", 0, "Output to FILE instead of standard output"},
-    {"config", 'c', "CONF.yaml", 0, "Configuration file"}, {0}};
+    {"config", 'c', "CONF.yaml", 0, "Configuration file"},
+    {"simulate", 's', 0, 0,
+        "Record the scheduling changes in memory, without applying them"},
+    {"root", 'r', "DIR", 0, "Look for procfs and sysfs files under DIR"},
+    {0}};
 
 struct arguments
 {
     int level;
     char *output_file;
     char *conf_file;
+    int simulate;
+    char *root;
 };
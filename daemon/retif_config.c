@@ -11,35 +11,41 @@
 
 #include "retif_config.h"
 #include "logger.h"
+#include "retif_kernel.h"
 #include "retif_utils.h"
 #include "retif_yaml.h"
 
-int set_rt_kernel_params(conf_system_t *c)
+int set_rt_kernel_params(struct rtf_kernel *k, conf_system_t *c)
 {
     int res = 0;
-    if ((res = file_write_long(PROC_RR_TIMESLICE_FILE, c->rr_timeslice)) != 0)
+    if ((res = rtf_kernel_write_long(k, PROC_RR_TIMESLICE_FILE,
+             c->rr_timeslice)) != 0)
         return res;
-    if ((res = file_write_long(PROC_RT_RUNTIME_FILE, -1)) != 0)
+    if ((res = rtf_kernel_write_long(k, PROC_RT_RUNTIME_FILE, -1)) != 0)
         return res;
     return 0;
 }
 
-int save_rt_kernel_params(struct proc_backup *b)
+int save_rt_kernel_params(struct rtf_kernel *k, struct proc_backup *b)
 {
     int res = 0;
-    if ((res = file_read_long(PROC_RR_TIMESLICE_FILE, &b->rr_timeslice)) != 0)
+    if ((res = rtf_kernel_read_long(k, PROC_RR_TIMESLICE_FILE,
+             &b->rr_timeslice)) != 0)
         return res;
-    if ((res = file_read_long(PROC_RT_RUNTIME_FILE, &b->rt_runtime)) != 0)
+    if ((res = rtf_kernel_read_long(k, PROC_RT_RUNTIME_FILE,
+             &b->rt_runtime)) != 0)
         return res;
     return 0;
 }
 
-int restore_rt_kernel_params(struct proc_backup *b)
+int restore_rt_kernel_params(struct rtf_kernel *k, struct proc_backup *b)
 {
     int res = 0;
-    if ((res = file_write_long(PROC_RR_TIMESLICE_FILE, b->rr_timeslice)) != 0)
+    if ((res = rtf_kernel_write_long(k, PROC_RR_TIMESLICE_FILE,
+             b->rr_timeslice)) != 0)
         return res;
-    if ((res = file_write_long(PROC_RT_RUNTIME_FILE, b->rt_runtime)) != 0)
+    if ((res = rtf_kernel_write_long(k, PROC_RT_RUNTIME_FILE,
+             b->rt_runtime)) != 0)
         return res;
     return 0;
 }
@@ -61,6 +67,10 @@ YAML_PARSER_FN(parse_conf_plugins_item_name, conf_plugin_t *out);
 YAML_PARSER_FN(parse_conf_plugins_item_plugin_path, conf_plugin_t *out);
 YAML_PARSER_FN(parse_conf_plugins_item_priority, conf_plugin_t *out);
 YAML_PARSER_FN(parse_conf_plugins_item_cores, conf_plugin_t *out);
+YAML_PARSER_FN(parse_conf_plugins_item_topology, conf_plugin_t *out);
+YAML_PARSER_FN(parse_conf_plugins_item_placement, conf_plugin_t *out);
+YAML_PARSER_FN(parse_conf_plugins_item_admission, conf_plugin_t *out);
+YAML_PARSER_FN(parse_conf_plugins_item_cgroup, conf_plugin_t *out);
 
 // ====================================================== //
 // ---------------- Function Definitions ---------------- //
@@ -78,6 +88,10 @@ const char key_name[] = "name";
 const char key_plugin[] = "plugin";
 const char key_priority[] = "priority";
 const char key_cores[] = "cores";
+const char key_topology[] = "topology";
+const char key_placement[] = "placement";
+const char key_admission[] = "admission";
+const char key_cgroup[] = "cgroup";
 
 const char key_domain[] = "domain";
 const char key_type[] = "type";
@@ -146,6 +160,10 @@ YAML_PARSER_FN(parse_conf_plugins_item, conf_plugin_t *out)
         YAML_PARSER_MAP_PAIR(key_plugin, parse_conf_plugins_item_plugin_path),
         YAML_PARSER_MAP_PAIR(key_priority, parse_conf_plugins_item_priority),
         YAML_PARSER_MAP_PAIR(key_cores, parse_conf_plugins_item_cores),
+        YAML_PARSER_MAP_PAIR(key_topology, parse_conf_plugins_item_topology),
+        YAML_PARSER_MAP_PAIR(key_placement, parse_conf_plugins_item_placement),
+        YAML_PARSER_MAP_PAIR(key_admission, parse_conf_plugins_item_admission),
+        YAML_PARSER_MAP_PAIR(key_cgroup, parse_conf_plugins_item_cgroup),
     };
     const size_t map_size = sizeof(map) / sizeof(yaml_parser_map_t);
     return yaml_parse_mapping(document, node, map, map_size, out);
@@ -161,6 +179,63 @@ YAML_PARSER_FN(parse_conf_plugins_item_plugin_path, conf_plugin_t *out)
     return yaml_get_string(document, node, &out->plugin_path);
 }
 
+YAML_PARSER_FN(parse_conf_plugins_item_cgroup, conf_plugin_t *out)
+{
+    return yaml_get_string(document, node, &out->cgroup);
+}
+
+YAML_PARSER_FN(parse_conf_plugins_item_topology, conf_plugin_t *out)
+{
+    char *strvalue = NULL;
+    int ret;
+
+    ret = yaml_get_string(document, node, &strvalue);
+    if (ret)
+        return ret;
+
+    if (strcmp(strvalue, "none") == 0)
+        out->topology = TOPOLOGY_NONE;
+    else if (strcmp(strvalue, "core") == 0)
+        out->topology = TOPOLOGY_CORE;
+    else if (strcmp(strvalue, "llc") == 0)
+        out->topology = TOPOLOGY_LLC;
+    else
+        ret = 1;
+
+    free(strvalue);
+    return ret;
+}
+
+YAML_PARSER_FN(parse_conf_plugins_item_placement, conf_plugin_t *out)
+{
+    char *strvalue = NULL;
+    int ret;
+
+    ret = yaml_get_string(document, node, &strvalue);
+    if (ret)
+        return ret;
+
+    ret = parse_placement(strvalue, out) ? 1 : 0;
+
+    free(strvalue);
+    return ret;
+}
+
+YAML_PARSER_FN(parse_conf_plugins_item_admission, conf_plugin_t *out)
+{
+    char *strvalue = NULL;
+    int ret;
+
+    ret = yaml_get_string(document, node, &strvalue);
+    if (ret)
+        return ret;
+
+    ret = parse_admission(strvalue, out) ? 1 : 0;
+
+    free(strvalue);
+    return ret;
+}
+
 YAML_PARSER_FN(parse_conf_plugins_item_priority, conf_plugin_t *out)
 {
     int ret = 0;
@@ -408,9 +483,74 @@ YAML_PARSER_FN(parse_conf_plugins_item_cores, conf_plugin_t *out)
 
 // ---------------------------------------------------------
 
+/**
+ * @internal
+ *
+ * Parses the name of a placement heuristic, optionally followed by
+ * "-decreasing" (e.g. "best-fit-decreasing"). Returns -1 if the name is not
+ * valid, 0 otherwise.
+ *
+ * @endinternal
+ */
+int parse_placement(const char *name, conf_plugin_t *plg)
+{
+    const char *names[] = {
+        [PLACEMENT_WORST_FIT] = "worst-fit",
+        [PLACEMENT_FIRST_FIT] = "first-fit",
+        [PLACEMENT_BEST_FIT] = "best-fit",
+        [PLACEMENT_NEXT_FIT] = "next-fit",
+        [PLACEMENT_HARMONIC] = "harmonic",
+    };
+    size_t len;
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        len = strlen(names[i]);
+
+        if (strncmp(name, names[i], len) != 0)
+            continue;
+
+        if (strcmp(name + len, "") != 0 &&
+            strcmp(name + len, "-decreasing") != 0)
+            continue;
+
+        plg->placement = i;
+        plg->decreasing = name[len] != '\0';
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * Parses the name of a schedulability test: "density", "qpa", "both" or
+ * "opa".
+ * Returns -1 if the name is not valid, 0 otherwise.
+ *
+ * @endinternal
+ */
+int parse_admission(const char *name, conf_plugin_t *plg)
+{
+    if (strcmp(name, "both") == 0)
+        plg->admission = ADMISSION_BOTH;
+    else if (strcmp(name, "density") == 0)
+        plg->admission = ADMISSION_DENSITY;
+    else if (strcmp(name, "qpa") == 0)
+        plg->admission = ADMISSION_QPA;
+    else if (strcmp(name, "opa") == 0)
+        plg->admission = ADMISSION_OPA;
+    else
+        return -1;
+
+    return 0;
+}
+
 bool configuration_valid(configuration_t *conf);
 
-int parse_configuration(configuration_t *conf, const char path[])
+int parse_configuration(struct rtf_kernel *k, configuration_t *conf,
+    const char path[])
 {
     int res = 0;
     yaml_parser_t parser;
@@ -437,6 +577,9 @@ int parse_configuration(configuration_t *conf, const char path[])
         goto end;
     }
 
+    // CPUs are checked against the ones seen by the kernel backend
+    conf->num_of_cpu = k->num_of_cpu;
+
     if (!configuration_valid(conf))
     {
         res = 1;
@@ -458,7 +601,7 @@ bool check_cpus(configuration_t *conf)
     conf_plugin_t *p;
     int *c;
 
-    size_t num_procs = get_nprocs2();
+    size_t num_procs = conf->num_of_cpu;
 
     VECTOR_FOREACH (conf->plugins, p)
     {
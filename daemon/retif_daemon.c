@@ -1,6 +1,7 @@
 #include "retif_daemon.h"
 #include "logger.h"
 #include "retif_utils.h"
+#include <inttypes.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,20 +18,18 @@
  *
  * @endinternal
  */
-static struct rtf_reply req_connection(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_connection(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
+    LOG(INFO, "Received CONNECTION REQ from pid: %d\n", req->payload.ids.pid);
 
-    LOG(INFO, "Received CONNECTION REQ from pid: %d\n", req.payload.ids.pid);
-
-    rtf_carrier_set_pid(&(data->chann), cli_id, req.payload.ids.pid);
+    rtf_carrier_set_pid(&(data->chann), cli_id, req->payload.ids.pid);
     rep.rep_type = RTF_CONNECTION_OK;
 
     LOG(INFO, "%d connected with success. Assigned id: %d\n",
-        req.payload.ids.pid, cli_id);
+        req->payload.ids.pid, cli_id);
 
     return rep;
 }
@@ -39,14 +38,11 @@ static struct rtf_reply req_connections_info(struct rtf_daemon *data,
     int cli_id)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
     int nclients = 0;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-
     LOG(DEBUG, "Received RTF_CONNECTIONS_INFO from client: %d\n", cli_id);
 
-    for (int i = 0; i < CHANNEL_MAX_SIZE; i++)
+    for (int i = 0; i < rtf_carrier_get_conn(&(data->chann)); i++)
         if (data->chann.client[i].pid != 0)
             nclients++;
 
@@ -59,9 +55,6 @@ static struct rtf_reply req_connections_info(struct rtf_daemon *data,
 static struct rtf_reply req_plugins_info(struct rtf_daemon *data, int cli_id)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
 
     LOG(DEBUG, "Received RTF_PLUGINGS_INFO from client: %d\n", cli_id);
 
@@ -74,9 +67,6 @@ static struct rtf_reply req_plugins_info(struct rtf_daemon *data, int cli_id)
 static struct rtf_reply req_tasks_info(struct rtf_daemon *data, int cli_id)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
 
     LOG(DEBUG, "Received RTF_TASKS_INFO from client: %d\n", cli_id);
 
@@ -86,19 +76,18 @@ static struct rtf_reply req_tasks_info(struct rtf_daemon *data, int cli_id)
     return rep;
 }
 
-static struct rtf_reply req_connection_info(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_connection_info(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-    struct rtf_client *client;
     int cdesc;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-    cdesc = req.payload.q.desc;
+    cdesc = req->payload.q.desc;
 
     LOG(DEBUG, "Received RTF_CONNECTION_INFO from client: %d\n", cli_id);
 
-    if (cdesc > CHANNEL_MAX_SIZE || data->chann.client[cdesc].pid == 0)
+    if (cdesc < 0 || cdesc >= rtf_carrier_get_conn(&(data->chann)) ||
+        data->chann.client[cdesc].pid == 0)
     {
         rep.rep_type = RTF_CONNECTION_INFO_ERR;
     }
@@ -112,16 +101,13 @@ static struct rtf_reply req_connection_info(struct rtf_daemon *data, int cli_id)
     return rep;
 }
 
-static struct rtf_reply req_plugin_info(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_plugin_info(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-    struct rtf_client *client;
     int pdesc;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-
-    pdesc = req.payload.q.desc;
+    pdesc = req->payload.q.desc;
 
     LOG(DEBUG, "Received RTF_PLUGIN_INFO from client: %d\n", cli_id);
 
@@ -140,17 +126,14 @@ static struct rtf_reply req_plugin_info(struct rtf_daemon *data, int cli_id)
     return rep;
 }
 
-static struct rtf_reply req_plugin_cpu_info(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_plugin_cpu_info(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-    struct rtf_client *client;
     int pdesc, cpuid;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-
-    pdesc = req.payload.q.desc;
-    cpuid = req.payload.q.id;
+    pdesc = req->payload.q.desc;
+    cpuid = req->payload.q.id;
 
     LOG(DEBUG, "Received RTF_PLUGIN_CPU_INFO from client: %d\n", cli_id);
 
@@ -161,26 +144,25 @@ static struct rtf_reply req_plugin_cpu_info(struct rtf_daemon *data, int cli_id)
     }
     else
     {
+        struct rtf_plugin *plg = &data->sched.plugin[pdesc];
+        int cpu = plg->cpulist[cpuid];
+
         rep.rep_type = RTF_PLUGIN_CPU_INFO_OK;
-        rep.payload.cpu.cpunum = data->sched.plugin[pdesc].cpulist[cpuid];
-        rep.payload.cpu.ntask =
-            data->sched.plugin[pdesc].task_count_percpu[cpuid];
-        rep.payload.cpu.freeu =
-            data->sched.plugin[pdesc].util_free_percpu[cpuid];
+        rep.payload.cpu.cpunum = cpu;
+        rep.payload.cpu.ntask = plg->task_count_percpu[cpu];
+        rep.payload.cpu.freeu = plg->util_free_percpu[cpu];
     }
 
     return rep;
 }
 
-static struct rtf_reply req_task_info(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_info(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-    struct rtf_client *client;
     struct rtf_task *task;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-    task = rtf_taskset_search(&(data->tasks), req.payload.q.desc);
+    task = rtf_taskset_search(&(data->tasks), req->payload.q.desc);
 
     LOG(DEBUG, "Received RTF_TASK_INFO from client: %d\n", cli_id);
 
@@ -196,11 +178,51 @@ static struct rtf_reply req_task_info(struct rtf_daemon *data, int cli_id)
         rep.payload.task.priority = task->schedprio;
         rep.payload.task.period = task->params.period;
         rep.payload.task.pluginid = task->pluginid;
+        rep.payload.task.util = task->acceptedu;
+        rep.payload.task.id = task->id;
     }
 
     return rep;
 }
 
+/**
+ * @internal
+ *
+ * Client wants the whole client, plugin, CPU and task tables at once. They
+ * are taken from the status page, brought up to date first, and sent right
+ * after the reply.
+ *
+ * @endinternal
+ */
+static struct rtf_reply req_tasks_snapshot(struct rtf_daemon *data,
+    int cli_id)
+{
+    struct rtf_reply rep;
+    struct rtf_status_page *p;
+
+    LOG(DEBUG, "Received RTF_TASKS_SNAPSHOT from client: %d\n", cli_id);
+
+    rtf_status_publish(&(data->status), &(data->sched), &(data->chann));
+    p = data->status.page;
+
+    if (p == NULL || data->status.dirty)
+    {
+        rep.rep_type = RTF_TASKS_SNAPSHOT_ERR;
+        return rep;
+    }
+
+    rep.rep_type = RTF_TASKS_SNAPSHOT_OK;
+    rep.payload.snapshot.nconnected = p->nconnected;
+    rep.payload.snapshot.nplugin = p->nplugin;
+    rep.payload.snapshot.ncpu = p->ncpu;
+    rep.payload.snapshot.ntask = p->ntask;
+    rep.payload.snapshot.size =
+        rtf_status_page_size(p->nconnected, p->nplugin, p->ncpu, p->ntask) -
+        sizeof(struct rtf_status_page);
+
+    return rep;
+}
+
 /**
  * @internal
  *
@@ -208,18 +230,16 @@ static struct rtf_reply req_task_info(struct rtf_daemon *data, int cli_id)
  *
  * @endinternal
  */
-static struct rtf_reply req_task_create(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_create(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req)
 {
     int rtf_id, res, pid;
     struct rtf_reply rep;
-    struct rtf_request req;
-
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
 
     LOG(DEBUG, "Received RSV_CREATE REQ from client: %d\n", cli_id);
 
     pid = data->chann.client[cli_id].pid;
-    res = rtf_scheduler_task_create(&(data->sched), &req.payload.param, pid);
+    res = rtf_scheduler_task_create(&(data->sched), &req->payload.param, pid);
     rtf_id = data->sched.last_task_id;
 
     if (res == RTF_NO)
@@ -246,6 +266,87 @@ static struct rtf_reply req_task_create(struct rtf_daemon *data, int cli_id)
     return rep;
 }
 
+/**
+ * @internal
+ *
+ * Makes room for the ids and the results of a batch of @p num tasks in the
+ * body of the batch replies. Returns 0 in case of success, -1 if memory
+ * cannot be allocated.
+ *
+ * @endinternal
+ */
+static int rtf_daemon_batch_reserve(struct rtf_daemon *data, int num)
+{
+    void *batch;
+
+    if (RTF_BATCH_SIZE(num) <= data->batch_size)
+        return 0;
+
+    batch = realloc(data->batch, RTF_BATCH_SIZE(num));
+
+    if (batch == NULL)
+        return -1;
+
+    data->batch = batch;
+    data->batch_size = RTF_BATCH_SIZE(num);
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Client wants to create a set of reservations with a single request. The
+ * ids and the results are sent right after the reply.
+ *
+ * @endinternal
+ */
+static struct rtf_reply req_task_create_batch(struct rtf_daemon *data,
+    int cli_id, struct rtf_request *req, struct rtf_params *params)
+{
+    int num, accepted, pid;
+    rtf_id_t *ids;
+    struct rtf_reply rep;
+
+    num = req->payload.batch.num;
+
+    LOG(DEBUG, "Received RSV_CREATE_BATCH REQ (%d tasks) from client: %d\n",
+        num, cli_id);
+
+    if (num <= 0 || num > RTF_BATCH_MAX ||
+        req->size != num * sizeof(struct rtf_params))
+    {
+        rep.rep_type = RTF_TASK_CREATE_BATCH_ERR;
+        LOG(WARNING, "Invalid batch size: %d\n", num);
+        return rep;
+    }
+
+    if (rtf_daemon_batch_reserve(data, num) < 0)
+    {
+        rep.rep_type = RTF_TASK_CREATE_BATCH_ERR;
+        return rep;
+    }
+
+    // the results follow the ids in the body of the reply
+    ids = data->batch;
+    pid = data->chann.client[cli_id].pid;
+    accepted = rtf_scheduler_task_create_batch(&(data->sched), params, num,
+        pid, ids, (int *) (ids + num));
+
+    if (accepted < 0)
+    {
+        rep.rep_type = RTF_TASK_CREATE_BATCH_ERR;
+        return rep;
+    }
+
+    rep.rep_type = RTF_TASK_CREATE_BATCH_OK;
+    rep.payload.batch.num = num;
+
+    LOG(DEBUG, "Batch processed: %d of %d tasks accepted\n", accepted, num);
+
+    return rep;
+}
+
 /**
  * @internal
  *
@@ -253,20 +354,19 @@ static struct rtf_reply req_task_create(struct rtf_daemon *data, int cli_id)
  *
  * @endinternal
  */
-static struct rtf_reply req_task_modify(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_modify(struct rtf_daemon *data,
+    struct rtf_request *req)
 {
     int res;
     struct rtf_reply rep;
-    struct rtf_request req;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
+    LOG(DEBUG, "Received RSV_MODIFY REQ for rsv: %d\n",
+        req->payload.modify.rsvid);
 
-    LOG(DEBUG, "Received RSV_MODIFY REQ for rsv: %d\n", req.payload.ids.rsvid);
+    res = rtf_scheduler_task_change(&(data->sched), &req->payload.modify.param,
+        req->payload.modify.rsvid);
 
-    res = rtf_scheduler_task_change(&(data->sched), &req.payload.param,
-        req.payload.ids.rsvid);
-
-    if (res == RTF_NO)
+    if (res == RTF_NO || res == RTF_ERROR)
     {
         rep.rep_type = RTF_TASK_MODIFY_ERR;
         LOG(DEBUG, "It is NOT possible to guarantee these parameters!\n");
@@ -292,28 +392,33 @@ static struct rtf_reply req_task_modify(struct rtf_daemon *data, int cli_id)
  *
  * @endinternal
  */
-static struct rtf_reply req_task_attach(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_attach(struct rtf_daemon *data,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
 
     LOG(DEBUG,
         "Received RSV_ATTACH REQ for res: %d. PID: %d will be attached.\n",
-        req.payload.ids.rsvid, req.payload.ids.pid);
+        req->payload.ids.rsvid, req->payload.ids.pid);
 
-    if (rtf_scheduler_task_attach(&(data->sched), req.payload.ids.rsvid,
-            req.payload.ids.pid) < 0)
+    if (rtf_scheduler_task_attach(&(data->sched), req->payload.ids.rsvid,
+            req->payload.ids.pid) < 0)
     {
         rep.rep_type = RTF_TASK_ATTACH_ERR;
         LOG(WARNING, "Unable to attach PID: %d to given task.\n",
-            req.payload.ids.pid);
+            req->payload.ids.pid);
     }
     else
     {
+        struct rtf_task *t =
+            rtf_taskset_search(data->sched.taskset, req->payload.ids.rsvid);
+
+        // the client sets the memory policy of the thread on the node
         rep.rep_type = RTF_TASK_ATTACH_OK;
-        LOG(INFO, "PID: %d attached.\n", req.payload.ids.pid);
+        rep.payload.attach.cpu = t->cpu;
+        rep.payload.attach.node = data->kernel.cpu[t->cpu].node;
+        LOG(INFO, "PID: %d attached to CPU %" PRIu64 ", node %d.\n",
+            req->payload.ids.pid, t->cpu, rep.payload.attach.node);
     }
 
     return rep;
@@ -322,22 +427,73 @@ static struct rtf_reply req_task_attach(struct rtf_daemon *data, int cli_id)
 /**
  * @internal
  *
- * Client wants to detach the flow of execution from the reservation
+ * Client wants to attach a set of flows of execution to their reservations.
+ * The ids and the results are sent right after the reply.
  *
  * @endinternal
  */
-static struct rtf_reply req_task_detach(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_attach_batch(struct rtf_daemon *data,
+    int cli_id, struct rtf_request *req, struct rtf_ids *ids)
 {
+    int num, attached;
+    rtf_id_t *rsvids;
+    int *res;
     struct rtf_reply rep;
-    struct rtf_request req;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
+    num = req->payload.batch.num;
+
+    LOG(DEBUG, "Received RSV_ATTACH_BATCH REQ (%d threads) from client: %d\n",
+        num, cli_id);
+
+    if (num <= 0 || num > RTF_BATCH_MAX ||
+        req->size != num * sizeof(struct rtf_ids))
+    {
+        rep.rep_type = RTF_TASK_ATTACH_BATCH_ERR;
+        LOG(WARNING, "Invalid batch size: %d\n", num);
+        return rep;
+    }
+
+    if (rtf_daemon_batch_reserve(data, num) < 0)
+    {
+        rep.rep_type = RTF_TASK_ATTACH_BATCH_ERR;
+        return rep;
+    }
+
+    rsvids = data->batch;
+    res = (int *) (rsvids + num);
+    attached = rtf_scheduler_task_attach_batch(&(data->sched), ids, num, res);
+
+    rep.rep_type = RTF_TASK_ATTACH_BATCH_OK;
+    rep.payload.batch.num = num;
+
+    for (int i = 0; i < num; i++)
+    {
+        rsvids[i] = ids[i].rsvid;
+        res[i] = res[i] < 0 ? RTF_ERROR : RTF_OK;
+    }
+
+    LOG(INFO, "Batch processed: %d of %d threads attached\n", attached, num);
+
+    return rep;
+}
+
+/**
+ * @internal
+ *
+ * Client wants to detach the flow of execution from the reservation
+ *
+ * @endinternal
+ */
+static struct rtf_reply req_task_detach(struct rtf_daemon *data,
+    struct rtf_request *req)
+{
+    struct rtf_reply rep;
 
     LOG(DEBUG,
         "Received RSV_DETACH REQ for res: %d. The thread will be detached\n",
-        req.payload.ids.rsvid);
+        req->payload.ids.rsvid);
 
-    if (rtf_scheduler_task_detach(&(data->sched), req.payload.ids.rsvid) < 0)
+    if (rtf_scheduler_task_detach(&(data->sched), req->payload.ids.rsvid) < 0)
         rep.rep_type = RTF_TASK_DETACH_ERR;
     else
         rep.rep_type = RTF_TASK_DETACH_OK;
@@ -352,18 +508,16 @@ static struct rtf_reply req_task_detach(struct rtf_daemon *data, int cli_id)
  *
  * @endinternal
  */
-static struct rtf_reply req_task_destroy(struct rtf_daemon *data, int cli_id)
+static struct rtf_reply req_task_destroy(struct rtf_daemon *data,
+    struct rtf_request *req)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
-
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
 
     LOG(DEBUG,
         "Received RSV_DESTROY REQ for res: %d. The thread will be detached\n",
-        req.payload.ids.rsvid);
+        req->payload.ids.rsvid);
 
-    if (rtf_scheduler_task_destroy(&(data->sched), req.payload.ids.rsvid) < 0)
+    if (rtf_scheduler_task_destroy(&(data->sched), req->payload.ids.rsvid) < 0)
         rep.rep_type = RTF_TASK_DESTROY_ERR;
     else
         rep.rep_type = RTF_TASK_DESTROY_OK;
@@ -402,6 +556,7 @@ int rtf_daemon_check_for_fail(struct rtf_daemon *data, int cli_id)
     pid = rtf_carrier_get_pid(&(data->chann), cli_id);
 
     rtf_scheduler_delete(&(data->sched), pid);
+    data->status.dirty = 1;
     rtf_carrier_set_pid(&(data->chann), cli_id, 0);
     rtf_carrier_close(&(data->chann), cli_id);
 
@@ -411,84 +566,98 @@ int rtf_daemon_check_for_fail(struct rtf_daemon *data, int cli_id)
 /**
  * @internal
  *
- * Checks if the client with id @p cli_id has been sent request during the
- * last daemon loop.
- *
- * @endinternal
- */
-int rtf_daemon_check_for_update(struct rtf_daemon *data, int cli_id)
-{
-    int is_updated;
-    enum CLIENT_STATE st;
-
-    is_updated = rtf_carrier_is_updated(&(data->chann), cli_id);
-    st = rtf_carrier_get_state(&(data->chann), cli_id);
-
-    if (st == CONNECTED && is_updated)
-        return 1;
-
-    return 0;
-}
-
-/**
- * @internal
- *
- * Receive a request, process it and sent out the reply
+ * Receive a request, process it and sent out the reply. Batch requests carry
+ * their tasks in @p body, which is NULL for all the other requests.
  *
  * @endinternal
  */
-int rtf_daemon_process_req(struct rtf_daemon *data, int cli_id)
+int rtf_daemon_process_req(struct rtf_daemon *data, int cli_id,
+    struct rtf_request *req, void *body)
 {
     struct rtf_reply rep;
-    struct rtf_request req;
 
-    req = rtf_carrier_get_req(&(data->chann), cli_id);
-
-    switch (req.req_type)
+    switch (req->req_type)
     {
     case RTF_CONNECTION:
-        rep = req_connection(data, cli_id);
+        rep = req_connection(data, cli_id, req);
         break;
     case RTF_CONNECTIONS_INFO:
         rep = req_connections_info(data, cli_id);
         break;
     case RTF_CONNECTION_INFO:
-        rep = req_connection_info(data, cli_id);
+        rep = req_connection_info(data, cli_id, req);
         break;
     case RTF_PLUGINS_INFO:
         rep = req_plugins_info(data, cli_id);
         break;
     case RTF_PLUGIN_INFO:
-        rep = req_plugin_info(data, cli_id);
+        rep = req_plugin_info(data, cli_id, req);
         break;
     case RTF_PLUGIN_CPU_INFO:
-        rep = req_plugin_cpu_info(data, cli_id);
+        rep = req_plugin_cpu_info(data, cli_id, req);
         break;
     case RTF_TASKS_INFO:
         rep = req_tasks_info(data, cli_id);
         break;
     case RTF_TASK_INFO:
-        rep = req_task_info(data, cli_id);
+        rep = req_task_info(data, cli_id, req);
+        break;
+    case RTF_TASKS_SNAPSHOT:
+        rep = req_tasks_snapshot(data, cli_id);
         break;
     case RTF_TASK_CREATE:
-        rep = req_task_create(data, cli_id);
+        rep = req_task_create(data, cli_id, req);
+        break;
+    case RTF_TASK_CREATE_BATCH:
+        rep = req_task_create_batch(data, cli_id, req, body);
         break;
     case RTF_TASK_MODIFY:
-        rep = req_task_modify(data, cli_id);
+        rep = req_task_modify(data, req);
         break;
     case RTF_TASK_ATTACH:
-        rep = req_task_attach(data, cli_id);
+        rep = req_task_attach(data, req);
+        break;
+    case RTF_TASK_ATTACH_BATCH:
+        rep = req_task_attach_batch(data, cli_id, req, body);
         break;
     case RTF_TASK_DETACH:
-        rep = req_task_detach(data, cli_id);
+        rep = req_task_detach(data, req);
         break;
     case RTF_TASK_DESTROY:
-        rep = req_task_destroy(data, cli_id);
+        rep = req_task_destroy(data, req);
         break;
     default:
         rep.rep_type = RTF_REQUEST_ERR;
     }
 
+    switch (req->req_type)
+    {
+    case RTF_CONNECTION:
+    case RTF_TASK_CREATE:
+    case RTF_TASK_CREATE_BATCH:
+    case RTF_TASK_MODIFY:
+    case RTF_TASK_ATTACH:
+    case RTF_TASK_ATTACH_BATCH:
+    case RTF_TASK_DETACH:
+    case RTF_TASK_DESTROY:
+        data->status.dirty = 1;
+        break;
+    default:
+        break;
+    }
+
+    rep.seq = req->seq;
+
+    if (rep.rep_type == RTF_TASKS_SNAPSHOT_OK)
+        return rtf_carrier_send_data(&(data->chann), &rep,
+            rtf_status_clients(data->status.page),
+            rep.payload.snapshot.size, cli_id);
+
+    if (rep.rep_type == RTF_TASK_CREATE_BATCH_OK ||
+        rep.rep_type == RTF_TASK_ATTACH_BATCH_OK)
+        return rtf_carrier_send_data(&(data->chann), &rep, data->batch,
+            RTF_BATCH_SIZE(rep.payload.batch.num), cli_id);
+
     return rtf_carrier_send(&(data->chann), &rep, cli_id);
 }
 
@@ -500,22 +669,27 @@ int rtf_daemon_process_req(struct rtf_daemon *data, int cli_id)
  *
  * @endinternal
  */
-int rtf_daemon_handle_req(struct rtf_daemon *data, int cli_id)
+int rtf_daemon_handle_req(struct rtf_daemon *data,
+    struct rtf_carrier_event *ev)
 {
+    int cli_id = ev->cli_id;
     int sent;
     int res;
 
     if ((res = rtf_daemon_check_for_fail(data, cli_id)) != 0)
         return res;
 
-    if ((res = rtf_daemon_check_for_update(data, cli_id)) == 0)
+    if (ev->req == NULL)
         return 0;
 
-    sent = rtf_daemon_process_req(data, cli_id);
-    rtf_carrier_req_clear(&(data->chann), cli_id);
+    sent = rtf_daemon_process_req(data, cli_id, ev->req, ev->body);
 
+    // the client is not reported as ready again, so clean it up right away
     if (sent <= 0)
+    {
         rtf_carrier_set_state(&(data->chann), cli_id, ERROR);
+        return rtf_daemon_check_for_fail(data, cli_id);
+    }
 
     return 0;
 }
@@ -534,19 +708,23 @@ int rtf_daemon_handle_req(struct rtf_daemon *data, int cli_id)
  */
 int rtf_daemon_init(struct rtf_daemon *data)
 {
-    if (parse_configuration(&(data->config), conf_file_path) != 0)
+    data->batch = NULL;
+    data->batch_size = 0;
+
+    if (parse_configuration(&(data->kernel), &(data->config),
+            conf_file_path) != 0)
     {
         LOG(ERR, "Configuration in path %s contains errors!\n", conf_file_path);
         return -1;
     }
 
-    if (save_rt_kernel_params(&(data->proc_backup)) != 0)
+    if (save_rt_kernel_params(&(data->kernel), &(data->proc_backup)) != 0)
     {
         LOG(ERR, "Unable to read scheduling real-time params from procfs!\n");
         return -1;
     }
 
-    if (set_rt_kernel_params(&(data->config.system)) != 0)
+    if (set_rt_kernel_params(&(data->kernel), &(data->config.system)) != 0)
     {
         // TODO: EDF double check
         LOG(WARNING, "Unable to apply param configurations. Daemon will "
@@ -559,34 +737,45 @@ int rtf_daemon_init(struct rtf_daemon *data)
         return -1;
     }
 
-    rtf_taskset_init(&(data->tasks));
+    rtf_taskset_init_linked(&(data->tasks), TASKSET_LINK_SCHED);
 
-    if (rtf_scheduler_init(&(data->config), &(data->sched), &(data->tasks)) < 0)
+    if (rtf_scheduler_init(&(data->config), &(data->sched), &(data->tasks),
+            &(data->kernel)) < 0)
     {
         LOG(ERR, "Unable to initialize schdulers.\n");
         return -1;
     }
 
+    if (rtf_status_init(&(data->status)) < 0)
+        LOG(WARNING, "Unable to share the status page. Daemon will "
+                     "continue.\n");
+
+    rtf_status_publish(&(data->status), &(data->sched), &(data->chann));
+
     return 0;
 }
 
 /**
  * @internal
  *
- * Realizes daemon loop, waiting for requests and handling it
+ * Realizes daemon loop, waiting for requests and handling it. Only the
+ * clients that produced data or failed during the last update are visited.
  *
  * @endinternal
  */
 void rtf_daemon_loop(struct rtf_daemon *data)
 {
+    struct rtf_carrier_event *events;
+    int nevents;
+
     while (1)
     {
-        rtf_carrier_update(&(data->chann));
+        nevents = rtf_carrier_update(&(data->chann), &events);
+
+        for (int i = 0; i < nevents; i++)
+            rtf_daemon_handle_req(data, &events[i]);
 
-        for (int i = 0; i <= rtf_carrier_get_conn(&(data->chann)); i++)
-        {
-            rtf_daemon_handle_req(data, i);
-        }
+        rtf_status_publish(&(data->status), &(data->sched), &(data->chann));
     }
 }
 
@@ -630,7 +819,12 @@ void rtf_daemon_destroy(struct rtf_daemon *data)
         rtf_task_release(t);
     }
 
+    rtf_taskset_destroy(&(data->tasks));
+    rtf_status_destroy(&(data->status));
     rtf_scheduler_destroy(&(data->sched));
+    rtf_task_pool_destroy();
+    free(data->batch);
 
-    restore_rt_kernel_params(&(data->proc_backup));
+    restore_rt_kernel_params(&(data->kernel), &(data->proc_backup));
+    rtf_kernel_destroy(&(data->kernel));
 }
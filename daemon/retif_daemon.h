@@ -14,23 +14,31 @@
 
 #include "retif_channel.h"
 #include "retif_config.h"
+#include "retif_kernel.h"
 #include "retif_scheduler.h"
+#include "retif_status.h"
 #include "retif_taskset.h"
 
 /**
  * @brief Main daemon data structure
  *
  * Main daemon data structure, contains the 'carrier' server part of channel
- * access, the scheduler object (the 'logic' for scheduling) and the entire
- * taskset with currently served task
+ * access, the scheduler object (the 'logic' for scheduling), the entire
+ * taskset with currently served task, the status page published for
+ * monitoring clients and the kernel backend, which must be initialized before
+ * the daemon
  */
 struct rtf_daemon
 {
+    struct rtf_kernel kernel;
     struct proc_backup proc_backup;
     configuration_t config;
     struct rtf_carrier chann;
     struct rtf_scheduler sched;
     struct rtf_taskset tasks;
+    struct rtf_status status;
+    void *batch; /** body of the last batch reply, grown on demand */
+    size_t batch_size; /** size of the batch buffer */
 };
 
 extern char *conf_file_path;
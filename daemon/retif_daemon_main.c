@@ -41,6 +41,12 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'c':
         args->conf_file = arg;
         break;
+    case 's':
+        args->simulate = 1;
+        break;
+    case 'r':
+        args->root = arg;
+        break;
     case ARGP_KEY_ARG:
         /* Too many arguments. */
         if (state->arg_num >= 1)
@@ -87,6 +93,8 @@ int main(int argc, char *argv[])
     arguments.level = 20;
     arguments.output_file = "\0";
     arguments.conf_file = SETTINGS_CFG;
+    arguments.simulate = 0;
+    arguments.root = "";
 
     struct argp argp = {options, parse_opt, 0, doc};
 
@@ -113,12 +121,22 @@ int main(int argc, char *argv[])
 
     LOG(INFO, "ReTiF daemon - Daemon started.\r\n");
 
+    if (rtf_kernel_init(&(data.kernel),
+            arguments.simulate ? &rtf_kernel_simulated : &rtf_kernel_real,
+            arguments.root) < 0)
+    {
+        LOG(ERR, "Could not initialize the kernel backend.\n");
+        exit(EXIT_FAILURE);
+    }
+
     if (rtf_daemon_init(&data) < 0)
     {
         LOG(ERR, "Could not initialize Retif daemon.\n");
         exit(EXIT_FAILURE);
     }
 
+    // clients may exit with replies still to be sent
+    signal(SIGPIPE, SIG_IGN);
     signal(SIGTTOU, output);
     signal(SIGINT, term);
     rtf_daemon_loop(&data);
@@ -0,0 +1,195 @@
+#include "retif_fit.h"
+#include <stdlib.h>
+
+// -----------------------------------------------------------------------------
+// VECTOR TYPES
+// -----------------------------------------------------------------------------
+
+#if defined(__GNUC__) && !defined(RETIF_FIT_SCALAR)
+#define FIT_VECTOR
+
+typedef float fit_vf __attribute__((vector_size(FIT_WIDTH * sizeof(float))));
+typedef int fit_vi __attribute__((vector_size(FIT_WIDTH * sizeof(int))));
+typedef long long fit_vl
+    __attribute__((vector_size(FIT_WIDTH * sizeof(int))));
+
+#define FIT_LANES {0, 1, 2, 3, 4, 5, 6, 7}
+#define FIT_SELECT(m, a, b) (((fit_vi) (a) & (m)) | ((fit_vi) (b) & ~(m)))
+
+// the same code is compiled for AVX2 and for the baseline, the best version
+// is chosen when the daemon is loaded
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define FIT_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#endif
+
+#ifndef FIT_CLONES
+#define FIT_CLONES
+#endif
+
+// -----------------------------------------------------------------------------
+// PUBLIC METHODS
+// -----------------------------------------------------------------------------
+
+float *rtf_fit_alloc(int n)
+{
+    float *free = aligned_alloc(FIT_WIDTH * sizeof(float),
+        FIT_PADDED(n) * sizeof(float));
+
+    if (free == NULL)
+        return NULL;
+
+    for (int i = 0; i < FIT_PADDED(n); i++)
+        free[i] = i < n ? 1 : FIT_PAD;
+
+    return free;
+}
+
+/**
+ * @internal
+ *
+ * A whole vector is compared at once, its entries are looked at only if at
+ * least one of them fits.
+ *
+ * @endinternal
+ */
+FIT_CLONES int rtf_fit_first(const float *free, int n, float util)
+{
+#ifdef FIT_VECTOR
+    const fit_vf *v = (const fit_vf *) free;
+    fit_vf u = (fit_vf) {0} + util;
+    fit_vi m;
+    fit_vl any;
+
+    for (int i = 0; i < FIT_PADDED(n) / FIT_WIDTH; i++)
+    {
+        m = v[i] >= u;
+        any = (fit_vl) m;
+
+        if ((any[0] | any[1] | any[2] | any[3]) == 0)
+            continue;
+
+        for (int j = 0; j < FIT_WIDTH; j++)
+            if (m[j])
+                return i * FIT_WIDTH + j;
+    }
+#else
+    for (int i = 0; i < n; i++)
+        if (free[i] >= util)
+            return i;
+#endif
+
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * Each lane keeps the best entry among the ones it has seen, the lanes are
+ * then reduced preferring the lowest index in case of ties.
+ *
+ * @endinternal
+ */
+FIT_CLONES int rtf_fit_best(const float *free, int n, float util)
+{
+    float best_free = INFINITY;
+    int best = -1;
+
+#ifdef FIT_VECTOR
+    const fit_vf *v = (const fit_vf *) free;
+    fit_vf u = (fit_vf) {0} + util;
+    fit_vf inf = (fit_vf) {0} + INFINITY;
+    fit_vf lane_free = inf;
+    fit_vi lane_best = (fit_vi) {0} - 1;
+    fit_vi idx = FIT_LANES;
+    fit_vf cand;
+    fit_vi m;
+
+    for (int i = 0; i < FIT_PADDED(n) / FIT_WIDTH; i++, idx += FIT_WIDTH)
+    {
+        cand = (fit_vf) FIT_SELECT(v[i] >= u, v[i], inf);
+        m = cand < lane_free;
+        lane_free = (fit_vf) FIT_SELECT(m, cand, lane_free);
+        lane_best = FIT_SELECT(m, idx, lane_best);
+    }
+
+    for (int j = 0; j < FIT_WIDTH; j++)
+    {
+        if (lane_best[j] < 0)
+            continue;
+
+        if (lane_free[j] < best_free ||
+            (lane_free[j] == best_free && lane_best[j] < best))
+        {
+            best_free = lane_free[j];
+            best = lane_best[j];
+        }
+    }
+#else
+    for (int i = 0; i < n; i++)
+    {
+        if (free[i] >= util && free[i] < best_free)
+        {
+            best_free = free[i];
+            best = i;
+        }
+    }
+#endif
+
+    return best;
+}
+
+/**
+ * @internal
+ *
+ * Same as rtf_fit_best(), looking for the most free entry. The padding
+ * entries are never selected, as they are not above the initial value.
+ *
+ * @endinternal
+ */
+FIT_CLONES int rtf_fit_worst(const float *free, int n, float util)
+{
+    float best_free = FIT_PAD;
+    int best = -1;
+
+#ifdef FIT_VECTOR
+    const fit_vf *v = (const fit_vf *) free;
+    fit_vf lane_free = (fit_vf) {0} + FIT_PAD;
+    fit_vi lane_best = (fit_vi) {0} - 1;
+    fit_vi idx = FIT_LANES;
+    fit_vi m;
+
+    for (int i = 0; i < FIT_PADDED(n) / FIT_WIDTH; i++, idx += FIT_WIDTH)
+    {
+        m = v[i] > lane_free;
+        lane_free = (fit_vf) FIT_SELECT(m, v[i], lane_free);
+        lane_best = FIT_SELECT(m, idx, lane_best);
+    }
+
+    for (int j = 0; j < FIT_WIDTH; j++)
+    {
+        if (lane_best[j] < 0)
+            continue;
+
+        if (lane_free[j] > best_free ||
+            (lane_free[j] == best_free && lane_best[j] < best))
+        {
+            best_free = lane_free[j];
+            best = lane_best[j];
+        }
+    }
+#else
+    for (int i = 0; i < n; i++)
+    {
+        if (free[i] > best_free)
+        {
+            best_free = free[i];
+            best = i;
+        }
+    }
+#endif
+
+    return best >= 0 && best_free >= util ? best : -1;
+}
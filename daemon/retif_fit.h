@@ -0,0 +1,67 @@
+/**
+ * @file retif_fit.h
+ * @brief Vectorized searches over the free utilization of a set of CPUs
+ *
+ * The free utilization is kept in a dense array, one entry per CPU, padded to
+ * a multiple of FIT_WIDTH entries with FIT_PAD, which never fits a task. The
+ * searches are written with the GCC vector extensions, so that they use the
+ * SIMD instructions of the target (AVX2 is selected at run time on x86-64);
+ * a scalar version is used when the extensions are not available.
+ */
+
+#ifndef RETIF_FIT_H
+#define RETIF_FIT_H
+
+#include <math.h>
+
+#define FIT_WIDTH 8 // entries processed at once
+#define FIT_PAD (-INFINITY) // free utilization of the padding entries
+
+/**
+ * @brief Returns the number of entries of an array for @p n CPUs
+ */
+#define FIT_PADDED(n) (((n) + FIT_WIDTH - 1) / FIT_WIDTH * FIT_WIDTH)
+
+/**
+ * @brief Allocates a dense array for @p n CPUs, with all of them free
+ *
+ * The array is aligned to the vector size and must be freed with free().
+ *
+ * @param n number of CPUs
+ * @return the array, NULL in case of errors
+ */
+float *rtf_fit_alloc(int n);
+
+/**
+ * @brief Returns the first entry with at least @p util free
+ *
+ * @param free dense array of free utilization
+ * @param n number of entries, padding excluded
+ * @param util utilization to be fitted
+ * @return the index of the entry, -1 if none fits
+ */
+int rtf_fit_first(const float *free, int n, float util);
+
+/**
+ * @brief Returns the entry with the least free utilization among the ones
+ * with at least @p util free, the first one in case of ties
+ *
+ * @param free dense array of free utilization
+ * @param n number of entries, padding excluded
+ * @param util utilization to be fitted
+ * @return the index of the entry, -1 if none fits
+ */
+int rtf_fit_best(const float *free, int n, float util);
+
+/**
+ * @brief Returns the entry with the most free utilization, the first one in
+ * case of ties
+ *
+ * @param free dense array of free utilization
+ * @param n number of entries, padding excluded
+ * @param util utilization to be fitted
+ * @return the index of the entry, -1 if none fits
+ */
+int rtf_fit_worst(const float *free, int n, float util);
+
+#endif // RETIF_FIT_H
@@ -0,0 +1,748 @@
+#define _GNU_SOURCE
+
+#include "retif_kernel.h"
+#include "logger.h"
+#include "retif_utils.h"
+#include <dirent.h>
+#include <errno.h>
+#include <linux/types.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// -----------------------------------------------------------------------------
+// LIBC FOR SCHED_DEADLINE
+// -----------------------------------------------------------------------------
+
+// unfortunately on many distros is not present the libc for SCHED_DEADLINE
+// what follows may be removed in future
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+#ifndef __NR_sched_setattr
+#ifdef __x86_64__
+#define __NR_sched_setattr 314
+#endif
+
+#ifdef __i386__
+#define __NR_sched_setattr 351
+#endif
+
+#ifdef __arm__
+#define __NR_sched_setattr 380
+#endif
+#endif
+
+struct kernel_sched_attr
+{
+    __u32 size;
+    __u32 sched_policy;
+    __u64 sched_flags;
+    __s32 sched_nice;
+    __u32 sched_priority;
+    __u64 sched_runtime;
+    __u64 sched_deadline;
+    __u64 sched_period;
+};
+
+#define KERNEL_LINE_MAX 4096 // longest line read from procfs and sysfs
+
+// -----------------------------------------------------------------------------
+// PRIVATE METHODS
+// -----------------------------------------------------------------------------
+
+static void kernel_all_cpus(struct rtf_kernel *k, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+
+    for (int i = 0; i < k->num_of_cpu; i++)
+        CPU_SET(i, set);
+}
+
+/**
+ * @internal
+ *
+ * A thread whose policy was changed by the simulated backend. The entry is
+ * the first member, so that the whole thread is freed by hmap_destroy().
+ *
+ * @endinternal
+ */
+struct kernel_thread
+{
+    struct hnode entry;
+    cpu_set_t cpus;
+    struct rtf_kernel_attr attr;
+};
+
+/**
+ * @internal
+ *
+ * Reads a sysfs CPU list (e.g. "0-3,8-11") and returns the lowest and the
+ * highest CPU numbers in it. Returns -1 if the file cannot be read or the
+ * list is empty, 0 otherwise.
+ *
+ * @endinternal
+ */
+static int kernel_read_cpulist(struct rtf_kernel *k, const char *path,
+    int *first, int *last)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    FILE *f;
+    long cpu;
+    int min = -1, max = -1;
+    char sep;
+
+    if (fpath == NULL)
+        return -1;
+
+    f = fopen(fpath, "r");
+    free(fpath);
+
+    if (f == NULL)
+        return -1;
+
+    while (fscanf(f, "%ld", &cpu) == 1)
+    {
+        if (min < 0 || cpu < min)
+            min = cpu;
+
+        if (cpu > max)
+            max = cpu;
+
+        if (fscanf(f, "%c", &sep) != 1 || (sep != ',' && sep != '-'))
+            break;
+    }
+
+    fclose(f);
+
+    if (max < 0)
+        return -1;
+
+    *first = min;
+    *last = max;
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Reads the first word of a sysfs file, without logging errors as missing
+ * files are expected while probing the topology.
+ *
+ * @endinternal
+ */
+static int kernel_read_word(struct rtf_kernel *k, const char *path,
+    char *word)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    FILE *f;
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    f = fopen(fpath, "r");
+    free(fpath);
+
+    if (f == NULL)
+        return -1;
+
+    res = fscanf(f, "%31s", word) == 1 ? 0 : -1;
+    fclose(f);
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * Reads the topology of a CPU. The SMT siblings are taken from the topology
+ * directory, the last level cache is the highest level data or unified cache
+ * listed in the cache directory and the NUMA node is the one linked in the
+ * CPU directory. What cannot be read is left unchanged.
+ *
+ * @endinternal
+ */
+static void kernel_read_topology(struct rtf_kernel *k, int cpu)
+{
+    char path[128], type[32];
+    long level, max_level = -1;
+    int first, last;
+    struct dirent *entry;
+    char *dpath;
+    DIR *dir;
+
+    sprintf(path, SYS_CPU_DIR "/cpu%d/topology/thread_siblings_list", cpu);
+
+    if (kernel_read_cpulist(k, path, &first, &last) == 0)
+        k->cpu[cpu].core = first;
+
+    for (int i = 0;; i++)
+    {
+        sprintf(path, SYS_CPU_DIR "/cpu%d/cache/index%d/type", cpu, i);
+
+        if (kernel_read_word(k, path, type) != 0)
+            break;
+
+        if (strcmp(type, "Instruction") == 0)
+            continue;
+
+        sprintf(path, SYS_CPU_DIR "/cpu%d/cache/index%d/level", cpu, i);
+
+        if (kernel_read_word(k, path, type) != 0)
+            continue;
+
+        level = strtol(type, NULL, 10);
+
+        if (level <= max_level)
+            continue;
+
+        sprintf(path, SYS_CPU_DIR "/cpu%d/cache/index%d/shared_cpu_list",
+            cpu, i);
+
+        if (kernel_read_cpulist(k, path, &first, &last) == 0)
+        {
+            k->cpu[cpu].llc = first;
+            max_level = level;
+        }
+    }
+
+    sprintf(path, SYS_CPU_DIR "/cpu%d", cpu);
+
+    if ((dpath = rtf_kernel_path(k, path)) == NULL)
+        return;
+
+    dir = opendir(dpath);
+    free(dpath);
+
+    if (dir == NULL)
+        return;
+
+    while ((entry = readdir(dir)) != NULL)
+        if (sscanf(entry->d_name, "node%d", &first) == 1)
+            k->cpu[cpu].node = first;
+
+    closedir(dir);
+}
+
+static int real_set_affinity(struct rtf_kernel *k, pid_t tid,
+    const cpu_set_t *set)
+{
+    (void) k;
+
+    return sched_setaffinity(tid, sizeof(cpu_set_t), set);
+}
+
+static int real_set_attr(struct rtf_kernel *k, pid_t tid,
+    struct rtf_kernel_attr *attr)
+{
+    struct kernel_sched_attr dl_attr;
+    struct sched_param param;
+
+    (void) k;
+
+    if (attr->policy != SCHED_DEADLINE)
+    {
+        param.sched_priority = attr->priority;
+        return sched_setscheduler(tid, attr->policy, &param);
+    }
+
+    memset(&dl_attr, 0, sizeof(dl_attr));
+    dl_attr.size = sizeof(dl_attr);
+    dl_attr.sched_policy = SCHED_DEADLINE;
+    dl_attr.sched_runtime = attr->runtime;
+    dl_attr.sched_deadline = attr->deadline;
+    dl_attr.sched_period = attr->period;
+
+    return syscall(__NR_sched_setattr, tid, &dl_attr, 0);
+}
+
+static int real_get_policy(struct rtf_kernel *k, pid_t tid)
+{
+    (void) k;
+
+    return sched_getscheduler(tid);
+}
+
+static int real_write_long(struct rtf_kernel *k, const char *path, long value)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    res = file_write_long(fpath, value);
+    free(fpath);
+
+    return res;
+}
+
+static int real_write_string(struct rtf_kernel *k, const char *path,
+    const char *value)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    res = file_write_string(fpath, value);
+    free(fpath);
+
+    return res;
+}
+
+static int real_make_dir(struct rtf_kernel *k, const char *path)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    res = mkdir(fpath, 0755);
+
+    if (res < 0 && errno == EEXIST)
+        res = 0;
+    else if (res < 0)
+        LOG(WARNING, "Could not create %s: %s.\n", fpath, strerror(errno));
+
+    free(fpath);
+
+    return res;
+}
+
+static int real_remove_dir(struct rtf_kernel *k, const char *path)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    res = rmdir(fpath);
+
+    if (res < 0 && errno == ENOENT)
+        res = 0;
+    else if (res < 0)
+        LOG(WARNING, "Could not remove %s: %s.\n", fpath, strerror(errno));
+
+    free(fpath);
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * Returns the simulated thread, creating it with the default policy and
+ * affinity if it does not exist.
+ *
+ * @endinternal
+ */
+static struct kernel_thread *sim_get_thread(struct rtf_kernel *k, pid_t tid)
+{
+    struct kernel_thread *th = hmap_search(&(k->threads), tid);
+
+    if (th != NULL)
+        return th;
+
+    th = calloc(1, sizeof(struct kernel_thread));
+
+    if (th == NULL)
+        return NULL;
+
+    kernel_all_cpus(k, &(th->cpus));
+    th->attr.policy = SCHED_OTHER;
+    hmap_link(&(k->threads), &(th->entry), tid, th);
+
+    return th;
+}
+
+/**
+ * @internal
+ *
+ * Forgets the threads back to the default policy and affinity, so that the
+ * memory used depends only on the threads currently attached.
+ *
+ * @endinternal
+ */
+static void sim_put_thread(struct rtf_kernel *k, pid_t tid,
+    struct kernel_thread *th)
+{
+    if (th->attr.policy != SCHED_OTHER ||
+        CPU_COUNT(&(th->cpus)) != k->num_of_cpu)
+        return;
+
+    hmap_unlink(&(k->threads), tid, th);
+    free(th);
+}
+
+static int sim_set_affinity(struct rtf_kernel *k, pid_t tid,
+    const cpu_set_t *set)
+{
+    struct kernel_thread *th;
+    cpu_set_t valid;
+
+    // like the system call, CPUs that do not exist are ignored
+    kernel_all_cpus(k, &valid);
+    CPU_AND(&valid, &valid, set);
+
+    if (CPU_COUNT(&valid) == 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((th = sim_get_thread(k, tid)) == NULL)
+        return -1;
+
+    th->cpus = valid;
+    sim_put_thread(k, tid, th);
+
+    return 0;
+}
+
+static int sim_set_attr(struct rtf_kernel *k, pid_t tid,
+    struct rtf_kernel_attr *attr)
+{
+    struct kernel_thread *th;
+
+    if ((th = sim_get_thread(k, tid)) == NULL)
+        return -1;
+
+    th->attr = *attr;
+    sim_put_thread(k, tid, th);
+
+    return 0;
+}
+
+static int sim_get_policy(struct rtf_kernel *k, pid_t tid)
+{
+    struct kernel_thread *th = hmap_search(&(k->threads), tid);
+
+    return th == NULL ? SCHED_OTHER : th->attr.policy;
+}
+
+static int sim_write_long(struct rtf_kernel *k, const char *path, long value)
+{
+    if (*k->root != '\0')
+        return real_write_long(k, path, value);
+
+    LOG(DEBUG, "Simulated write of %ld in %s.\n", value, path);
+    return 0;
+}
+
+static int sim_write_string(struct rtf_kernel *k, const char *path,
+    const char *value)
+{
+    if (*k->root != '\0')
+        return real_write_string(k, path, value);
+
+    LOG(DEBUG, "Simulated write of %s in %s.\n", value, path);
+    return 0;
+}
+
+static int sim_make_dir(struct rtf_kernel *k, const char *path)
+{
+    if (*k->root != '\0')
+        return real_make_dir(k, path);
+
+    LOG(DEBUG, "Simulated creation of %s.\n", path);
+    return 0;
+}
+
+static int sim_remove_dir(struct rtf_kernel *k, const char *path)
+{
+    if (*k->root != '\0')
+        return real_remove_dir(k, path);
+
+    LOG(DEBUG, "Simulated removal of %s.\n", path);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// PUBLIC METHODS
+// -----------------------------------------------------------------------------
+
+const struct rtf_kernel_ops rtf_kernel_real = {
+    .name = "real",
+    .set_affinity = real_set_affinity,
+    .set_attr = real_set_attr,
+    .get_policy = real_get_policy,
+    .write_long = real_write_long,
+    .write_string = real_write_string,
+    .make_dir = real_make_dir,
+    .remove_dir = real_remove_dir,
+};
+
+const struct rtf_kernel_ops rtf_kernel_simulated = {
+    .name = "simulated",
+    .set_affinity = sim_set_affinity,
+    .set_attr = sim_set_attr,
+    .get_policy = sim_get_policy,
+    .write_long = sim_write_long,
+    .write_string = sim_write_string,
+    .make_dir = sim_make_dir,
+    .remove_dir = sim_remove_dir,
+};
+
+/**
+ * @internal
+ *
+ * The trailing slashes of the root are removed, so that the paths can be
+ * simply appended to it. CPUs whose topology cannot be read are considered
+ * alone in their core and cache domains, on the first NUMA node.
+ *
+ * @endinternal
+ */
+int rtf_kernel_init(struct rtf_kernel *k, const struct rtf_kernel_ops *ops,
+    const char *root)
+{
+    int first, last;
+    size_t len;
+
+    k->ops = ops;
+    k->root = strdup(root != NULL ? root : "");
+
+    if (k->root == NULL)
+        return -1;
+
+    for (len = strlen(k->root); len > 0 && k->root[len - 1] == '/'; len--)
+        k->root[len - 1] = '\0';
+
+    hmap_init(&(k->threads));
+
+    if (kernel_read_cpulist(k, SYS_CPU_ONLINE_FILE, &first, &last) == 0)
+        k->num_of_cpu = last + 1;
+    else
+        k->num_of_cpu = get_nprocs2();
+
+    k->cpu = malloc(k->num_of_cpu * sizeof(struct rtf_kernel_cpu));
+
+    if (k->cpu == NULL)
+    {
+        free(k->root);
+        k->root = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < k->num_of_cpu; i++)
+    {
+        k->cpu[i].core = i;
+        k->cpu[i].llc = i;
+        k->cpu[i].node = 0;
+        kernel_read_topology(k, i);
+    }
+
+    LOG(INFO, "Using the %s kernel backend with %d CPUs, root is '%s/'.\n",
+        ops->name, k->num_of_cpu, k->root);
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Frees the simulated threads, the topology and the root.
+ *
+ * @endinternal
+ */
+void rtf_kernel_destroy(struct rtf_kernel *k)
+{
+    hmap_destroy(&(k->threads));
+    free(k->cpu);
+    k->cpu = NULL;
+    free(k->root);
+    k->root = NULL;
+}
+
+int rtf_kernel_set_affinity(struct rtf_kernel *k, pid_t tid, int cpu)
+{
+    cpu_set_t set;
+
+    if (cpu == KERNEL_ALL_CPUS)
+        kernel_all_cpus(k, &set);
+    else
+    {
+        CPU_ZERO(&set);
+
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+
+    return k->ops->set_affinity(k, tid, &set);
+}
+
+int rtf_kernel_set_affinity_set(struct rtf_kernel *k, pid_t tid,
+    const cpu_set_t *set)
+{
+    return k->ops->set_affinity(k, tid, set);
+}
+
+int rtf_kernel_set_attr(struct rtf_kernel *k, pid_t tid,
+    struct rtf_kernel_attr *attr)
+{
+    return k->ops->set_attr(k, tid, attr);
+}
+
+int rtf_kernel_get_policy(struct rtf_kernel *k, pid_t tid)
+{
+    return k->ops->get_policy(k, tid);
+}
+
+/**
+ * @internal
+ *
+ * Reads are the same for all the backends, files are read under the root.
+ *
+ * @endinternal
+ */
+int rtf_kernel_read_long(struct rtf_kernel *k, const char *path, long *value)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    int res;
+
+    if (fpath == NULL)
+        return -1;
+
+    res = file_read_long(fpath, value);
+    free(fpath);
+
+    return res;
+}
+
+int rtf_kernel_read_line(struct rtf_kernel *k, const char *path,
+    const char *prefix, char *line, size_t size)
+{
+    char *fpath = rtf_kernel_path(k, path);
+    size_t len = strlen(prefix);
+    char buf[KERNEL_LINE_MAX];
+    char *value;
+    FILE *f;
+    int res = -1;
+
+    if (fpath == NULL)
+        return -1;
+
+    f = fopen(fpath, "r");
+    free(fpath);
+
+    if (f == NULL)
+        return -1;
+
+    while (res != 0 && fgets(buf, sizeof(buf), f) != NULL)
+    {
+        if (strncmp(buf, prefix, len) != 0)
+            continue;
+
+        value = buf + len + strspn(buf + len, " \t");
+        value[strcspn(value, "\n")] = '\0';
+
+        if (strlen(value) < size)
+        {
+            strcpy(line, value);
+            res = 0;
+        }
+        else
+            break;
+    }
+
+    fclose(f);
+
+    return res;
+}
+
+int rtf_kernel_get_threads(struct rtf_kernel *k, pid_t pid, pid_t **tids)
+{
+    char path[64];
+    char *fpath;
+    struct dirent *entry;
+    pid_t *buf;
+    DIR *dir;
+    int cap = 0;
+    int n = 0;
+    int tid;
+
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    if ((fpath = rtf_kernel_path(k, path)) == NULL)
+        return -1;
+
+    dir = opendir(fpath);
+    free(fpath);
+
+    if (dir == NULL)
+        return -1;
+
+    *tids = NULL;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (sscanf(entry->d_name, "%d", &tid) != 1)
+            continue;
+
+        if (n == cap)
+        {
+            buf = realloc(*tids, (2 * cap + 8) * sizeof(pid_t));
+
+            if (buf == NULL)
+            {
+                free(*tids);
+                closedir(dir);
+                return -1;
+            }
+
+            *tids = buf;
+            cap = 2 * cap + 8;
+        }
+
+        (*tids)[n++] = tid;
+    }
+
+    closedir(dir);
+
+    return n;
+}
+
+int rtf_kernel_write_long(struct rtf_kernel *k, const char *path, long value)
+{
+    return k->ops->write_long(k, path, value);
+}
+
+int rtf_kernel_write_string(struct rtf_kernel *k, const char *path,
+    const char *value)
+{
+    return k->ops->write_string(k, path, value);
+}
+
+int rtf_kernel_make_dir(struct rtf_kernel *k, const char *path)
+{
+    return k->ops->make_dir(k, path);
+}
+
+int rtf_kernel_remove_dir(struct rtf_kernel *k, const char *path)
+{
+    return k->ops->remove_dir(k, path);
+}
+
+char *rtf_kernel_path(struct rtf_kernel *k, const char *path)
+{
+    char *fpath = malloc(strlen(k->root) + strlen(path) + 1);
+
+    if (fpath == NULL)
+        return NULL;
+
+    strcpy(fpath, k->root);
+    strcat(fpath, path);
+
+    return fpath;
+}
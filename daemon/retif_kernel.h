@@ -0,0 +1,261 @@
+/**
+ * @file retif_kernel.h
+ * @brief Backend used to apply scheduling decisions to the kernel
+ *
+ * The daemon and its plugins never call the scheduling system calls or touch
+ * procfs and sysfs directly, they go through a kernel backend instead. The
+ * real backend applies the requests to the running kernel. The simulated
+ * backend only records in memory the policy requested for each thread, so
+ * that the daemon can be run without privileges and without a real-time
+ * capable kernel. Both backends look for procfs and sysfs files under a root
+ * directory, which is "/" unless overridden, so that a fake root can be used.
+ * The CPU topology (SMT siblings, shared caches and NUMA nodes) is read from
+ * the same sysfs when the backend is initialized.
+ */
+
+#ifndef RETIF_KERNEL_H
+#define RETIF_KERNEL_H
+
+#include "hashmap.h"
+#include <sched.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define KERNEL_ALL_CPUS -1 // affinity to all the CPUs of the system
+
+#define SYS_CPU_DIR "/sys/devices/system/cpu"
+#define SYS_CPU_ONLINE_FILE SYS_CPU_DIR "/online"
+#define SYS_CGROUP_DIR "/sys/fs/cgroup" // default mount point of cgroup v2
+
+struct rtf_kernel;
+
+/**
+ * @brief Scheduling policy and parameters requested for a thread
+ *
+ * The runtime, deadline and period are used only by SCHED_DEADLINE, the
+ * priority only by SCHED_FIFO and SCHED_RR.
+ */
+struct rtf_kernel_attr
+{
+    int policy; /** SCHED_OTHER, SCHED_FIFO, SCHED_RR or SCHED_DEADLINE */
+    uint32_t priority; /** real-time priority */
+    uint64_t runtime; /** [nanoseconds] */
+    uint64_t deadline; /** [nanoseconds] */
+    uint64_t period; /** [nanoseconds] */
+};
+
+/**
+ * @brief Topology of a CPU
+ *
+ * Each core and cache domain is identified by the lowest CPU number in it, so
+ * that the identifiers can be used as indexes of per-CPU arrays. If the
+ * topology is not available, each CPU is alone in its domains.
+ */
+struct rtf_kernel_cpu
+{
+    int core; /** physical core, shared by SMT siblings */
+    int llc; /** last level cache */
+    int node; /** NUMA node, 0 if not available */
+};
+
+/**
+ * @brief Methods implemented by a kernel backend
+ *
+ * Each method returns -1 in case of errors, like the system call it replaces.
+ */
+struct rtf_kernel_ops
+{
+    const char *name;
+    int (*set_affinity)(struct rtf_kernel *k, pid_t tid, const cpu_set_t *set);
+    int (*set_attr)(struct rtf_kernel *k, pid_t tid,
+        struct rtf_kernel_attr *attr);
+    int (*get_policy)(struct rtf_kernel *k, pid_t tid);
+    int (*write_long)(struct rtf_kernel *k, const char *path, long value);
+    int (*write_string)(struct rtf_kernel *k, const char *path,
+        const char *value);
+    int (*make_dir)(struct rtf_kernel *k, const char *path);
+    int (*remove_dir)(struct rtf_kernel *k, const char *path);
+};
+
+/**
+ * @brief Kernel backend object
+ */
+struct rtf_kernel
+{
+    const struct rtf_kernel_ops *ops; /** methods of the backend */
+    char *root; /** prefix of procfs and sysfs paths, empty for "/" */
+    int num_of_cpu; /** CPUs of the system, read from sysfs */
+    struct rtf_kernel_cpu *cpu; /** topology of each CPU, by CPU number */
+    struct hmap threads; /** simulated threads, by thread id */
+};
+
+/**
+ * @brief Applies the requests to the running kernel
+ */
+extern const struct rtf_kernel_ops rtf_kernel_real;
+
+/**
+ * @brief Records the requests in memory, without applying them
+ *
+ * Writes to procfs and sysfs files, and the creation and removal of
+ * directories in them, are performed only if the root is overridden, so that
+ * the files of the running kernel are never modified.
+ */
+extern const struct rtf_kernel_ops rtf_kernel_simulated;
+
+/**
+ * @brief Initializes a kernel backend
+ *
+ * Reads the number of CPUs and their topology from the sysfs under @p root.
+ * If the number of CPUs is not available, the one of the running system is
+ * used.
+ *
+ * @param k pointer to the backend to be initialized
+ * @param ops methods of the backend, rtf_kernel_real or rtf_kernel_simulated
+ * @param root prefix of procfs and sysfs paths, NULL or empty for "/"
+ * @return -1 in case of errors, 0 otherwise
+ */
+int rtf_kernel_init(struct rtf_kernel *k, const struct rtf_kernel_ops *ops,
+    const char *root);
+
+/**
+ * @brief Frees the memory used by the backend
+ *
+ * @param k pointer to the backend to be destroyed
+ */
+void rtf_kernel_destroy(struct rtf_kernel *k);
+
+/**
+ * @brief Sets the affinity of a thread to a single CPU
+ *
+ * @param k pointer to the backend
+ * @param tid thread id
+ * @param cpu number of the CPU, or KERNEL_ALL_CPUS for all of them
+ * @return -1 in case of errors, 0 otherwise
+ */
+int rtf_kernel_set_affinity(struct rtf_kernel *k, pid_t tid, int cpu);
+
+/**
+ * @brief Sets the affinity of a thread to a set of CPUs
+ *
+ * @param k pointer to the backend
+ * @param tid thread id
+ * @param set CPUs the thread may run on, the ones that do not exist are
+ * ignored
+ * @return -1 in case of errors, 0 otherwise
+ */
+int rtf_kernel_set_affinity_set(struct rtf_kernel *k, pid_t tid,
+    const cpu_set_t *set);
+
+/**
+ * @brief Sets the scheduling policy and parameters of a thread
+ *
+ * @param k pointer to the backend
+ * @param tid thread id
+ * @param attr policy and parameters
+ * @return -1 in case of errors, 0 otherwise
+ */
+int rtf_kernel_set_attr(struct rtf_kernel *k, pid_t tid,
+    struct rtf_kernel_attr *attr);
+
+/**
+ * @brief Returns the scheduling policy of a thread
+ *
+ * @param k pointer to the backend
+ * @param tid thread id
+ * @return the policy, -1 in case of errors
+ */
+int rtf_kernel_get_policy(struct rtf_kernel *k, pid_t tid);
+
+/**
+ * @brief Reads an integer from a procfs or sysfs file
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the file, without the root
+ * @param value pointer to the value read
+ * @return 0 in case of success, non zero otherwise
+ */
+int rtf_kernel_read_long(struct rtf_kernel *k, const char *path, long *value);
+
+/**
+ * @brief Reads a line of a procfs or sysfs file
+ *
+ * Looks for the first line that starts with @p prefix, like "Tgid:" in the
+ * status of a thread, and copies what follows the prefix, without leading
+ * blanks and the newline.
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the file, without the root
+ * @param prefix beginning of the line
+ * @param line buffer where the rest of the line is copied
+ * @param size size of @p line
+ * @return 0 in case of success, -1 if the line is not found or too long
+ */
+int rtf_kernel_read_line(struct rtf_kernel *k, const char *path,
+    const char *prefix, char *line, size_t size);
+
+/**
+ * @brief Lists the threads of a process
+ *
+ * Reads the task directory of the process in procfs. The returned array must
+ * be freed by the caller.
+ *
+ * @param k pointer to the backend
+ * @param pid process id
+ * @param tids set to point to the thread ids
+ * @return the number of threads, -1 in case of errors
+ */
+int rtf_kernel_get_threads(struct rtf_kernel *k, pid_t pid, pid_t **tids);
+
+/**
+ * @brief Writes an integer in a procfs or sysfs file
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the file, without the root
+ * @param value value to be written
+ * @return 0 in case of success, non zero otherwise
+ */
+int rtf_kernel_write_long(struct rtf_kernel *k, const char *path, long value);
+
+/**
+ * @brief Writes a string in a procfs, sysfs or cgroup file
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the file, without the root
+ * @param value value to be written
+ * @return 0 in case of success, non zero otherwise
+ */
+int rtf_kernel_write_string(struct rtf_kernel *k, const char *path,
+    const char *value);
+
+/**
+ * @brief Creates a directory, like a cgroup, if it does not exist
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the directory, without the root
+ * @return 0 in case of success or if the directory exists, -1 otherwise
+ */
+int rtf_kernel_make_dir(struct rtf_kernel *k, const char *path);
+
+/**
+ * @brief Removes a directory, like a cgroup, if it exists
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the directory, without the root
+ * @return 0 in case of success or if the directory does not exist, -1
+ * otherwise
+ */
+int rtf_kernel_remove_dir(struct rtf_kernel *k, const char *path);
+
+/**
+ * @brief Returns the path of a procfs or sysfs file under the root
+ *
+ * The returned string must be freed by the caller.
+ *
+ * @param k pointer to the backend
+ * @param path absolute path of the file, without the root
+ * @return the path, NULL in case of errors
+ */
+char *rtf_kernel_path(struct rtf_kernel *k, const char *path);
+
+#endif // RETIF_KERNEL_H
@@ -2,6 +2,8 @@
 #include "logger.h"
 #include "retif_config.h"
 #include "retif_daemon.h"
+#include "retif_fit.h"
+#include "retif_kernel.h"
 #include "retif_taskset.h"
 #include "retif_utils.h"
 #include "vector.h"
@@ -14,6 +16,157 @@
 #include <sys/sysinfo.h>
 #include <unistd.h>
 
+// -----------------------------------------------------------------------------
+// PRIVATE METHODS
+// -----------------------------------------------------------------------------
+
+static float plugin_cpu_load(struct rtf_plugin *this, enum PLUGIN_LOAD load,
+    int cpu)
+{
+    if (load == PLUGIN_LOAD_COUNT)
+        return this->task_count_percpu[cpu];
+
+    return 1 - this->util_free_percpu[cpu];
+}
+
+static float plugin_domain_load(struct rtf_plugin_domain *d)
+{
+    return d->load / d->ncpu;
+}
+
+/**
+ * @internal
+ *
+ * Computes the mean load of the core and cache domains of the plugin CPUs.
+ * The first half of the domains is indexed by core id, the second one by
+ * cache id.
+ *
+ * @endinternal
+ */
+static void plugin_domains_update(struct rtf_plugin *this,
+    enum PLUGIN_LOAD load)
+{
+    struct rtf_kernel_cpu *topo = this->kernel->cpu;
+    struct rtf_plugin_domain *core = this->domains;
+    struct rtf_plugin_domain *llc = this->domains + this->kernel->num_of_cpu;
+    int cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        cpu = this->cpulist[i];
+        core[topo[cpu].core] = (struct rtf_plugin_domain) {0, 0};
+        llc[topo[cpu].llc] = (struct rtf_plugin_domain) {0, 0};
+    }
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        float l = plugin_cpu_load(this, load, this->cpulist[i]);
+
+        cpu = this->cpulist[i];
+        core[topo[cpu].core].load += l;
+        core[topo[cpu].core].ncpu++;
+        llc[topo[cpu].llc].load += l;
+        llc[topo[cpu].llc].ncpu++;
+    }
+}
+
+/**
+ * @internal
+ *
+ * Returns 1 if CPU @p a is better than CPU @p b. A CPU on the preferred
+ * @p node is always better, then the domains are compared, from the widest
+ * one used by the plugin topology.
+ *
+ * @endinternal
+ */
+static int plugin_cpu_less(struct rtf_plugin *this, enum PLUGIN_LOAD load,
+    int node, int a, int b)
+{
+    struct rtf_kernel_cpu *topo = this->kernel->cpu;
+    struct rtf_plugin_domain *core = this->domains;
+    struct rtf_plugin_domain *llc = this->domains + this->kernel->num_of_cpu;
+    float la, lb;
+
+    if (node >= 0 && (topo[a].node == node) != (topo[b].node == node))
+        return topo[a].node == node;
+
+    if (this->topology == TOPOLOGY_LLC)
+    {
+        la = plugin_domain_load(&llc[topo[a].llc]);
+        lb = plugin_domain_load(&llc[topo[b].llc]);
+
+        if (la != lb)
+            return la < lb;
+    }
+
+    if (this->topology != TOPOLOGY_NONE)
+    {
+        la = plugin_domain_load(&core[topo[a].core]);
+        lb = plugin_domain_load(&core[topo[b].core]);
+
+        if (la != lb)
+            return la < lb;
+    }
+
+    return plugin_cpu_load(this, load, a) < plugin_cpu_load(this, load, b);
+}
+
+/**
+ * @internal
+ *
+ * Returns 1 if CPU @p a must be above CPU @p b in the heap, namely if it has
+ * more free utilization or the same and a lower number.
+ *
+ * @endinternal
+ */
+static int plugin_heap_above(struct rtf_plugin *this, int a, int b)
+{
+    float fa = this->util_free_percpu[a];
+    float fb = this->util_free_percpu[b];
+
+    return fa > fb || (fa == fb && a < b);
+}
+
+static void plugin_heap_swap(struct rtf_plugin *this, int i, int j)
+{
+    int cpu = this->util_heap[i];
+
+    this->util_heap[i] = this->util_heap[j];
+    this->util_heap[j] = cpu;
+    this->util_heap_pos[this->util_heap[i]] = i;
+    this->util_heap_pos[this->util_heap[j]] = j;
+}
+
+static void plugin_heap_fix(struct rtf_plugin *this, int i)
+{
+    int *heap = this->util_heap;
+    int parent, child;
+
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+
+        if (!plugin_heap_above(this, heap[i], heap[parent]))
+            break;
+
+        plugin_heap_swap(this, i, parent);
+        i = parent;
+    }
+
+    while ((child = 2 * i + 1) < this->cputot)
+    {
+        if (child + 1 < this->cputot &&
+            plugin_heap_above(this, heap[child + 1], heap[child]))
+            child++;
+
+        if (!plugin_heap_above(this, heap[child], heap[i]))
+            break;
+
+        plugin_heap_swap(this, i, child);
+        i = child;
+    }
+}
+
 // -----------------------------------------------------------------------------
 // PUBLIC METHODS
 // -----------------------------------------------------------------------------
@@ -55,6 +208,7 @@ int open_plugin_dll(const char *path, const char *relpath,
     plg->rtf_plg_task_schedule = dlsym(dl_ptr, RTF_API_SCHEDULE);
     plg->rtf_plg_task_attach = dlsym(dl_ptr, RTF_API_ATTACH);
     plg->rtf_plg_task_detach = dlsym(dl_ptr, RTF_API_DETACH);
+    plg->rtf_plg_task_destroy = dlsym(dl_ptr, RTF_API_DESTROY);
 
     // FIXME: Check all symbols not NULL
     return 0;
@@ -139,8 +293,8 @@ end:
  *
  * @endinternal
  */
-int rtf_plugins_init(vector_conf_plugin_t *confs, struct rtf_plugin **out_plgs,
-    int *num_of_plugins)
+int rtf_plugins_init(vector_conf_plugin_t *confs, struct rtf_kernel *k,
+    struct rtf_plugin **out_plgs, int *num_of_plugins)
 {
     size_t i, j;
 
@@ -149,48 +303,199 @@ int rtf_plugins_init(vector_conf_plugin_t *confs, struct rtf_plugin **out_plgs,
 
     struct rtf_plugin *plgs = *out_plgs;
 
-    size_t num_cpu = get_nprocs2();
-
     for (i = 0; i < confs->size; ++i)
     {
         plgs[i].id = i;
         plgs[i].cputot = confs->data[i].cores.size;
         plgs[i].prio_min = confs->data[i].priority_min;
         plgs[i].prio_max = confs->data[i].priority_max;
+        plgs[i].kernel = k;
+        plgs[i].topology = confs->data[i].topology;
+        plgs[i].placement = confs->data[i].placement;
+        plgs[i].admission = confs->data[i].admission;
+        plgs[i].cgroup = strdup(confs->data[i].cgroup != NULL
+                                    ? confs->data[i].cgroup
+                                    : SYS_CGROUP_DIR);
 
         plgs[i].cpulist = calloc(plgs[i].cputot, sizeof(int));
-        plgs[i].util_free_percpu = calloc(plgs[i].cputot, sizeof(int));
-        plgs[i].task_count_percpu = calloc(plgs[i].cputot, sizeof(int));
-        plgs[i].tasks = calloc(plgs[i].cputot, sizeof(struct rtf_taskset));
+        plgs[i].util_free_percpu = calloc(k->num_of_cpu, sizeof(float));
+        plgs[i].task_count_percpu = calloc(k->num_of_cpu, sizeof(int));
+        plgs[i].tasks = calloc(k->num_of_cpu, sizeof(struct rtf_taskset));
+        plgs[i].domains =
+            calloc(2 * k->num_of_cpu, sizeof(struct rtf_plugin_domain));
+        plgs[i].util_heap = calloc(plgs[i].cputot, sizeof(int));
+        plgs[i].util_heap_pos = calloc(k->num_of_cpu, sizeof(int));
+        plgs[i].util_free_dense = rtf_fit_alloc(plgs[i].cputot);
+        plgs[i].cpu_pos = calloc(k->num_of_cpu, sizeof(int));
         plgs[i].name = calloc(strlen(confs->data[i].name) + 1, sizeof(char));
         plgs[i].path =
             calloc(strlen(confs->data[i].plugin_path) + 1, sizeof(char));
 
         // FIXME: use max_util from conf
-        for (j = 0; j < plgs[i].cputot; j++)
+        for (j = 0; j < k->num_of_cpu; j++)
             plgs[i].util_free_percpu[j] = 1;
 
-        for (j = 0; j < plgs[i].cputot; j++)
-            rtf_taskset_init(&plgs[i].tasks[j]);
+        for (j = 0; j < k->num_of_cpu; j++)
+            rtf_taskset_init_linked(&plgs[i].tasks[j], TASKSET_LINK_PLUGIN);
 
         strcpy(plgs[i].name, confs->data[i].name);
 
         memmove(plgs[i].cpulist, confs->data[i].cores.data,
             sizeof(int) * plgs[i].cputot);
 
+        // all the CPUs are free and listed in ascending order, as in the heap
+        for (j = 0; j < plgs[i].cputot; j++)
+        {
+            plgs[i].util_heap[j] = plgs[i].cpulist[j];
+            plgs[i].util_heap_pos[plgs[i].cpulist[j]] = j;
+            plgs[i].cpu_pos[plgs[i].cpulist[j]] = j;
+        }
+
         strcpy(plgs[i].path, confs->data[i].plugin_path);
         if (find_and_open_plugin(&plgs[i]) != 0)
             return -1;
+
+        if (plgs[i].rtf_plg_task_init(&plgs[i]) != RTF_OK)
+        {
+            LOG(ERR, "Unable to initialize %s plugin.\n", plgs[i].name);
+            return -1;
+        }
     } // endfor
 
     return 0;
 }
 
+void rtf_plugin_util_add(struct rtf_plugin *this, int cpu, float delta)
+{
+    this->util_free_percpu[cpu] += delta;
+    this->util_free_dense[this->cpu_pos[cpu]] = this->util_free_percpu[cpu];
+    plugin_heap_fix(this, this->util_heap_pos[cpu]);
+}
+
+int rtf_plugin_most_free_cpu(struct rtf_plugin *this)
+{
+    return this->util_heap[0];
+}
+
+int rtf_plugin_fit_cpu(struct rtf_plugin *this, float util,
+    enum PLUGIN_FIT fit)
+{
+    int pos;
+
+    switch (fit)
+    {
+    case PLUGIN_FIT_FIRST:
+        pos = rtf_fit_first(this->util_free_dense, this->cputot, util);
+        break;
+    case PLUGIN_FIT_BEST:
+        pos = rtf_fit_best(this->util_free_dense, this->cputot, util);
+        break;
+    default:
+        pos = rtf_fit_worst(this->util_free_dense, this->cputot, util);
+        break;
+    }
+
+    return pos < 0 ? -1 : this->cpulist[pos];
+}
+
 /**
  * @internal
  *
- * Closes dynamic library opened in init phase and free allocated memory.
- * Must be used when tearing down daemon
+ * Next-fit starts from the CPU it used last and wraps around, so that the
+ * CPUs released by departing tasks are reused.
+ *
+ * @endinternal
+ */
+int rtf_plugin_place_cpu(struct rtf_plugin *this, float util, int node)
+{
+    int cpu = -1;
+    int pos;
+
+    switch (this->placement)
+    {
+    case PLACEMENT_FIRST_FIT:
+        cpu = rtf_plugin_fit_cpu(this, util, PLUGIN_FIT_FIRST);
+        break;
+    case PLACEMENT_BEST_FIT:
+        cpu = rtf_plugin_fit_cpu(this, util, PLUGIN_FIT_BEST);
+        break;
+    case PLACEMENT_NEXT_FIT:
+        for (int i = 0; i < this->cputot && cpu < 0; i++)
+        {
+            pos = (this->next_fit + i) % this->cputot;
+
+            if (this->util_free_dense[pos] >= util)
+            {
+                this->next_fit = pos;
+                cpu = this->cpulist[pos];
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (cpu < 0)
+        cpu = rtf_plugin_least_loaded_cpu(this, PLUGIN_LOAD_UTIL, util, node);
+
+    return cpu;
+}
+
+/**
+ * @internal
+ *
+ * Ties are broken in favor of the CPU listed first, so that the placement
+ * does not change when the topology is not used. The CPU with the most free
+ * utilization fits the task if any does, and it is the least loaded one
+ * otherwise, so the heap answers when the CPUs are compared on load only.
+ *
+ * @endinternal
+ */
+int rtf_plugin_least_loaded_cpu(struct rtf_plugin *this, enum PLUGIN_LOAD load,
+    float util, int node)
+{
+    int best = -1;
+    int cpu;
+
+    if (load == PLUGIN_LOAD_UTIL && this->topology == TOPOLOGY_NONE &&
+        node < 0)
+        return rtf_plugin_most_free_cpu(this);
+
+    if (this->topology != TOPOLOGY_NONE)
+        plugin_domains_update(this, load);
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        cpu = this->cpulist[i];
+
+        if (load == PLUGIN_LOAD_UTIL && this->util_free_percpu[cpu] < util)
+            continue;
+
+        if (best < 0 || plugin_cpu_less(this, load, node, cpu, best))
+            best = cpu;
+    }
+
+    if (best >= 0)
+        return best;
+
+    // no CPU can fit the task, return the least loaded one
+    for (int i = 0; i < this->cputot; i++)
+    {
+        cpu = this->cpulist[i];
+
+        if (best < 0 || plugin_cpu_less(this, load, node, cpu, best))
+            best = cpu;
+    }
+
+    return best;
+}
+
+/**
+ * @internal
+ *
+ * Lets the plugins undo their changes to the system, then closes dynamic
+ * library opened in init phase and free allocated memory. Must be used when
+ * tearing down daemon
  *
  * @endinternal
  */
@@ -198,10 +503,24 @@ void rtf_plugins_destroy(struct rtf_plugin *plgs, int plugin_num)
 {
     for (int i = 0; i < plugin_num; i++)
     {
+        if (plgs[i].rtf_plg_task_destroy != NULL)
+            plgs[i].rtf_plg_task_destroy(&plgs[i]);
+
         // TODO: missing frees
         free(plgs[i].util_free_percpu);
         free(plgs[i].cpulist);
         free(plgs[i].task_count_percpu);
+        free(plgs[i].domains);
+        free(plgs[i].util_heap);
+        free(plgs[i].util_heap_pos);
+        free(plgs[i].util_free_dense);
+        free(plgs[i].cpu_pos);
+        free(plgs[i].cgroup);
+
+        for (int j = 0; j < plgs[i].kernel->num_of_cpu; j++)
+            rtf_taskset_destroy(&plgs[i].tasks[j]);
+
+        free(plgs[i].tasks);
         dlclose(plgs[i].dl_ptr);
     }
 }
@@ -0,0 +1,209 @@
+#include "retif_rta.h"
+#include "retif_types.h"
+#include <stdlib.h>
+
+// -----------------------------------------------------------------------------
+// PRIVATE METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @internal
+ *
+ * Copies the tasks of @p ts in the buffer by increasing priority, adding
+ * @p t before the first task whose key is not longer than its own. If @p t is
+ * already in @p ts, its old copy is left out. Returns the number of entries,
+ * -1 in case of errors, and the position of @p t in @p pos.
+ *
+ * @endinternal
+ */
+static int rtf_rta_collect(struct rtf_rta *r, struct rtf_taskset *ts,
+    struct rtf_task *t, rtf_rta_key_fun key, int *pos)
+{
+    iterator_t iterator;
+    struct rtf_task *t_fp;
+    uint64_t t_key = key(t);
+    int n = 0;
+
+    if (rtf_rta_reserve(r, rtf_taskset_get_size(ts) + 1) < 0)
+        return -1;
+
+    *pos = -1;
+    iterator = rtf_taskset_iterator_init(ts);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_fp = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_fp->id == t->id)
+            continue;
+
+        if (*pos < 0 && key(t_fp) <= t_key)
+        {
+            *pos = n;
+            rtf_rta_fill(&(r->buf[n++]), t, t_key);
+        }
+
+        rtf_rta_fill(&(r->buf[n++]), t_fp, key(t_fp));
+    }
+
+    if (*pos < 0)
+    {
+        *pos = n;
+        rtf_rta_fill(&(r->buf[n++]), t, t_key);
+    }
+
+    r->len = n;
+
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+// PUBLIC METHODS
+// -----------------------------------------------------------------------------
+
+int rtf_rta_reserve(struct rtf_rta *r, int size)
+{
+    struct rtf_rta_entry *buf;
+
+    if (size <= r->cap)
+        return 0;
+
+    buf = realloc(r->buf, size * sizeof(struct rtf_rta_entry));
+
+    if (buf == NULL)
+        return -1;
+
+    r->buf = buf;
+    r->cap = size;
+
+    return 0;
+}
+
+void rtf_rta_fill(struct rtf_rta_entry *e, struct rtf_task *t, uint64_t key)
+{
+    e->runtime = rtf_task_get_runtime(t);
+    e->period = rtf_task_get_period(t);
+    e->deadline = rtf_task_get_min_declared(t);
+    e->key = key;
+    e->response = t->response;
+    e->level = -1;
+    e->task = t;
+}
+
+uint64_t rtf_rta_response(const struct rtf_rta_entry *buf, int first, int n,
+    int i, uint64_t start)
+{
+    const struct rtf_rta_entry *e = &buf[i];
+    uint64_t r = start;
+    uint64_t w;
+
+    for (;;)
+    {
+        w = e->runtime;
+
+        for (int j = first; j < n && w <= e->deadline; j++)
+            if (j != i)
+                w += (r + buf[j].period - 1) / buf[j].period * buf[j].runtime;
+
+        if (w <= r || w > e->deadline)
+            return w > r ? w : r;
+
+        r = w;
+    }
+}
+
+/**
+ * @internal
+ *
+ * The entries after @p i have higher priority, the ones with the same key
+ * before it share its priority, so the interference starts from the first
+ * of them.
+ *
+ * @endinternal
+ */
+int rtf_rta_test(struct rtf_rta *r, struct rtf_taskset *ts,
+    struct rtf_task *t, rtf_rta_key_fun key, int valid, int store)
+{
+    struct rtf_rta_entry *e;
+    uint64_t start;
+    int res = RTF_OK;
+    int first;
+    int pos;
+    int n;
+
+    if ((n = rtf_rta_collect(r, ts, t, key, &pos)) < 0)
+        return RTF_NO;
+
+    for (int i = n - 1; i >= 0 && (store || res == RTF_OK); i--)
+    {
+        e = &(r->buf[i]);
+
+        if (valid && i != pos && e->key < r->buf[pos].key)
+            continue;
+
+        for (first = i; first > 0 && r->buf[first - 1].key == e->key; first--)
+            ;
+
+        start = valid && i != pos ? e->response + r->buf[pos].runtime
+                                  : e->runtime;
+        e->response = rtf_rta_response(r->buf, first, n, i, start);
+
+        if (e->response > e->deadline)
+            res = RTF_NO;
+
+        if (store)
+            e->task->response = e->response;
+    }
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * The entries already assigned are moved to the beginning of the buffer, so
+ * that the ones left, which delay each other, are always the last ones. The
+ * tasks taking a level still delay the others, so they are marked first and
+ * moved once all of them have been found.
+ *
+ * @endinternal
+ */
+int rtf_rta_assign(struct rtf_rta *r, int levels)
+{
+    struct rtf_rta_entry *buf = r->buf;
+    struct rtf_rta_entry tmp;
+    int n = r->len;
+    int done = 0;
+    int level;
+    int found;
+
+    for (level = 0; done < n; level++)
+    {
+        if (level == levels)
+            return -1;
+
+        found = 0;
+
+        for (int i = done; i < n && (found == 0 || n - done > levels - level);
+             i++)
+            if (rtf_rta_response(buf, done, n, i, buf[i].runtime) <=
+                buf[i].deadline)
+                buf[i].level = -2, found++;
+
+        if (found == 0)
+            return -1;
+
+        for (int i = done; i < n; i++)
+        {
+            if (buf[i].level != -2)
+                continue;
+
+            tmp = buf[i];
+            buf[i] = buf[done];
+            buf[done] = tmp;
+            buf[done++].level = level;
+        }
+    }
+
+    return level;
+}
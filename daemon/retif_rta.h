@@ -0,0 +1,125 @@
+/**
+ * @file retif_rta.h
+ * @brief Response time analysis of the tasks of a CPU under fixed priorities
+ *
+ * The analysis is shared by the fixed priority plugins, which differ only in
+ * how the priorities are chosen. Rate and deadline monotonic order the tasks
+ * by a key (the period or the relative deadline), and the tasks with the same
+ * key share a priority. The optimal priority assignment (Audsley's algorithm)
+ * instead finds the priorities with the analysis itself. The tasks are
+ * copied in a buffer owned by the plugin, which is grown on demand and kept
+ * between the tests.
+ */
+
+#ifndef RETIF_RTA_H
+#define RETIF_RTA_H
+
+#include "retif_task.h"
+#include "retif_taskset.h"
+#include <stdint.h>
+
+// task of a CPU as seen by the response time analysis
+struct rtf_rta_entry
+{
+    uint64_t runtime;
+    uint64_t period;
+    uint64_t deadline; // relative deadline, not after the period
+    uint64_t key; // priority key, the shorter the higher the priority
+    uint64_t response; // cached response time, valid if the CPU cache is
+    int level; // priority level from the lowest, -1 if not assigned yet
+    struct rtf_task *task;
+};
+
+struct rtf_rta
+{
+    struct rtf_rta_entry *buf;
+    int cap; // entries allocated
+    int len; // entries filled by the last collect
+};
+
+/**
+ * @brief Returns the priority key of a task
+ */
+typedef uint64_t (*rtf_rta_key_fun)(struct rtf_task *t);
+
+/**
+ * @brief Grows the buffer of the analysis to hold @p size entries
+ *
+ * @param r analysis buffer
+ * @param size number of entries
+ * @return 0 in case of success, -1 if memory cannot be allocated
+ */
+int rtf_rta_reserve(struct rtf_rta *r, int size);
+
+/**
+ * @brief Copies the parameters of a task in an entry
+ *
+ * The cached response time of the task is copied too, and the entry has no
+ * priority level yet.
+ *
+ * @param e entry to be filled
+ * @param t task
+ * @param key priority key of the task
+ */
+void rtf_rta_fill(struct rtf_rta_entry *e, struct rtf_task *t, uint64_t key);
+
+/**
+ * @brief Computes the response time of an entry
+ *
+ * Iterates R = C + sum(ceil(R / T_j) * C_j) from @p start, where j are the
+ * entries from @p first to @p n, but @p i, that are the ones with higher or
+ * the same priority. The iteration stops as soon as R exceeds the deadline,
+ * so the result is exact only if it does not.
+ *
+ * @param buf entries
+ * @param first first entry that delays @p i
+ * @param n number of entries
+ * @param i entry analyzed
+ * @param start lower bound of the response time
+ * @return the response time, larger than the deadline if it is missed
+ */
+uint64_t rtf_rta_response(const struct rtf_rta_entry *buf, int first, int n,
+    int i, uint64_t start);
+
+/**
+ * @brief Response time analysis of a CPU with a task added
+ *
+ * The tasks of @p ts, sorted by decreasing key, are copied by increasing
+ * priority with @p t added; its old copy is left out if it is already in
+ * @p ts. With @p valid the response times cached in the tasks are up to date,
+ * so the tasks with higher priority than @p t are not affected, while for
+ * the others the iteration resumes from their old response time plus the
+ * runtime of @p t, which is a lower bound of the new one. With @p store the
+ * response times are cached in the tasks; otherwise the analysis stops at
+ * the first deadline miss.
+ *
+ * @param r analysis buffer
+ * @param ts tasks of the CPU, sorted by decreasing key
+ * @param t task added
+ * @param key priority key of the tasks
+ * @param valid whether the cached response times are up to date
+ * @param store whether the response times are cached in the tasks
+ * @return RTF_OK if all the deadlines are met, RTF_NO otherwise
+ */
+int rtf_rta_test(struct rtf_rta *r, struct rtf_taskset *ts,
+    struct rtf_task *t, rtf_rta_key_fun key, int valid, int store);
+
+/**
+ * @brief Optimal priority assignment of the entries of the buffer
+ *
+ * Audsley's algorithm: from the lowest level up, any task that meets its
+ * deadline with all the others not assigned yet at higher priority takes
+ * the level, and if none does the set is not schedulable with any fixed
+ * priority assignment. Tasks that share a level delay each other, so when
+ * there are more tasks left than levels, all the tasks that would meet their
+ * deadline at the current level take it together, which leaves the fewest
+ * tasks for the levels above. The entries are reordered, and the level of
+ * each one is stored in it.
+ *
+ * @param r analysis buffer, with r->len entries filled
+ * @param levels number of priority levels available
+ * @return the number of levels used, -1 if the set is not schedulable
+ */
+int rtf_rta_assign(struct rtf_rta *r, int levels);
+
+#endif // RETIF_RTA_H
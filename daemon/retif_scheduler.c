@@ -1,6 +1,9 @@
+#define _GNU_SOURCE
+
 #include "retif_scheduler.h"
 #include "logger.h"
 #include "retif_config.h"
+#include "retif_kernel.h"
 #include "retif_plugin.h"
 #include "retif_task.h"
 #include "retif_taskset.h"
@@ -12,10 +15,8 @@
 #include <time.h>
 
 static int rtf_scheduler_test_and_assign(struct rtf_scheduler *s,
-    struct rtf_task *t)
+    struct rtf_task *t, int *results)
 {
-    int *results = calloc(s->num_of_plugins, sizeof(int));
-
     for (int i = 0; i < s->num_of_plugins; i++)
     {
         results[i] =
@@ -25,8 +26,6 @@ static int rtf_scheduler_test_and_assign(struct rtf_scheduler *s,
         {
             rtf_taskset_add_top(s->taskset, t);
             s->plugin[i].rtf_plg_task_schedule(&(s->plugin[i]), s->taskset, t);
-
-            free(results);
             return RTF_OK;
         }
     }
@@ -39,21 +38,114 @@ static int rtf_scheduler_test_and_assign(struct rtf_scheduler *s,
         {
             rtf_taskset_add_top(s->taskset, t);
             s->plugin[i].rtf_plg_task_schedule(&(s->plugin[i]), s->taskset, t);
-
-            free(results);
             return RTF_PARTIAL;
         }
     }
 
     // means no plugin available
-    free(results);
     return RTF_NO;
 }
 
+/**
+ * @internal
+ *
+ * Adds the task to the list of reservations owned by its client. The first
+ * reservation of each client is indexed by the client pid, the others are
+ * linked after it.
+ *
+ * @endinternal
+ */
+static void rtf_scheduler_own(struct rtf_scheduler *s, struct rtf_task *t)
+{
+    struct rtf_task *first = hmap_search(&(s->owners), t->ptid);
+
+    t->prev_owned = first;
+    t->next_owned = NULL;
+
+    if (first == NULL)
+    {
+        hmap_link(&(s->owners), &(t->owner), t->ptid, t);
+        return;
+    }
+
+    t->next_owned = first->next_owned;
+    first->next_owned = t;
+
+    if (t->next_owned != NULL)
+        t->next_owned->prev_owned = t;
+}
+
+/**
+ * @internal
+ *
+ * Removes the task from the list of reservations owned by its client. If the
+ * task is the first one, the index is moved to the next reservation.
+ *
+ * @endinternal
+ */
+static void rtf_scheduler_disown(struct rtf_scheduler *s, struct rtf_task *t)
+{
+    if (t->next_owned != NULL)
+        t->next_owned->prev_owned = t->prev_owned;
+
+    if (t->prev_owned != NULL)
+        t->prev_owned->next_owned = t->next_owned;
+    else
+    {
+        hmap_unlink(&(s->owners), t->ptid, t);
+
+        if (t->next_owned != NULL)
+            hmap_link(&(s->owners), &(t->next_owned->owner), t->ptid,
+                t->next_owned);
+    }
+
+    t->prev_owned = NULL;
+    t->next_owned = NULL;
+}
+
+/**
+ * @internal
+ *
+ * Moves an admitted reservation to the plugin that accepted its new
+ * parameters. The owner releases it with the parameters it accepted, which
+ * also detaches the thread, so a thread that was running under the
+ * reservation is attached again.
+ *
+ * @endinternal
+ */
+static void rtf_scheduler_move(struct rtf_scheduler *s, struct rtf_task *t,
+    int i, struct rtf_params *old)
+{
+    struct rtf_params tp;
+    int policy = -1;
+
+    if (t->tid != 0)
+        policy = rtf_kernel_get_policy(s->kernel, t->tid);
+
+    if (t->pluginid >= 0)
+    {
+        memcpy(&tp, &(t->params), sizeof(struct rtf_params));
+        memcpy(&(t->params), old, sizeof(struct rtf_params));
+        s->plugin[t->pluginid].rtf_plg_task_release(
+            &(s->plugin[t->pluginid]), s->taskset, t);
+        memcpy(&(t->params), &tp, sizeof(struct rtf_params));
+    }
+
+    s->plugin[i].rtf_plg_task_schedule(&(s->plugin[i]), s->taskset, t);
+
+    if (policy == SCHED_FIFO || policy == SCHED_RR || policy == SCHED_DEADLINE)
+        s->plugin[i].rtf_plg_task_attach(&(s->plugin[i]), t);
+}
+
 static int rtf_scheduler_test_and_modify(struct rtf_scheduler *s,
-    struct rtf_task *t)
+    struct rtf_task *t, struct rtf_params *tp)
 {
-    int *results = calloc(s->num_of_plugins, sizeof(int));
+    int *results = s->results;
+    struct rtf_params old;
+
+    // the plugins test the task with the parameters it would have
+    memcpy(&old, &(t->params), sizeof(struct rtf_params));
+    memcpy(&(t->params), tp, sizeof(struct rtf_params));
 
     for (int i = 0; i < s->num_of_plugins; i++)
     {
@@ -62,10 +154,7 @@ static int rtf_scheduler_test_and_modify(struct rtf_scheduler *s,
 
         if (results[i] == RTF_OK)
         {
-            s->plugin[i].rtf_plg_task_release(&(s->plugin[i]), s->taskset, t);
-            s->plugin[i].rtf_plg_task_schedule(&(s->plugin[i]), s->taskset, t);
-
-            free(results);
+            rtf_scheduler_move(s, t, i, &old);
             return RTF_OK;
         }
     }
@@ -76,19 +165,74 @@ static int rtf_scheduler_test_and_modify(struct rtf_scheduler *s,
     {
         if (results[i] == RTF_PARTIAL)
         {
-            s->plugin[i].rtf_plg_task_release(&(s->plugin[i]), s->taskset, t);
-            s->plugin[i].rtf_plg_task_schedule(&(s->plugin[i]), s->taskset, t);
-
-            free(results);
+            rtf_scheduler_move(s, t, i, &old);
             return RTF_PARTIAL;
         }
     }
 
-    // means no plugin available
-    free(results);
+    // means no plugin available, the reservation keeps its parameters
+    memcpy(&(t->params), &old, sizeof(struct rtf_params));
     return RTF_NO;
 }
 
+static float scheduler_params_util(struct rtf_params *p)
+{
+    uint64_t min = p->deadline != 0 && p->deadline < p->period ? p->deadline
+                                                               : p->period;
+
+    return min == 0 ? 0 : p->runtime / (float) min;
+}
+
+// by decreasing utilization, then by index, so that equal tasks keep their
+// order
+static int scheduler_cmp_decreasing(const void *a, const void *b, void *arg)
+{
+    struct rtf_params *tp = arg;
+    int i = *(const int *) a;
+    int j = *(const int *) b;
+    float ui = scheduler_params_util(&tp[i]);
+    float uj = scheduler_params_util(&tp[j]);
+
+    if (ui != uj)
+        return ui < uj ? 1 : -1;
+
+    return i - j;
+}
+
+/**
+ * @internal
+ *
+ * Stores in the order buffer of the scheduler the indexes of the @p num
+ * parameters, by decreasing utilization, growing the buffer if needed. The
+ * sort is stable, so that equal tasks keep their order. Returns 0 in case of
+ * success, -1 if memory cannot be allocated.
+ *
+ * @endinternal
+ */
+static int scheduler_order_decreasing(struct rtf_scheduler *s,
+    struct rtf_params *tp, int num)
+{
+    int *order;
+
+    if (num > s->order_max)
+    {
+        order = realloc(s->order, num * sizeof(int));
+
+        if (order == NULL)
+            return -1;
+
+        s->order = order;
+        s->order_max = num;
+    }
+
+    for (int i = 0; i < num; i++)
+        s->order[i] = i;
+
+    qsort_r(s->order, num, sizeof(int), scheduler_cmp_decreasing, tp);
+
+    return 0;
+}
+
 // -----------------------------------------------------------------------------
 // PUBLIC METHODS
 // -----------------------------------------------------------------------------
@@ -101,15 +245,15 @@ static int rtf_scheduler_test_and_modify(struct rtf_scheduler *s,
  * @endinternal
  */
 int rtf_scheduler_init(configuration_t *conf, struct rtf_scheduler *s,
-    struct rtf_taskset *ts)
+    struct rtf_taskset *ts, struct rtf_kernel *k)
 {
     int res;
     long rt_runtime;
     long rt_period;
     double procfs_max_util;
 
-    res = file_read_long(PROC_RT_RUNTIME_FILE, &rt_runtime);
-    res = res | file_read_long(PROC_RT_PERIOD_FILE, &rt_period);
+    res = rtf_kernel_read_long(k, PROC_RT_RUNTIME_FILE, &rt_runtime);
+    res = res | rtf_kernel_read_long(k, PROC_RT_PERIOD_FILE, &rt_period);
     if (res)
     {
         LOG(ERR, "Could not read from procfs!\n");
@@ -131,9 +275,28 @@ int rtf_scheduler_init(configuration_t *conf, struct rtf_scheduler *s,
 
     s->taskset = ts;
     s->last_task_id = 0;
-    s->num_of_cpu = get_nprocs2();
+    hmap_init(&(s->owners));
+    s->kernel = k;
+    s->num_of_cpu = k->num_of_cpu;
+    s->decreasing = false;
+    s->order = NULL;
+    s->order_max = 0;
+
+    // the plugin of a task is known only after the admission, so the order
+    // of a batch is the same for all the plugins
+    for (size_t i = 0; i < conf->plugins.size; i++)
+        s->decreasing = s->decreasing || conf->plugins.data[i].decreasing;
+
+    if (rtf_plugins_init(&conf->plugins, k, &(s->plugin),
+            &(s->num_of_plugins)))
+        return -1;
 
-    return rtf_plugins_init(&conf->plugins, &(s->plugin), &(s->num_of_plugins));
+    s->results = calloc(s->num_of_plugins, sizeof(int));
+
+    if (s->results == NULL && s->num_of_plugins > 0)
+        return -1;
+
+    return 0;
 }
 
 /**
@@ -146,19 +309,34 @@ int rtf_scheduler_init(configuration_t *conf, struct rtf_scheduler *s,
 void rtf_scheduler_destroy(struct rtf_scheduler *s)
 {
     rtf_plugins_destroy(s->plugin, s->num_of_plugins);
+    hmap_destroy(&(s->owners));
+    free(s->results);
+    free(s->order);
 }
 
+/**
+ * @internal
+ *
+ * Walks the list of reservations owned by the client. Each of them is
+ * unlinked from the taskset through the reservation id index, so that the
+ * cost is linear in the number of reservations of the client.
+ *
+ * @endinternal
+ */
 void rtf_scheduler_delete(struct rtf_scheduler *s, pid_t ppid)
 {
+    struct hnode *first;
     struct rtf_task *t;
+    struct rtf_task *next;
 
-    while (1)
-    {
-        t = rtf_taskset_remove_by_ppid(s->taskset, ppid);
+    first = hmap_unlink(&(s->owners), ppid, NULL);
+    t = first == NULL ? NULL : first->elem;
 
-        if (t == NULL)
-            break;
+    for (; t != NULL; t = next)
+    {
+        next = t->next_owned;
 
+        rtf_taskset_remove_by_rsvid(s->taskset, t->id);
         s->plugin[t->pluginid].rtf_plg_task_release(&(s->plugin[t->pluginid]),
             s->taskset, t);
         rtf_task_release(t);
@@ -174,18 +352,70 @@ void rtf_scheduler_delete(struct rtf_scheduler *s, pid_t ppid)
  */
 int rtf_scheduler_task_create(struct rtf_scheduler *s, struct rtf_params *tp,
     pid_t ppid)
+{
+    int res;
+    rtf_id_t rtf_id;
+
+    if (rtf_scheduler_task_create_batch(s, tp, 1, ppid, &rtf_id, &res) < 0)
+        return RTF_NO;
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * Creates a set of reservations in a single pass, reusing the scratch
+ * buffers of the scheduler for the per-plugin admission results and for the
+ * order of the batch, so that nothing is allocated besides the tasks once
+ * they have grown. Tasks are evaluated in the given order, so each admission
+ * test already accounts for the tasks of the batch accepted before it.
+ * Refused tasks are freed and get a zero id. If a plugin uses a decreasing
+ * placement heuristic, the whole batch is evaluated by decreasing
+ * utilization, the results are still stored in the given order.
+ *
+ * @endinternal
+ */
+int rtf_scheduler_task_create_batch(struct rtf_scheduler *s,
+    struct rtf_params *tp, int num, pid_t ppid, rtf_id_t *rtf_ids,
+    int *results)
 {
     struct rtf_task *t;
+    int accepted = 0;
+    int i;
 
-    rtf_task_init(&t, 0, CLK);
+    if (s->decreasing && num > 1 && scheduler_order_decreasing(s, tp, num) < 0)
+        return -1;
+
+    for (int k = 0; k < num; k++)
+    {
+        i = s->decreasing && num > 1 ? s->order[k] : k;
+        rtf_ids[i] = 0;
+        results[i] = RTF_NO;
 
-    t->id = ++s->last_task_id;
-    t->ptid = ppid;
-    t->pluginid = -1;
+        if (rtf_task_init(&t, 0, CLK) < 0)
+            continue;
 
-    memcpy(&(t->params), tp, sizeof(struct rtf_params));
+        t->id = ++s->last_task_id;
+        t->ptid = ppid;
+        t->pluginid = -1;
 
-    return rtf_scheduler_test_and_assign(s, t);
+        memcpy(&(t->params), &tp[i], sizeof(struct rtf_params));
+
+        results[i] = rtf_scheduler_test_and_assign(s, t, s->results);
+
+        if (results[i] == RTF_NO)
+        {
+            rtf_task_release(t);
+            continue;
+        }
+
+        rtf_scheduler_own(s, t);
+        rtf_ids[i] = t->id;
+        accepted++;
+    }
+
+    return accepted;
 }
 
 int rtf_scheduler_task_change(struct rtf_scheduler *s, struct rtf_params *tp,
@@ -196,29 +426,56 @@ int rtf_scheduler_task_change(struct rtf_scheduler *s, struct rtf_params *tp,
     if (t == NULL)
         return RTF_ERROR;
 
-    return rtf_scheduler_test_and_modify(s, t);
+    return rtf_scheduler_test_and_modify(s, t, tp);
 }
 
 int rtf_scheduler_task_attach(struct rtf_scheduler *s, rtf_id_t rtf_id,
     pid_t pid)
 {
     struct rtf_task *t = rtf_taskset_search(s->taskset, rtf_id);
+    struct rtf_plugin *plg;
 
     if (t == NULL)
         return RTF_ERROR;
 
     t->tid = pid;
-    return s->plugin[t->pluginid].rtf_plg_task_attach(t);
+    plg = &(s->plugin[t->pluginid]);
+    return plg->rtf_plg_task_attach(plg, t);
+}
+
+/**
+ * @internal
+ *
+ * Attaches a set of threads to their reservations in a single pass
+ *
+ * @endinternal
+ */
+int rtf_scheduler_task_attach_batch(struct rtf_scheduler *s,
+    struct rtf_ids *ids, int num, int *results)
+{
+    int attached = 0;
+
+    for (int i = 0; i < num; i++)
+    {
+        results[i] = rtf_scheduler_task_attach(s, ids[i].rsvid, ids[i].pid);
+
+        if (results[i] >= 0)
+            attached++;
+    }
+
+    return attached;
 }
 
 int rtf_scheduler_task_detach(struct rtf_scheduler *s, rtf_id_t rtf_id)
 {
     struct rtf_task *t = rtf_taskset_search(s->taskset, rtf_id);
+    struct rtf_plugin *plg;
 
     if (t == NULL)
         return RTF_ERROR;
 
-    return s->plugin[t->pluginid].rtf_plg_task_detach(t);
+    plg = &(s->plugin[t->pluginid]);
+    return plg->rtf_plg_task_detach(plg, t);
 }
 
 int rtf_scheduler_task_destroy(struct rtf_scheduler *s, rtf_id_t rtf_id)
@@ -230,6 +487,7 @@ int rtf_scheduler_task_destroy(struct rtf_scheduler *s, rtf_id_t rtf_id)
     if (t == NULL)
         return RTF_ERROR;
 
+    rtf_scheduler_disown(s, t);
     s->plugin[t->pluginid].rtf_plg_task_release(&(s->plugin[t->pluginid]),
         s->taskset, t);
     rtf_task_release(t);
@@ -251,9 +509,13 @@ void rtf_scheduler_dump(struct rtf_scheduler *s)
             s->plugin[i].path);
 
         for (int j = 0; j < s->plugin[i].cputot; j++)
-            LOG(DEBUG, "--> CPU %d - Free: %f - Task count: %d\n",
-                s->plugin[i].cpulist[j], s->plugin[i].util_free_percpu[j],
-                s->plugin[i].task_count_percpu[j]);
+        {
+            int cpu = s->plugin[i].cpulist[j];
+
+            LOG(DEBUG, "--> CPU %d - Free: %f - Task count: %d\n", cpu,
+                s->plugin[i].util_free_percpu[cpu],
+                s->plugin[i].task_count_percpu[cpu]);
+        }
     }
 
     LOG(DEBUG, "Tasks:\n");
@@ -1,6 +1,7 @@
 #ifndef RETIF_SCHEDULER_H
 #define RETIF_SCHEDULER_H
 
+#include "hashmap.h"
 #include "retif_plugin.h"
 #include "retif_types.h"
 #include <sys/types.h>
@@ -9,6 +10,7 @@
 
 struct rtf_taskset;
 struct rtf_task;
+struct rtf_kernel;
 
 struct rtf_scheduler
 {
@@ -17,6 +19,12 @@ struct rtf_scheduler
     long last_task_id;
     struct rtf_taskset *taskset;
     struct rtf_plugin *plugin;
+    struct rtf_kernel *kernel; /** backend used to apply the decisions */
+    struct hmap owners; /** first reservation of each client, by pid */
+    int *results; /** scratch buffer for the admission results of plugins */
+    bool decreasing; /** batches are admitted by decreasing utilization */
+    int *order; /** scratch buffer for the admission order of batches */
+    int order_max; /** entries of the order buffer */
 };
 
 /**
@@ -26,9 +34,10 @@ struct rtf_scheduler
  *
  * @param s pointer to scheduler data struct
  * @param ts pointer to taskset data struct
+ * @param k kernel backend used to read procfs and to apply the decisions
  */
 int rtf_scheduler_init(configuration_t *conf, struct rtf_scheduler *s,
-    struct rtf_taskset *ts);
+    struct rtf_taskset *ts, struct rtf_kernel *k);
 
 /**
  * @brief Deallocate scheduler stuff
@@ -39,6 +48,16 @@ int rtf_scheduler_init(configuration_t *conf, struct rtf_scheduler *s,
  */
 void rtf_scheduler_destroy(struct rtf_scheduler *s);
 
+/**
+ * @brief Deletes all the reservations of a client
+ *
+ * Releases all the reservations created by the client with pid @p ppid,
+ * following the list of reservations owned by the client, so the cost
+ * depends only on the number of its reservations.
+ *
+ * @param s pointer to scheduler data struct
+ * @param ppid process id of the main process of the client
+ */
 void rtf_scheduler_delete(struct rtf_scheduler *s, pid_t ppid);
 
 /**
@@ -57,12 +76,48 @@ void rtf_scheduler_delete(struct rtf_scheduler *s, pid_t ppid);
 int rtf_scheduler_task_create(struct rtf_scheduler *s, struct rtf_params *tp,
     pid_t ppid);
 
+/**
+ * @brief Creates a set of reservations if possible
+ *
+ * Evaluates @p num reservations in a single pass, in the given order. For each
+ * of them stores in @p rtf_ids the id assigned (0 if refused) and in
+ * @p results the outcome of the admission, with the same meaning of the value
+ * returned by rtf_scheduler_task_create(). Returns the number of accepted
+ * reservations (even partially) or -1 in case of errors.
+ *
+ * @param s pointer to scheduler data struct
+ * @param tp array of @p num task params
+ * @param num number of reservations to create
+ * @param ppid process id of the main process of the client
+ * @param rtf_ids array of @p num ids filled with the assigned ids
+ * @param results array of @p num admission outcomes
+ * @return number of accepted reservations, -1 in case of errors
+ */
+int rtf_scheduler_task_create_batch(struct rtf_scheduler *s,
+    struct rtf_params *tp, int num, pid_t ppid, rtf_id_t *rtf_ids,
+    int *results);
+
 int rtf_scheduler_task_change(struct rtf_scheduler *s, struct rtf_params *tp,
     rtf_id_t rtf_id);
 
 int rtf_scheduler_task_attach(struct rtf_scheduler *s, rtf_id_t rtf_id,
     pid_t pid);
 
+/**
+ * @brief Attaches a set of threads to their reservations
+ *
+ * Stores in @p results the outcome of each attach, -1 if it failed. Returns
+ * the number of threads successfully attached.
+ *
+ * @param s pointer to scheduler data struct
+ * @param ids array of @p num pairs of reservation id and thread id
+ * @param num number of threads to attach
+ * @param results array of @p num attach outcomes
+ * @return number of threads attached
+ */
+int rtf_scheduler_task_attach_batch(struct rtf_scheduler *s,
+    struct rtf_ids *ids, int num, int *results);
+
 int rtf_scheduler_task_detach(struct rtf_scheduler *s, rtf_id_t rtf_id);
 
 int rtf_scheduler_task_destroy(struct rtf_scheduler *s, rtf_id_t rtf_id);
@@ -0,0 +1,231 @@
+#include "retif_status.h"
+#include "logger.h"
+#include "retif_channel.h"
+#include "retif_scheduler.h"
+#include "retif_task.h"
+#include "retif_taskset.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STATUS_ISIZE 4096
+
+// -----------------------------------------------------------------------------
+// PRIVATE METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @internal
+ *
+ * Grows the shared memory object and the mapping so that they can hold at
+ * least @p size bytes. The object is at least doubled, to make regrowth rare
+ * while tasks are being added. The page is rewritten as a whole by each
+ * publish, so its content is not preserved. Returns -1 in case of errors, 0
+ * otherwise.
+ *
+ * @endinternal
+ */
+static int rtf_status_reserve(struct rtf_status *st, size_t size)
+{
+    size_t new_size;
+    void *page;
+
+    if (size <= st->size)
+        return 0;
+
+    new_size = st->size ? st->size : STATUS_ISIZE;
+
+    while (new_size < size)
+        new_size *= 2;
+
+    // without a shared memory object, keep the page in private memory
+    if (st->fd < 0)
+        page = mmap(NULL, new_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    else if (ftruncate(st->fd, new_size) == 0)
+        page = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            st->fd, 0);
+    else
+        return -1;
+
+    if (page == MAP_FAILED)
+        return -1;
+
+    if (st->page != NULL)
+        munmap(st->page, st->size);
+
+    st->page = page;
+    st->size = new_size;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// PUBLIC METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @internal
+ *
+ * Creates the shared memory object, readable by everybody, and maps it. If
+ * the object cannot be created, the page is kept in private memory, so that
+ * it can still be used to answer snapshot requests.
+ *
+ * @endinternal
+ */
+int rtf_status_init(struct rtf_status *st)
+{
+    int ret = 0;
+
+    memset(st, 0, sizeof(struct rtf_status));
+
+    st->fd = shm_open(STATUS_SHM_NAME, O_CREAT | O_RDWR | O_TRUNC, 0644);
+
+    // do not depend on the umask, readers only need to read
+    if (st->fd >= 0 && fchmod(st->fd, 0644) < 0)
+    {
+        rtf_status_destroy(st);
+        st->fd = -1;
+    }
+
+    if (st->fd < 0)
+        ret = -1;
+
+    if (rtf_status_reserve(st, STATUS_ISIZE) < 0)
+    {
+        rtf_status_destroy(st);
+        return -1;
+    }
+
+    st->page->size = st->size;
+    st->page->magic = STATUS_MAGIC;
+    st->dirty = 1;
+
+    return ret;
+}
+
+/**
+ * @internal
+ *
+ * Rewrites the whole page under the sequence lock. The page is republished at
+ * most once per daemon loop iteration, so the cost is shared among all the
+ * requests served in that iteration.
+ *
+ * @endinternal
+ */
+void rtf_status_publish(struct rtf_status *st, struct rtf_scheduler *s,
+    struct rtf_carrier *c)
+{
+    struct rtf_status_page *p;
+    struct rtf_client_info *clients;
+    struct rtf_plugin_info *plugins;
+    struct rtf_cpu_info *cpus;
+    struct rtf_task_info *tasks;
+    struct rtf_task *t;
+    iterator_t it;
+    uint32_t nconnected, ncpu, ntask, seq;
+
+    if (st->page == NULL || !st->dirty)
+        return;
+
+    nconnected = 0;
+    for (int i = 0; i < rtf_carrier_get_conn(c); i++)
+        if (c->client[i].pid != 0)
+            nconnected++;
+
+    ncpu = 0;
+    for (int i = 0; i < s->num_of_plugins; i++)
+        ncpu += s->plugin[i].cputot;
+
+    ntask = rtf_taskset_get_size(s->taskset);
+
+    if (rtf_status_reserve(st, rtf_status_page_size(nconnected,
+                                   s->num_of_plugins, ncpu, ntask)) < 0)
+    {
+        LOG(WARNING, "Unable to grow the status page, it will be stale.\n");
+        return;
+    }
+
+    p = st->page;
+    seq = p->seq;
+
+    // odd sequence number: readers retry until the page is consistent again
+    __atomic_store_n(&p->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    p->size = st->size;
+    p->nconnected = nconnected;
+    p->nplugin = s->num_of_plugins;
+    p->ncpu = ncpu;
+    p->ntask = ntask;
+
+    clients = rtf_status_clients(p);
+    plugins = rtf_status_plugins(p, nconnected);
+    cpus = rtf_status_cpus(p, nconnected, p->nplugin);
+    tasks = rtf_status_tasks(p, nconnected, p->nplugin, ncpu);
+
+    for (int i = 0; i < rtf_carrier_get_conn(c); i++)
+    {
+        if (c->client[i].pid == 0)
+            continue;
+
+        clients->pid = c->client[i].pid;
+        clients->state = c->client[i].state;
+        clients++;
+    }
+
+    for (int i = 0; i < s->num_of_plugins; i++)
+    {
+        strncpy(plugins[i].name, s->plugin[i].name, PLUGIN_MAX_NAME);
+        plugins[i].cputot = s->plugin[i].cputot;
+
+        for (int j = 0; j < s->plugin[i].cputot; j++, cpus++)
+        {
+            cpus->cpunum = s->plugin[i].cpulist[j];
+            cpus->freeu = s->plugin[i].util_free_percpu[cpus->cpunum];
+            cpus->ntask = s->plugin[i].task_count_percpu[cpus->cpunum];
+        }
+    }
+
+    it = rtf_taskset_iterator_init(s->taskset);
+
+    for (; it != NULL; it = rtf_taskset_iterator_get_next(it), tasks++)
+    {
+        t = rtf_taskset_iterator_get_elem(it);
+        tasks->tid = t->tid;
+        tasks->ppid = t->ptid;
+        tasks->priority = t->schedprio;
+        tasks->period = t->params.period;
+        tasks->util = t->acceptedu;
+        tasks->pluginid = t->pluginid;
+        tasks->id = t->id;
+    }
+
+    __atomic_store_n(&p->seq, seq + 2, __ATOMIC_RELEASE);
+
+    st->dirty = 0;
+}
+
+/**
+ * @internal
+ *
+ * Unmaps and removes the shared memory object
+ *
+ * @endinternal
+ */
+void rtf_status_destroy(struct rtf_status *st)
+{
+    if (st->page != NULL)
+        munmap(st->page, st->size);
+
+    if (st->fd >= 0)
+    {
+        close(st->fd);
+        shm_unlink(STATUS_SHM_NAME);
+    }
+
+    st->page = NULL;
+    st->fd = -1;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file retif_status.h
+ * @brief Publishes the daemon state in a shared-memory status page
+ *
+ * The status page is a read-only view of the scheduler state (plugins, free
+ * utilization per CPU, tasks) that monitoring clients can map and read
+ * without any request to the daemon. See common/retif_shm.h for the
+ * layout of the page.
+ */
+
+#ifndef RETIF_STATUS_H
+#define RETIF_STATUS_H
+
+#include "retif_shm.h"
+#include <stddef.h>
+
+struct rtf_carrier;
+struct rtf_scheduler;
+
+/**
+ * @brief Writer side of the status page
+ */
+struct rtf_status
+{
+    int fd; /** Descriptor of the shared memory object */
+    size_t size; /** Size currently mapped */
+    struct rtf_status_page *page; /** Mapped page, NULL if not available */
+    int dirty; /** Whether the state changed since the last publish */
+};
+
+/**
+ * @brief Creates the status page
+ *
+ * Creates the shared memory object, readable by everybody, and maps it.
+ * Returns -1 if the page cannot be shared, 0 otherwise. Even if it cannot be
+ * shared, the page is kept in private memory unless @p st->page is NULL.
+ *
+ * @param st pointer to status page data structure
+ * @return -1 in case of errors, 0 otherwise
+ */
+int rtf_status_init(struct rtf_status *st);
+
+/**
+ * @brief Publishes the current state in the status page
+ *
+ * Rewrites the whole page under the sequence lock, growing it if needed.
+ * Does nothing if the page is not available or the state is not dirty.
+ *
+ * @param st pointer to status page data structure
+ * @param s pointer to scheduler data struct
+ * @param c pointer to channel data structure of the daemon
+ */
+void rtf_status_publish(struct rtf_status *st, struct rtf_scheduler *s,
+    struct rtf_carrier *c);
+
+/**
+ * @brief Removes the status page
+ *
+ * @param st pointer to status page data structure
+ */
+void rtf_status_destroy(struct rtf_status *st);
+
+#endif // RETIF_STATUS_H
@@ -8,22 +8,57 @@
 
 #define _GNU_SOURCE
 
+#define TASK_SLAB 256 // tasks allocated at once when the pool is empty
+
+// a chunk of tasks, allocated together and never given back to the system
+struct rtf_task_slab
+{
+    struct rtf_task_slab *next;
+    struct rtf_task tasks[TASK_SLAB];
+};
+
+static struct rtf_task_slab *slabs; // all the chunks allocated
+static struct rtf_task *pool; // free tasks, chained through next_owned
+
 //------------------------------------------
 // PRIVATE: UTILITIES FUNCTION
 //------------------------------------------
 
+// Refill the pool with a new chunk of tasks
+static int rtf_task_pool_grow()
+{
+    struct rtf_task_slab *slab = malloc(sizeof(struct rtf_task_slab));
+
+    if (slab == NULL)
+        return -1;
+
+    slab->next = slabs;
+    slabs = slab;
+
+    for (int i = 0; i < TASK_SLAB; i++)
+    {
+        slab->tasks[i].next_owned = pool;
+        pool = &slab->tasks[i];
+    }
+
+    return 0;
+}
+
 //------------------------------------------
 // PUBLIC: CREATE AND DESTROY FUNCTIONS
 //------------------------------------------
 
-// Instanciate and initialize a real time task structure
+// Instanciate and initialize a real time task structure, taking it from the
+// pool so that no memory is allocated once the pool has grown enough
 int rtf_task_init(struct rtf_task **t, rtf_id_t id, clockid_t clk)
 {
-    (*t) = calloc(1, sizeof(struct rtf_task));
-
-    if ((*t) == NULL)
+    if (pool == NULL && rtf_task_pool_grow() < 0)
         return -1;
 
+    (*t) = pool;
+    pool = pool->next_owned;
+
+    memset((*t), 0, sizeof(struct rtf_task));
     (*t)->id = id;
     (*t)->clk = clk;
 
@@ -42,10 +77,26 @@ int rtf_task_copy(struct rtf_task *t, struct rtf_task *t_copy)
     return 1;
 }
 
-// Destroy a real time task structure
+// Destroy a real time task structure, giving it back to the pool
 void rtf_task_release(struct rtf_task *t)
 {
-    free(t);
+    t->next_owned = pool;
+    pool = t;
+}
+
+// Free the memory kept for the real time task structures, all the tasks
+// must have been released
+void rtf_task_pool_destroy()
+{
+    struct rtf_task_slab *next;
+
+    for (; slabs != NULL; slabs = next)
+    {
+        next = slabs->next;
+        free(slabs);
+    }
+
+    pool = NULL;
 }
 
 //-----------------------------------------------
@@ -124,6 +175,12 @@ uint8_t rtf_task_get_ignore_admission(struct rtf_task *t)
     return t->params.ignore_admission;
 }
 
+// Get task preferred NUMA node, -1 if none
+int rtf_task_get_numa_node(struct rtf_task *t)
+{
+    return (int) t->params.numa_node - 1;
+}
+
 // Get task preference plugin name
 char *rtf_task_get_preferred_plugin(struct rtf_task *t)
 {
@@ -215,6 +272,20 @@ static int task_cmp_priority(struct rtf_task *t1, struct rtf_task *t2)
         return 0;
 }
 
+// Compare two tasks based on relative deadline
+static int task_cmp_rel_deadline(struct rtf_task *t1, struct rtf_task *t2)
+{
+    uint64_t d1 = rtf_task_get_min_declared(t1);
+    uint64_t d2 = rtf_task_get_min_declared(t2);
+
+    if (d1 > d2)
+        return 1;
+    else if (d1 < d2)
+        return -1;
+    else
+        return 0;
+}
+
 // Compare two tasks
 int task_cmp(struct rtf_task *t1, struct rtf_task *t2, enum PARAM p, int flag)
 {
@@ -231,6 +302,8 @@ int task_cmp(struct rtf_task *t1, struct rtf_task *t2, enum PARAM p, int flag)
         return flag * task_cmp_deadline(t1, t2);
     case PRIORITY:
         return flag * task_cmp_priority(t1, t2);
+    case REL_DEADLINE:
+        return flag * task_cmp_rel_deadline(t1, t2);
     default:
         return flag * task_cmp_priority(t1, t2);
     }
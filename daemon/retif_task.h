@@ -5,6 +5,8 @@
 #ifndef RETIF_TASK_H
 #define RETIF_TASK_H
 
+#include "hashmap.h"
+#include "list.h"
 #include "retif_plugin.h"
 #include "retif_types.h"
 #include <stdint.h>
@@ -19,12 +21,22 @@ enum PARAM
     RUNTIME,
     PERIOD,
     DEADLINE,
-    PRIORITY
+    PRIORITY,
+    REL_DEADLINE // min of declared deadline and period
 };
 
 #define ASC 1
 #define DSC -1
 
+#define RTF_TASK_LINKS 2 // tasksets a task can be linked to at the same time
+
+// links embedded in the task, used by a taskset without allocating
+struct rtf_task_link
+{
+    struct node_ptr node; /** node of the taskset list */
+    struct hnode entry; /** entry of the taskset index */
+};
+
 struct rtf_task
 {
     rtf_id_t id; /** task id in the system */
@@ -38,7 +50,12 @@ struct rtf_task
     int pluginid; /** if != -1 -> the scheduling alg */
     uint64_t acceptedt; /** accepted runtime */
     float acceptedu; /** accepted utils */
+    uint64_t response; /** worst-case response time, cached by the plugin */
     struct rtf_params params;
+    struct rtf_task *next_owned; /** next reservation of the same client */
+    struct rtf_task *prev_owned; /** previous reservation of the same client */
+    struct hnode owner; /** entry of the scheduler index of the clients */
+    struct rtf_task_link link[RTF_TASK_LINKS]; /** links to the tasksets */
 };
 
 //------------------------------------------
@@ -54,6 +71,9 @@ int rtf_task_copy(struct rtf_task *t, struct rtf_task *t_copy);
 // Destroy a real time task structure
 void rtf_task_release(struct rtf_task *t);
 
+// Free the memory kept for the real time task structures
+void rtf_task_pool_destroy();
+
 //-----------------------------------------------
 // PUBLIC: GETTER/SETTER
 //------------------------------------------------
@@ -103,6 +123,9 @@ float rtf_task_get_des_util(struct rtf_task *t);
 // Get task ignore admission param
 uint8_t rtf_task_get_ignore_admission(struct rtf_task *t);
 
+// Get task preferred NUMA node, -1 if none
+int rtf_task_get_numa_node(struct rtf_task *t);
+
 // Get task preference plugin name
 char *rtf_task_get_preferred_plugin(struct rtf_task *t);
 
@@ -50,6 +50,11 @@ static int rtf_taskset_cmp_period_dsc(any_t task1, any_t task2)
     return task_cmp((struct rtf_task *) task1, (struct rtf_task *) task2,
         PERIOD, DSC);
 }
+static int rtf_taskset_cmp_rel_deadline_dsc(any_t task1, any_t task2)
+{
+    return task_cmp((struct rtf_task *) task1, (struct rtf_task *) task2,
+        REL_DEADLINE, DSC);
+}
 static int rtf_taskset_cmp_wcet_asc(any_t task1, any_t task2)
 {
     return task_cmp((struct rtf_task *) task1, (struct rtf_task *) task2,
@@ -67,12 +72,74 @@ static int rtf_taskset_cmp_ppid(void *task, void *ppid)
 
     return (t->ptid == p);
 }
-static int rtf_taskset_cmp_rsvid(void *task, void *rsvid)
+
+/**
+ * @internal
+ *
+ * Adds the task to the list, at the top if @p cmpfun is NULL or sorted
+ * otherwise, and to the index. If the taskset uses one of the links embedded
+ * in the task, no memory is allocated.
+ *
+ * @endinternal
+ */
+static struct node_ptr *rtf_taskset_insert(struct rtf_taskset *ts,
+    struct rtf_task *task, int (*cmpfun)(any_t task1, any_t task2))
 {
-    struct rtf_task *t = (struct rtf_task *) task;
-    rtf_id_t p = (*(rtf_id_t *) rsvid);
+    struct rtf_task_link *link;
+    struct node_ptr *node;
+
+    if (ts->link == TASKSET_LINK_NONE)
+    {
+        if (cmpfun == NULL)
+            list_add_top(&(ts->tasks), (void *) task);
+
+        node = cmpfun == NULL ? ts->tasks.root
+                              : list_add_sorted(&(ts->tasks), task, cmpfun);
+        hmap_add(&(ts->by_rsvid), task->id, node);
+
+        return node;
+    }
+
+    link = &(task->link[ts->link]);
+
+    if (cmpfun == NULL)
+        list_link_top(&(ts->tasks), &(link->node), (void *) task);
+    else
+        list_link_sorted(&(ts->tasks), &(link->node), (void *) task, cmpfun);
+
+    hmap_link(&(ts->by_rsvid), &(link->entry), task->id, &(link->node));
+
+    return &(link->node);
+}
+
+/**
+ * @internal
+ *
+ * Unlinks the node, found through the index, from the list and removes it
+ * from the index
+ *
+ * @endinternal
+ */
+static struct rtf_task *rtf_taskset_remove_node(struct rtf_taskset *ts,
+    struct node_ptr *node)
+{
+    struct rtf_task *t;
+
+    if (node == NULL)
+        return NULL;
+
+    if (ts->link != TASKSET_LINK_NONE)
+    {
+        t = list_unlink(&(ts->tasks), node);
+        hmap_unlink(&(ts->by_rsvid), t->id, node);
+
+        return t;
+    }
+
+    t = list_remove_node(&(ts->tasks), node);
+    hmap_remove(&(ts->by_rsvid), t->id, node);
 
-    return (t->id == p);
+    return t;
 }
 
 // -----------------------------------------------------
@@ -88,8 +155,38 @@ static int rtf_taskset_cmp_rsvid(void *task, void *rsvid)
  * @endinternal
  */
 void rtf_taskset_init(struct rtf_taskset *ts)
+{
+    rtf_taskset_init_linked(ts, TASKSET_LINK_NONE);
+}
+
+/**
+ * @internal
+ *
+ * Same as rtf_taskset_init(), but the taskset uses the links embedded in the
+ * tasks at position @p link.
+ *
+ * @endinternal
+ */
+void rtf_taskset_init_linked(struct rtf_taskset *ts, int link)
 {
     list_init(&(ts->tasks));
+    hmap_init(&(ts->by_rsvid));
+    ts->link = link;
+}
+
+/**
+ * @internal
+ *
+ * Frees the list nodes and the indexes, but not the tasks themselves.
+ *
+ * @endinternal
+ */
+void rtf_taskset_destroy(struct rtf_taskset *ts)
+{
+    while (rtf_taskset_remove_top(ts) != NULL)
+        ;
+
+    hmap_destroy(&(ts->by_rsvid));
 }
 
 /**
@@ -127,7 +224,7 @@ int rtf_taskset_get_size(struct rtf_taskset *ts)
  */
 void rtf_taskset_add_top(struct rtf_taskset *ts, struct rtf_task *task)
 {
-    list_add_top(&(ts->tasks), (void *) task);
+    rtf_taskset_insert(ts, task, NULL);
 }
 
 /**
@@ -143,7 +240,7 @@ void rtf_taskset_add_top(struct rtf_taskset *ts, struct rtf_task *task)
  */
 void rtf_taskset_add_sorted_dl(struct rtf_taskset *ts, struct rtf_task *task)
 {
-    list_add_sorted(&(ts->tasks), (void *) task, rtf_taskset_cmp_deadline_asc);
+    rtf_taskset_insert(ts, task, rtf_taskset_cmp_deadline_asc);
 }
 
 /**
@@ -160,8 +257,23 @@ void rtf_taskset_add_sorted_dl(struct rtf_taskset *ts, struct rtf_task *task)
 struct node_ptr *rtf_taskset_add_sorted_pr(struct rtf_taskset *ts,
     struct rtf_task *task)
 {
-    return list_add_sorted(&(ts->tasks), (void *) task,
-        rtf_taskset_cmp_period_dsc);
+    return rtf_taskset_insert(ts, task, rtf_taskset_cmp_period_dsc);
+}
+
+/**
+ * @internal
+ *
+ * The function adds the task in the taskset in a sorted-way. Task with
+ * relative deadline greater will be placed before task with relative deadline
+ * lower. If there is another task already in the taskset with equal relative
+ * deadline, the new task will be put after.
+ *
+ * @endinternal
+ */
+struct node_ptr *rtf_taskset_add_sorted_rdl(struct rtf_taskset *ts,
+    struct rtf_task *task)
+{
+    return rtf_taskset_insert(ts, task, rtf_taskset_cmp_rel_deadline_dsc);
 }
 
 /**
@@ -178,8 +290,7 @@ struct node_ptr *rtf_taskset_add_sorted_pr(struct rtf_taskset *ts,
 struct node_ptr *rtf_taskset_add_sorted_prio(struct rtf_taskset *ts,
     struct rtf_task *task)
 {
-    return list_add_sorted(&(ts->tasks), (void *) task,
-        rtf_taskset_cmp_priority_asc);
+    return rtf_taskset_insert(ts, task, rtf_taskset_cmp_priority_asc);
 }
 
 /**
@@ -192,7 +303,7 @@ struct node_ptr *rtf_taskset_add_sorted_prio(struct rtf_taskset *ts,
  */
 struct rtf_task *rtf_taskset_remove_top(struct rtf_taskset *ts)
 {
-    return (struct rtf_task *) list_remove_top(&(ts->tasks));
+    return rtf_taskset_remove_node(ts, ts->tasks.root);
 }
 
 /**
@@ -251,15 +362,18 @@ struct node_ptr *rtf_taskset_get_next_node(struct rtf_taskset *ts,
 /**
  * @internal
  *
- * The function ensures that the taskset is in a consistent
- * state before to be used.
+ * Looks up the reservation id index, without walking the list.
  *
  * @endinternal
  */
 struct rtf_task *rtf_taskset_search(struct rtf_taskset *ts, rtf_id_t rsvid)
 {
-    return list_search_elem(&(ts->tasks), (void *) &rsvid,
-        rtf_taskset_cmp_rsvid);
+    struct node_ptr *node = hmap_search(&(ts->by_rsvid), rsvid);
+
+    if (node == NULL)
+        return NULL;
+
+    return node->elem;
 }
 
 /**
@@ -305,15 +419,20 @@ void rtf_taskset_sort(struct rtf_taskset *ts, enum PARAM p, int flag)
 
 struct rtf_task *rtf_taskset_remove_by_ppid(struct rtf_taskset *ts, pid_t ppid)
 {
-    return (struct rtf_task *) list_remove(&(ts->tasks), (void *) &ppid,
-        rtf_taskset_cmp_ppid);
+    struct rtf_task *t;
+
+    t = list_search_elem(&(ts->tasks), (void *) &ppid, rtf_taskset_cmp_ppid);
+
+    if (t == NULL)
+        return NULL;
+
+    return rtf_taskset_remove_by_rsvid(ts, t->id);
 }
 
 struct rtf_task *rtf_taskset_remove_by_rsvid(struct rtf_taskset *ts,
     rtf_id_t rsvid)
 {
-    return (struct rtf_task *) list_remove(&(ts->tasks), (void *) &rsvid,
-        rtf_taskset_cmp_rsvid);
+    return rtf_taskset_remove_node(ts, hmap_search(&(ts->by_rsvid), rsvid));
 }
 
 void rtf_taskset_remove_all_by_ppid(struct rtf_taskset *ts, pid_t ppid)
@@ -7,12 +7,15 @@
  * This file contains the interface of a simple implementation of a taskset
  * namely a list taskset real time task. This is useful to store in the taskset
  * any custom element, using the a cast to (any_t). This implementation utilizes
- * list.h, an implementation of linked list of any_t element.
+ * list.h, an implementation of linked list of any_t element. Alongside the
+ * list, the taskset keeps a hash index (see hashmap.h) of the list nodes by
+ * reservation id, so that searches and removals do not walk the list.
  */
 
 #ifndef RETIF_TASKSET_H
 #define RETIF_TASKSET_H
 
+#include "hashmap.h"
 #include "list.h"
 #include "retif_task.h"
 
@@ -20,15 +23,34 @@
 // DATA STRUCTURES
 // ---------------------------------------------
 
+/**
+ * @brief Links of the task used by a taskset
+ *
+ * A task can be in a few tasksets at the same time: the taskset of the
+ * scheduler and the per-CPU taskset of its plugin. Each of them uses a
+ * different link embedded in the task (see struct rtf_task_link), so that
+ * adding a task does not allocate memory. Other tasksets allocate the nodes.
+ */
+enum TASKSET_LINK
+{
+    TASKSET_LINK_NONE = -1,
+    TASKSET_LINK_SCHED = 0,
+    TASKSET_LINK_PLUGIN = 1
+};
+
 /**
  * @brief Represent the taskset object
  *
  * The structure rtf_taskset contains a list. Inside
- * the taskset will be placed rt_tasks.
+ * the taskset will be placed rt_tasks. The index must be kept in sync with
+ * the list, so tasks must be added and removed only through this interface,
+ * and the id of a task must not change while it is in a taskset.
  */
 struct rtf_taskset
 {
     struct list tasks; /** the rt_task list  */
+    struct hmap by_rsvid; /** index of the list nodes by reservation id */
+    int link; /** link of the tasks used, see enum TASKSET_LINK */
 };
 
 // ---------------------------------------------
@@ -45,6 +67,28 @@ struct rtf_taskset
  */
 void rtf_taskset_init(struct rtf_taskset *ts);
 
+/**
+ * @brief Initialize the taskset to use the links embedded in the tasks
+ *
+ * Same as rtf_taskset_init(), but the taskset does not allocate memory to
+ * add a task, using instead the links of the task at position @p link. A
+ * task must not be in two tasksets that use the same link.
+ *
+ * @param ts pointer to the taskset to be initialized
+ * @param link one of TASKSET_LINK_SCHED or TASKSET_LINK_PLUGIN
+ */
+void rtf_taskset_init_linked(struct rtf_taskset *ts, int link);
+
+/**
+ * @brief Frees the memory used by the taskset
+ *
+ * Frees the list nodes and the indexes, but not the tasks themselves. The
+ * taskset is left empty and can be used again.
+ *
+ * @param ts pointer to the taskset to be destroyed
+ */
+void rtf_taskset_destroy(struct rtf_taskset *ts);
+
 /**
  * @brief Check if the taskset is empty
  *
@@ -106,6 +150,23 @@ void rtf_taskset_add_sorted_dl(struct rtf_taskset *ts, struct rtf_task *task);
 struct node_ptr *rtf_taskset_add_sorted_pr(struct rtf_taskset *ts,
     struct rtf_task *task);
 
+/**
+ * @brief Add the element to the taskset sorting by DSC relative deadline
+ *
+ * The relative deadline is the declared deadline, or the period if the
+ * deadline is not declared or is after it. Task with relative deadline
+ * greater will be placed before task with relative deadline lower, so that
+ * the tasks are sorted by increasing deadline monotonic priority. If there is
+ * another task already in the taskset with equal relative deadline, the new
+ * task will be put after.
+ *
+ * @param ts pointer to taskset to be used
+ * @param task pointer to the task to be added to the taskset
+ * @return the node of the task in the list
+ */
+struct node_ptr *rtf_taskset_add_sorted_rdl(struct rtf_taskset *ts,
+    struct rtf_task *task);
+
 struct node_ptr *rtf_taskset_add_sorted_prio(struct rtf_taskset *ts,
     struct rtf_task *task);
 
@@ -183,10 +244,40 @@ struct node_ptr *rtf_taskset_get_next_node(struct rtf_taskset *ts,
  */
 void rtf_taskset_sort(struct rtf_taskset *ts, enum PARAM p, int flag);
 
+/**
+ * @brief Search the task with the given reservation id
+ *
+ * The search uses the reservation id index, so it does not depend on the
+ * size of the taskset.
+ *
+ * @param ts pointer to taskset to be used
+ * @param rsvid the reservation id of the task
+ * @return pointer to the task or NULL if not found
+ */
 struct rtf_task *rtf_taskset_search(struct rtf_taskset *ts, rtf_id_t rsvid);
 
+/**
+ * @brief Remove one of the tasks with the given parent pid
+ *
+ * The task is searched walking the list. To release all the reservations of
+ * a client, use the per-client list kept by the scheduler instead.
+ *
+ * @param ts pointer to taskset to be used
+ * @param ppid the parent pid of the task
+ * @return pointer to the removed task or NULL if not found
+ */
 struct rtf_task *rtf_taskset_remove_by_ppid(struct rtf_taskset *ts, pid_t ppid);
 
+/**
+ * @brief Remove the task with the given reservation id
+ *
+ * The node of the task is found through the reservation id index and
+ * unlinked in constant time.
+ *
+ * @param ts pointer to taskset to be used
+ * @param rsvid the reservation id of the task
+ * @return pointer to the removed task or NULL if not found
+ */
 struct rtf_task *rtf_taskset_remove_by_rsvid(struct rtf_taskset *ts,
     rtf_id_t rsvid);
 
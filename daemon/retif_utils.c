@@ -216,3 +216,29 @@ int file_write_long(const char *fpath, long value)
     LOG(WARNING, "Could not write %ld in %s.\n", value, fpath);
     return 1;
 }
+
+int file_write_string(const char *fpath, const char *value)
+{
+    FILE *f = fopen(fpath, "w");
+    if (f == NULL)
+    {
+        LOG(WARNING, "Error opening %s in writing mode.\n", fpath);
+        LOG(WARNING, "%s", strerror(errno));
+        return -1;
+    }
+
+    int res = fprintf(f, "%s", value);
+
+    // sysfs and cgroup files report errors only when flushed
+    if (fclose(f) != 0)
+        res = -1;
+
+    if (res > 0)
+    {
+        LOG(DEBUG, "Written %s in %s.\n", value, fpath);
+        return 0;
+    }
+
+    LOG(WARNING, "Could not write %s in %s.\n", value, fpath);
+    return 1;
+}
@@ -110,5 +110,6 @@ int get_nprocs2(void);
 
 int file_read_long(const char *fpath, long *value);
 int file_write_long(const char *fpath, long value);
+int file_write_string(const char *fpath, const char *value);
 
 #endif // RETIF_UTILS_H
@@ -106,6 +106,7 @@ static inline int string_to_long(char *strvalue, long *out)
     char *endptr;
     long value;
     int ret = 0;
+    errno = 0;
     value = strtol(strvalue, &endptr, 10);
     if (errno != 0)
     {
@@ -131,6 +132,7 @@ static inline int string_to_double(char *strvalue, double *out)
     char *endptr;
     double value;
     int ret = 0;
+    errno = 0;
     value = strtod(strvalue, &endptr);
     if (errno != 0)
     {
@@ -293,7 +295,7 @@ static inline int yaml_parse_list(yaml_document_t *document, yaml_node_t *node,
 
     YAML_FOREACH_ITEM (document, node, i)
     {
-        void *new_elem = malloc(vector->item_size);
+        void *new_elem = calloc(1, vector->item_size);
         if (!new_elem)
         {
             ret = 1;
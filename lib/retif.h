@@ -65,6 +65,7 @@ struct rtf_params
     uint32_t priority; // priority of task [LOW_PRIO, HIGH_PRIO]
     char sched_plugin[PLUGIN_MAX_NAME]; // preferenced plugin to be used
     uint8_t ignore_admission; // preference to avoid test
+    uint32_t numa_node; // preferred NUMA node plus one, 0 for none
 };
 
 static const struct rtf_params RTF_PARAM_INIT = {0};
@@ -78,9 +79,10 @@ struct rtf_task
     struct rtf_params p; // preferred scheduling parameters
     struct timespec at; // next activation time
     struct timespec dl; // absolute deadline
+    int node; // NUMA node of the CPU assigned, valid once attached
 };
 
-static const struct rtf_task RTF_TASK_INIT = {0};
+static const struct rtf_task RTF_TASK_INIT = {.node = -1};
 
 struct rtf_client_info
 {
@@ -95,6 +97,7 @@ struct rtf_task_info
     int period;
     float util;
     int pluginid;
+    uint32_t id; // reservation id
 };
 struct rtf_plugin_info
 {
@@ -110,6 +113,38 @@ struct rtf_cpu_info
 
 #endif
 
+struct rtf_snapshot
+{
+    int nconnected; // entries of clients
+    int nplugin; // entries of plugins
+    int ncpu; // entries of cpus
+    int ntask; // entries of tasks
+    struct rtf_client_info *clients;
+    struct rtf_plugin_info *plugins;
+    struct rtf_cpu_info *cpus; // cputot entries per plugin, in plugin order
+    struct rtf_task_info *tasks;
+};
+
+static const struct rtf_snapshot RTF_SNAPSHOT_INIT = {0};
+
+struct rtf_reply;
+struct rtf_async;
+
+typedef void (*rtf_async_cb)(struct rtf_async *a, void *arg);
+
+struct rtf_async
+{
+    int result; // outcome of the request, valid once completed
+    struct rtf_task *t; // task the request refers to
+    rtf_async_cb callback; // called once completed, may be NULL
+    void *arg; // argument passed to the callback
+    uint32_t seq; // private: sequence number of the request
+    int done; // private: 1 once completed, -1 if the channel broke first
+    struct rtf_reply *rep; // private: where to copy the reply, may be NULL
+    void *body; // private: data received after the reply, if any
+    struct rtf_async *next; // private: next request in flight
+};
+
 // -----------------------------------------------------------------------------
 // GETTER / SETTER
 // -----------------------------------------------------------------------------
@@ -145,6 +180,13 @@ void rtf_params_get_scheduler(struct rtf_params *p,
 void rtf_params_ignore_admission(struct rtf_params *p,
     uint8_t ignore_admission);
 
+// the CPUs of the NUMA node are preferred when placing the task, a negative
+// node removes the preference
+void rtf_params_set_numa_node(struct rtf_params *p, int node);
+
+// returns the preferred NUMA node, -1 if none
+int rtf_params_get_numa_node(struct rtf_params *p);
+
 // -----------------------------------------------------------------------------
 // COMMUNICATION WITH DAEMON
 // -----------------------------------------------------------------------------
@@ -166,18 +208,86 @@ int rtf_plugin_info(unsigned int desc, struct rtf_plugin_info *data);
 int rtf_plugin_cpu_info(unsigned int desc, unsigned int cpuid,
     struct rtf_cpu_info *data);
 
+// copies client, plugin, CPU and task tables in s with a single request,
+// (re)allocating its tables; release them with rtf_snapshot_release()
+int rtf_tasks_snapshot(struct rtf_snapshot *s);
+
 void rtf_task_init(struct rtf_task *t);
 
 int rtf_task_create(struct rtf_task *t, struct rtf_params *p);
 
+// creates num tasks at once, results[i] is RTF_OK, RTF_PARTIAL or RTF_NO;
+// returns the number of tasks accepted (even partially) or RTF_ERROR
+int rtf_task_create_batch(struct rtf_task *t, struct rtf_params *p,
+    int *results, unsigned int num);
+
 int rtf_task_change(struct rtf_task *t, struct rtf_params *p);
 
+// if pid is the calling thread, its memory policy is also set to prefer the
+// NUMA node of the CPU it was attached to
 int rtf_task_attach(struct rtf_task *t, pid_t pid);
 
+// sets the memory policy of the calling thread to prefer the NUMA node of the
+// CPU the task was attached to
+int rtf_task_bind_node(struct rtf_task *t);
+
+// attaches pids[i] to t[i], results[i] is RTF_OK or RTF_FAIL;
+// returns the number of threads attached or RTF_ERROR
+int rtf_task_attach_batch(struct rtf_task *t, pid_t *pids, int *results,
+    unsigned int num);
+
 int rtf_task_detach(struct rtf_task *t);
 
 int rtf_task_release(struct rtf_task *t);
 
+// -----------------------------------------------------------------------------
+// ASYNCHRONOUS COMMUNICATION WITH DAEMON
+// -----------------------------------------------------------------------------
+
+// Requests are tagged with a sequence number and many of them can be in
+// flight on the same connection; the rtf_async handle must stay valid until
+// the request is completed and, if it has a callback, until the callback has
+// been called. On completion, result is RTF_OK, RTF_PARTIAL or RTF_NO for a
+// creation and RTF_OK or RTF_FAIL for an attach. If the connection breaks,
+// requests in flight complete with RTF_ERROR.
+//
+// The callback runs in the thread that received the reply, after the request
+// has been marked completed and with no lock held: it may submit other
+// requests, wait for them and call the synchronous functions. It may also
+// release the handle, which the library does not touch afterwards, provided
+// that no other thread is waiting on it.
+
+void rtf_async_init(struct rtf_async *a, rtf_async_cb callback, void *arg);
+
+int rtf_task_create_async(struct rtf_task *t, struct rtf_params *p,
+    struct rtf_async *a);
+
+int rtf_task_attach_async(struct rtf_task *t, pid_t pid, struct rtf_async *a);
+
+// returns RTF_OK if completed, RTF_FAIL if still in flight, RTF_ERROR if the
+// connection with the daemon is broken; it never blocks
+int rtf_async_poll(struct rtf_async *a);
+
+// waits for completion, returns RTF_OK or RTF_ERROR as rtf_async_poll()
+int rtf_async_wait(struct rtf_async *a);
+
+// -----------------------------------------------------------------------------
+// STATUS PAGE (READ-ONLY SHARED MEMORY)
+// -----------------------------------------------------------------------------
+
+// maps the status page published by the daemon, no connection is needed
+int rtf_status_open();
+
+// copies a consistent snapshot of the daemon state in s, (re)allocating its
+// tables; returns RTF_OK, RTF_FAIL if the daemon is busy writing the page for
+// too long, RTF_ERROR if the page is not mapped
+int rtf_status_read(struct rtf_snapshot *s);
+
+void rtf_status_close();
+
+// frees the tables allocated by rtf_status_read() or rtf_tasks_snapshot()
+void rtf_snapshot_release(struct rtf_snapshot *s);
+
 // -----------------------------------------------------------------------------
 // LOCAL COMMUNICATIONS
 // -----------------------------------------------------------------------------
@@ -1,9 +1,17 @@
 
 #include "retif.h"
 #include "retif_channel.h"
+#include "retif_shm.h"
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -21,32 +29,444 @@
 #define TIMER_ABSTIME 0x01
 #endif
 
+// -----------------------------------------------------------------------------
+// NUMA NODES
+// -----------------------------------------------------------------------------
+
+#define NODE_MASK_BITS (8 * sizeof(unsigned long))
+#define NODE_MASK_LONGS 16 // up to 1024 nodes
+
 // -----------------------------------------------------------------------------
 // THREAD STUFF
 // -----------------------------------------------------------------------------
 
 static struct rtf_access main_channel;
+
+// requests in flight on main_channel, matched to replies by sequence number
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct rtf_async *pending;
+static uint32_t last_seq;
+static int reading; // a thread is receiving replies for everybody
+static int failed; // the channel is broken
+
+// a callback being run, its handle must not be reused by whoever waits on it
+struct rtf_async_call
+{
+    struct rtf_async *a;
+    pthread_t thread;
+    struct rtf_async_call *next;
+};
+
+static struct rtf_async_call *calls; // callbacks run by the readers
+static struct rtf_async *aborted; // callbacks still to be run by the abort
+static struct rtf_async *abort_call; // callback being run by the abort
+static pthread_t abort_thread;
 
 struct LOGGER *logger;
 
-static int rtf_task_communicate(struct rtf_access *c)
+static void rtf_async_complete(struct rtf_async *a, struct rtf_reply *rep)
+{
+    if (a->rep != NULL)
+        memcpy(a->rep, rep, sizeof(struct rtf_reply));
+
+    switch (rep->rep_type)
+    {
+    case RTF_TASK_CREATE_OK:
+    case RTF_TASK_CREATE_PART:
+        if (a->t != NULL)
+            a->t->task_id = (uint32_t) rep->payload.response;
+        a->result =
+            rep->rep_type == RTF_TASK_CREATE_OK ? RTF_OK : RTF_PARTIAL;
+        break;
+    case RTF_TASK_CREATE_ERR:
+        a->result = RTF_NO;
+        break;
+    case RTF_TASK_ATTACH_OK:
+        if (a->t != NULL)
+            a->t->node = rep->payload.attach.node;
+        a->result = RTF_OK;
+        break;
+    default:
+        a->result = RTF_FAIL;
+    }
+}
+
+// takes the request matching the reply out of the pending list
+static struct rtf_async *rtf_async_dequeue(struct rtf_reply *rep)
+{
+    struct rtf_async **a;
+    struct rtf_async *found;
+
+    for (a = &pending; *a != NULL; a = &((*a)->next))
+    {
+        if ((*a)->seq != rep->seq)
+            continue;
+
+        found = *a;
+        *a = found->next;
+        return found;
+    }
+
+    return NULL;
+}
+
+// Receives the snapshot that follows its reply into a page laid out as the
+// status page. Sets @p ret to -1 if the body cannot be received.
+static void *rtf_async_recv_page(struct rtf_reply *rep, int *ret)
+{
+    struct rtf_status_page *p;
+    struct rtf_snapshot_info *info = &rep->payload.snapshot;
+
+    p = malloc(sizeof(struct rtf_status_page) + info->size);
+
+    if (p == NULL || (info->size > 0 &&
+                         rtf_access_recv_data(&main_channel, p + 1,
+                             info->size) != info->size))
+    {
+        free(p);
+        *ret = RTF_ERROR;
+        return NULL;
+    }
+
+    p->size = sizeof(struct rtf_status_page) + info->size;
+    p->nconnected = info->nconnected;
+    p->nplugin = info->nplugin;
+    p->ncpu = info->ncpu;
+    p->ntask = info->ntask;
+
+    return p;
+}
+
+// Some replies are followed by a variable-length body, which is received
+// right away: the snapshot as a status page, the ids and the results of a
+// batch as they are. Sets @p ret to -1 if the body cannot be received.
+static void *rtf_async_recv_body(struct rtf_reply *rep, int *ret)
+{
+    uint32_t num = rep->payload.batch.num;
+    void *body;
+
+    if (rep->rep_type == RTF_TASKS_SNAPSHOT_OK)
+        return rtf_async_recv_page(rep, ret);
+
+    if (rep->rep_type != RTF_TASK_CREATE_BATCH_OK &&
+        rep->rep_type != RTF_TASK_ATTACH_BATCH_OK)
+        return NULL;
+
+    body = num > 0 && num <= RTF_BATCH_MAX ? malloc(RTF_BATCH_SIZE(num)) : NULL;
+
+    if (body == NULL || rtf_access_recv_data(&main_channel, body,
+                            RTF_BATCH_SIZE(num)) != (int) RTF_BATCH_SIZE(num))
+    {
+        free(body);
+        *ret = RTF_ERROR;
+        return NULL;
+    }
+
+    return body;
+}
+
+// sends @p req followed by @p size bytes of @p data, if any
+static int rtf_async_submit(struct rtf_request *req, void *data, size_t size,
+    struct rtf_async *a)
 {
-    int ret = RTF_ERROR;
+    struct rtf_async **it;
+    int ret;
 
     pthread_mutex_lock(&mutex);
 
-    if (rtf_access_send(c) != RTF_ERROR)
-        ret = rtf_access_recv(c);
+    if (failed)
+    {
+        pthread_mutex_unlock(&mutex);
+        return RTF_ERROR;
+    }
+
+    a->done = 0;
+    a->seq = req->seq = ++last_seq;
+    a->next = pending;
+    pending = a;
 
     pthread_mutex_unlock(&mutex);
 
-    if (ret == RTF_ERROR)
+    pthread_mutex_lock(&send_mutex);
+    if (size > 0)
+        ret = rtf_access_send_data(&main_channel, req, data, size);
+    else
+        ret = rtf_access_send(&main_channel, req);
+    pthread_mutex_unlock(&send_mutex);
+
+    if (ret == (int) (sizeof(struct rtf_request) + size))
+        return RTF_OK;
+
+    pthread_mutex_lock(&mutex);
+
+    for (it = &pending; *it != NULL; it = &((*it)->next))
+    {
+        if (*it != a)
+            continue;
+
+        *it = a->next;
+        break;
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return RTF_ERROR;
+}
+
+// Returns 1 if the callback of @p a has still to return in another thread.
+// Called with the mutex held.
+static int rtf_async_running(struct rtf_async *a)
+{
+    pthread_t self = pthread_self();
+    struct rtf_async_call *c;
+    struct rtf_async *it;
+
+    for (c = calls; c != NULL; c = c->next)
+        if (c->a == a && !pthread_equal(c->thread, self))
+            return 1;
+
+    if ((aborted == NULL && abort_call == NULL) ||
+        pthread_equal(abort_thread, self))
+        return 0;
+
+    if (a == abort_call)
+        return 1;
+
+    for (it = aborted; it != NULL; it = it->next)
+        if (it == a)
+            return 1;
+
+    return 0;
+}
+
+// Completes with RTF_ERROR every request still in flight once the channel
+// is broken, then runs their callbacks one at a time with no lock held.
+// Handles without a callback can be dropped by their owners as soon as they
+// are marked done; the ones with a callback stay valid until it has been
+// called, so they are kept in the aborted list until then.
+static void rtf_async_abort()
+{
+    struct rtf_async *a, *next;
+    rtf_async_cb callback;
+    void *arg;
+
+    pthread_mutex_lock(&mutex);
+    failed = 1;
+
+    for (a = pending; a != NULL; a = next)
+    {
+        next = a->next;
+        a->next = NULL;
+        a->result = RTF_ERROR;
+        a->body = NULL;
+        a->done = -1;
+
+        if (a->callback == NULL)
+            continue;
+
+        a->next = aborted;
+        aborted = a;
+        abort_thread = pthread_self();
+    }
+
+    pending = NULL;
+    pthread_cond_broadcast(&cond);
+
+    // only the thread that took the requests runs their callbacks
+    while (aborted != NULL && pthread_equal(abort_thread, pthread_self()))
+    {
+        abort_call = aborted;
+        aborted = abort_call->next;
+        abort_call->next = NULL;
+        callback = abort_call->callback;
+        arg = abort_call->arg;
+        pthread_mutex_unlock(&mutex);
+
+        callback(abort_call, arg);
+
+        pthread_mutex_lock(&mutex);
+        abort_call = NULL;
+        pthread_cond_broadcast(&cond);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+// Receives replies until @p a is completed. One thread at a time reads from
+// the channel and completes the requests of everybody, while the others wait
+// on the condition variable. Without @p block, it reads only the replies that
+// are already available. A request is marked done and the reader role is
+// given up before its callback runs, so that the callback can issue and wait
+// for other requests, and release the handle. Waiting on a request whose
+// callback is running in another thread lasts until the callback returns.
+// Returns RTF_OK if @p a is completed, RTF_FAIL if it is still in flight,
+// RTF_ERROR if the channel is broken.
+static int rtf_async_progress(struct rtf_async *a, int block)
+{
+    struct pollfd pfd = {.fd = main_channel.sock.socket, .events = POLLIN};
+    struct rtf_async_call call, **it;
+    struct rtf_async *found;
+    struct rtf_reply rep;
+    rtf_async_cb callback;
+    void *body, *arg;
+    int ret, idle, broken;
+
+    pthread_mutex_lock(&mutex);
+
+    while (!a->done || rtf_async_running(a))
+    {
+        if (a->done || reading)
+        {
+            if (!block)
+                break;
+
+            pthread_cond_wait(&cond, &mutex);
+            continue;
+        }
+
+        if (failed)
+            break;
+
+        reading = 1;
+        pthread_mutex_unlock(&mutex);
+
+        ret = 1;
+        if (!block)
+            ret = poll(&pfd, 1, 0);
+        idle = ret == 0;
+        if (ret > 0)
+            ret = rtf_access_recv(&main_channel, &rep);
+
+        body = NULL;
+        if (ret == sizeof(struct rtf_reply))
+            body = rtf_async_recv_body(&rep, &ret);
+
+        pthread_mutex_lock(&mutex);
+
+        found = NULL;
+        if (ret == sizeof(struct rtf_reply))
+            found = rtf_async_dequeue(&rep);
+
+        callback = NULL;
+        arg = NULL;
+        if (found != NULL)
+        {
+            found->body = body;
+            rtf_async_complete(found, &rep);
+            callback = found->callback;
+            arg = found->arg;
+            found->done = 1;
+        }
+
+        if (callback != NULL)
+        {
+            call.a = found;
+            call.thread = pthread_self();
+            call.next = calls;
+            calls = &call;
+        }
+
+        broken = found == NULL && !idle && ret != sizeof(struct rtf_reply);
+        reading = 0;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+
+        if (found == NULL)
+            free(body);
+
+        if (broken)
+            rtf_async_abort();
+
+        // the callback may release the handle, which is not touched afterwards
+        if (callback != NULL)
+            callback(found, arg);
+
+        pthread_mutex_lock(&mutex);
+
+        if (callback != NULL)
+        {
+            for (it = &calls; *it != &call; it = &((*it)->next))
+                ;
+
+            *it = call.next;
+            pthread_cond_broadcast(&cond);
+        }
+
+        if (found == a)
+        {
+            pthread_mutex_unlock(&mutex);
+            return RTF_OK;
+        }
+
+        if (idle)
+            break;
+    }
+
+    if (a->done && rtf_async_running(a))
+        ret = RTF_FAIL;
+    else
+        ret = a->done > 0 ? RTF_OK
+              : a->done < 0 || failed ? RTF_ERROR
+                                      : RTF_FAIL;
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+static int rtf_task_communicate_data(struct rtf_request *req, void *data,
+    size_t size, struct rtf_reply *rep)
+{
+    struct rtf_async a;
+
+    rtf_async_init(&a, NULL, NULL);
+    a.rep = rep;
+
+    if (rtf_async_submit(req, data, size, &a) < 0)
+        return RTF_ERROR;
+
+    if (rtf_async_progress(&a, 1) != RTF_OK)
         return RTF_ERROR;
 
     return RTF_OK;
 }
 
+static int rtf_task_communicate(struct rtf_request *req, struct rtf_reply *rep)
+{
+    return rtf_task_communicate_data(req, NULL, 0, rep);
+}
+
+// Sends a batch of @p num entries of @p size bytes and waits for the ids and
+// the results that follow the reply, stored in @p body, which the caller
+// frees.
+static int rtf_task_communicate_batch(struct rtf_request *req, void *data,
+    unsigned int num, size_t size, void **body)
+{
+    struct rtf_reply rep;
+    struct rtf_async a;
+
+    req->payload.batch.num = num;
+
+    rtf_async_init(&a, NULL, NULL);
+    a.rep = &rep;
+
+    if (rtf_async_submit(req, data, num * size, &a) < 0)
+        return RTF_ERROR;
+
+    if (rtf_async_progress(&a, 1) != RTF_OK)
+        return RTF_ERROR;
+
+    // refused batches have no body
+    if (a.body == NULL || rep.payload.batch.num != num)
+    {
+        free(a.body);
+        return RTF_ERROR;
+    }
+
+    *body = a.body;
+    return RTF_OK;
+}
+
 // -----------------------------------------------------------------------------
 // TIME UTILS
 // -----------------------------------------------------------------------------
@@ -207,27 +627,214 @@ void rtf_params_ignore_admission(struct rtf_params *p, uint8_t ignore_admission)
     p->ignore_admission = ignore_admission;
 }
 
+void rtf_params_set_numa_node(struct rtf_params *p, int node)
+{
+    p->numa_node = node < 0 ? 0 : node + 1;
+}
+
+int rtf_params_get_numa_node(struct rtf_params *p)
+{
+    return (int) p->numa_node - 1;
+}
+
+// -----------------------------------------------------------------------------
+// STATUS PAGE (READ-ONLY SHARED MEMORY)
+// -----------------------------------------------------------------------------
+
+#define STATUS_READ_RETRY 1000
+
+static int status_fd = -1;
+static size_t status_size;
+static struct rtf_status_page *status_page;
+
+// maps the whole shared memory object, which the daemon may have grown
+static int rtf_status_map()
+{
+    struct stat st;
+    void *page;
+
+    if (fstat(status_fd, &st) < 0 || st.st_size < sizeof(*status_page))
+        return RTF_ERROR;
+
+    page = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, status_fd, 0);
+
+    if (page == MAP_FAILED)
+        return RTF_ERROR;
+
+    if (status_page != NULL)
+        munmap(status_page, status_size);
+
+    status_page = page;
+    status_size = st.st_size;
+
+    return RTF_OK;
+}
+
+static int rtf_snapshot_reserve(struct rtf_snapshot *s, uint32_t nconnected,
+    uint32_t nplugin, uint32_t ncpu, uint32_t ntask)
+{
+    void *clients, *plugins, *cpus, *tasks;
+
+    clients = realloc(s->clients, (nconnected + 1) * sizeof(*s->clients));
+    if (clients != NULL)
+        s->clients = clients;
+
+    plugins = realloc(s->plugins, (nplugin + 1) * sizeof(*s->plugins));
+    if (plugins != NULL)
+        s->plugins = plugins;
+
+    cpus = realloc(s->cpus, (ncpu + 1) * sizeof(*s->cpus));
+    if (cpus != NULL)
+        s->cpus = cpus;
+
+    tasks = realloc(s->tasks, (ntask + 1) * sizeof(*s->tasks));
+    if (tasks != NULL)
+        s->tasks = tasks;
+
+    if (!clients || !plugins || !cpus || !tasks)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+// copies the tables that follow @p p, laid out as in the status page
+static int rtf_snapshot_copy(struct rtf_snapshot *s, struct rtf_status_page *p,
+    uint32_t nconnected, uint32_t nplugin, uint32_t ncpu, uint32_t ntask)
+{
+    if (rtf_snapshot_reserve(s, nconnected, nplugin, ncpu, ntask) < 0)
+        return RTF_ERROR;
+
+    s->nconnected = nconnected;
+    s->nplugin = nplugin;
+    s->ncpu = ncpu;
+    s->ntask = ntask;
+    memcpy(s->clients, rtf_status_clients(p),
+        nconnected * sizeof(struct rtf_client_info));
+    memcpy(s->plugins, rtf_status_plugins(p, nconnected),
+        nplugin * sizeof(struct rtf_plugin_info));
+    memcpy(s->cpus, rtf_status_cpus(p, nconnected, nplugin),
+        ncpu * sizeof(struct rtf_cpu_info));
+    memcpy(s->tasks, rtf_status_tasks(p, nconnected, nplugin, ncpu),
+        ntask * sizeof(struct rtf_task_info));
+
+    return RTF_OK;
+}
+
+int rtf_status_open()
+{
+    if (status_page != NULL)
+        return RTF_OK;
+
+    status_fd = shm_open(STATUS_SHM_NAME, O_RDONLY, 0);
+
+    if (status_fd < 0)
+        return RTF_ERROR;
+
+    if (rtf_status_map() < 0 || status_page->magic != STATUS_MAGIC)
+    {
+        rtf_status_close();
+        return RTF_ERROR;
+    }
+
+    return RTF_OK;
+}
+
+int rtf_status_read(struct rtf_snapshot *s)
+{
+    struct rtf_status_page *p;
+    uint32_t seq, nconnected, nplugin, ncpu, ntask;
+    size_t size;
+
+    if (status_page == NULL)
+        return RTF_ERROR;
+
+    for (int i = 0; i < STATUS_READ_RETRY; i++)
+    {
+        p = status_page;
+        seq = __atomic_load_n(&p->seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1)
+        {
+            sched_yield();
+            continue;
+        }
+
+        nconnected = p->nconnected;
+        nplugin = p->nplugin;
+        ncpu = p->ncpu;
+        ntask = p->ntask;
+        size = rtf_status_page_size(nconnected, nplugin, ncpu, ntask);
+
+        // the daemon has grown the page, map it again and retry
+        if (size > status_size || p->size > status_size)
+        {
+            if (rtf_status_map() < 0)
+                return RTF_ERROR;
+            continue;
+        }
+
+        if (rtf_snapshot_copy(s, p, nconnected, nplugin, ncpu, ntask) < 0)
+            return RTF_ERROR;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&p->seq, __ATOMIC_RELAXED) == seq)
+            return RTF_OK;
+    }
+
+    return RTF_FAIL;
+}
+
+void rtf_status_close()
+{
+    if (status_page != NULL)
+        munmap(status_page, status_size);
+
+    if (status_fd >= 0)
+        close(status_fd);
+
+    status_page = NULL;
+    status_size = 0;
+    status_fd = -1;
+}
+
+void rtf_snapshot_release(struct rtf_snapshot *s)
+{
+    free(s->clients);
+    free(s->plugins);
+    free(s->cpus);
+    free(s->tasks);
+    *s = RTF_SNAPSHOT_INIT;
+}
+
 // -----------------------------------------------------------------------------
 // COMMUNICATION WITH DAEMON
 // -----------------------------------------------------------------------------
 
 int rtf_connect()
 {
+    struct rtf_request req;
+    struct rtf_reply rep;
+
     if (rtf_access_init(&main_channel) < 0)
         return RTF_ERROR;
 
     if (rtf_access_connect(&main_channel) < 0)
         return RTF_ERROR;
 
-    main_channel.req.req_type = RTF_CONNECTION;
-    main_channel.req.payload.ids.pid = getpid();
+    // requests in flight on a broken channel have been completed with errors
+    pthread_mutex_lock(&mutex);
+    failed = 0;
+    pending = NULL;
+    pthread_mutex_unlock(&mutex);
 
-    if (rtf_access_send(&main_channel) < 0)
-        return RTF_ERROR;
-    if (rtf_access_recv(&main_channel) < 0)
+    req.req_type = RTF_CONNECTION;
+    req.payload.ids.pid = getpid();
+
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (main_channel.rep.rep_type == RTF_CONNECTION_ERR)
+    if (rep.rep_type == RTF_CONNECTION_ERR)
         return RTF_FAIL;
 
     return RTF_OK;
@@ -235,142 +842,238 @@ int rtf_connect()
 
 int rtf_connections_info()
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_CONNECTIONS_INFO;
+    req.req_type = RTF_CONNECTIONS_INFO;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    return channel->rep.payload.nconnected;
+    return rep.payload.nconnected;
 }
 
 int rtf_plugins_info()
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_PLUGINS_INFO;
+    req.req_type = RTF_PLUGINS_INFO;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    return channel->rep.payload.nplugin;
+    return rep.payload.nplugin;
 }
 
 int rtf_tasks_info()
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_TASKS_INFO;
+    req.req_type = RTF_TASKS_INFO;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    return channel->rep.payload.ntask;
+    return rep.payload.ntask;
 }
 
 int rtf_connection_info(unsigned int desc, struct rtf_client_info *data)
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_CONNECTION_INFO;
-    channel->req.payload.q.desc = desc;
+    req.req_type = RTF_CONNECTION_INFO;
+    req.payload.q.desc = desc;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (channel->rep.rep_type == RTF_CONNECTION_INFO_ERR)
+    if (rep.rep_type == RTF_CONNECTION_INFO_ERR)
         return RTF_ERROR;
 
-    memcpy(data, &channel->rep.payload.client, sizeof(struct rtf_client_info));
+    memcpy(data, &rep.payload.client, sizeof(struct rtf_client_info));
     return RTF_OK;
 }
 
 int rtf_task_info(unsigned int desc, struct rtf_task_info *data)
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_TASK_INFO;
-    channel->req.payload.q.desc = desc;
+    req.req_type = RTF_TASK_INFO;
+    req.payload.q.desc = desc;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (channel->rep.rep_type == RTF_TASK_INFO_ERR)
+    if (rep.rep_type == RTF_TASK_INFO_ERR)
         return RTF_ERROR;
 
-    memcpy(data, &channel->rep.payload.task, sizeof(struct rtf_task_info));
+    memcpy(data, &rep.payload.task, sizeof(struct rtf_task_info));
     return RTF_OK;
 }
 
 int rtf_plugin_info(unsigned int desc, struct rtf_plugin_info *data)
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_PLUGIN_INFO;
-    channel->req.payload.q.desc = desc;
+    req.req_type = RTF_PLUGIN_INFO;
+    req.payload.q.desc = desc;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (channel->rep.rep_type == RTF_PLUGIN_INFO_ERR)
+    if (rep.rep_type == RTF_PLUGIN_INFO_ERR)
         return RTF_ERROR;
 
-    memcpy(data, &channel->rep.payload.plugin, sizeof(struct rtf_plugin_info));
+    memcpy(data, &rep.payload.plugin, sizeof(struct rtf_plugin_info));
     return RTF_OK;
 }
 
 int rtf_plugin_cpu_info(unsigned int desc, unsigned int cpuid,
     struct rtf_cpu_info *data)
 {
-    struct rtf_access *channel = &main_channel;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    channel->req.req_type = RTF_PLUGIN_CPU_INFO;
-    channel->req.payload.q.desc = desc;
-    channel->req.payload.q.id = cpuid;
+    req.req_type = RTF_PLUGIN_CPU_INFO;
+    req.payload.q.desc = desc;
+    req.payload.q.id = cpuid;
 
-    if (rtf_task_communicate(channel) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (channel->rep.rep_type == RTF_PLUGIN_CPU_INFO_ERR)
+    if (rep.rep_type == RTF_PLUGIN_CPU_INFO_ERR)
         return RTF_ERROR;
 
-    memcpy(data, &channel->rep.payload.cpu, sizeof(struct rtf_cpu_info));
+    memcpy(data, &rep.payload.cpu, sizeof(struct rtf_cpu_info));
     return RTF_OK;
 }
 
+int rtf_tasks_snapshot(struct rtf_snapshot *s)
+{
+    struct rtf_request req;
+    struct rtf_reply rep;
+    struct rtf_status_page *p;
+    struct rtf_async a;
+    int ret;
+
+    req.req_type = RTF_TASKS_SNAPSHOT;
+
+    rtf_async_init(&a, NULL, NULL);
+    a.rep = &rep;
+
+    if (rtf_async_submit(&req, NULL, 0, &a) < 0)
+        return RTF_ERROR;
+
+    if (rtf_async_progress(&a, 1) != RTF_OK)
+        return RTF_ERROR;
+
+    if (rep.rep_type != RTF_TASKS_SNAPSHOT_OK || a.body == NULL)
+        return RTF_ERROR;
+
+    p = a.body;
+
+    // the daemon may be older or newer, never read past what was received
+    if (rtf_status_page_size(p->nconnected, p->nplugin, p->ncpu, p->ntask) >
+        p->size)
+        ret = RTF_ERROR;
+    else
+        ret = rtf_snapshot_copy(s, p, p->nconnected, p->nplugin, p->ncpu,
+            p->ntask);
+
+    free(p);
+    return ret;
+}
+
 void rtf_task_init(struct rtf_task *t)
 {
     t->c = &main_channel;
     t->task_id = 0;
+    t->node = -1;
 }
 
 int rtf_task_create(struct rtf_task *t, struct rtf_params *p)
 {
-    t->c->req.req_type = RTF_TASK_CREATE;
+    struct rtf_request req;
+    struct rtf_reply rep;
+
+    req.req_type = RTF_TASK_CREATE;
     memcpy(&(t->p), p, sizeof(struct rtf_params));
-    memcpy(&(t->c->req.payload.param), p, sizeof(struct rtf_params));
+    memcpy(&(req.payload.param), p, sizeof(struct rtf_params));
 
-    if (rtf_task_communicate(t->c) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (t->c->rep.rep_type == RTF_TASK_CREATE_ERR)
+    if (rep.rep_type == RTF_TASK_CREATE_ERR)
         return RTF_FAIL;
 
-    t->task_id = (uint32_t) t->c->rep.payload.response;
+    t->task_id = (uint32_t) rep.payload.response;
     return RTF_OK;
 }
 
+int rtf_task_create_batch(struct rtf_task *t, struct rtf_params *p,
+    int *results, unsigned int num)
+{
+    struct rtf_request req;
+    unsigned int i, j, n;
+    rtf_id_t *ids;
+    int *res;
+    int accepted = 0;
+
+    // sets larger than RTF_BATCH_MAX are sent in chunks, and if one fails the
+    // reservations created by the previous ones are released
+    for (i = 0; i < num; i += n)
+    {
+        n = num - i < RTF_BATCH_MAX ? num - i : RTF_BATCH_MAX;
+        req.req_type = RTF_TASK_CREATE_BATCH;
+
+        if (rtf_task_communicate_batch(&req, &p[i], n,
+                sizeof(struct rtf_params), (void **) &ids) < 0)
+        {
+            for (j = 0; j < i; j++)
+                if (results[j] != RTF_NO)
+                    rtf_task_release(&t[j]);
+
+            return RTF_ERROR;
+        }
+
+        res = (int *) (ids + n);
+
+        for (j = 0; j < n; j++)
+        {
+            t[i + j].c = &main_channel;
+            t[i + j].task_id = ids[j];
+            memcpy(&(t[i + j].p), &p[i + j], sizeof(struct rtf_params));
+            results[i + j] = res[j];
+
+            if (results[i + j] != RTF_NO)
+                accepted++;
+        }
+
+        free(ids);
+    }
+
+    return accepted;
+}
+
 int rtf_task_change(struct rtf_task *t, struct rtf_params *p)
 {
-    t->c->req.req_type = RTF_TASK_MODIFY;
+    struct rtf_request req;
+    struct rtf_reply rep;
+
+    req.req_type = RTF_TASK_MODIFY;
+    req.payload.modify.rsvid = t->task_id;
     memcpy(&(t->p), p, sizeof(struct rtf_params));
-    memcpy(&(t->c->req.payload.param), p, sizeof(struct rtf_params));
+    memcpy(&(req.payload.modify.param), p, sizeof(struct rtf_params));
 
-    if (rtf_task_communicate(t->c) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (t->c->rep.rep_type == RTF_TASK_MODIFY_ERR)
+    if (rep.rep_type == RTF_TASK_MODIFY_ERR)
         return RTF_FAIL;
 
     return RTF_OK;
@@ -378,28 +1081,116 @@ int rtf_task_change(struct rtf_task *t, struct rtf_params *p)
 
 int rtf_task_attach(struct rtf_task *t, pid_t pid)
 {
-    t->c->req.req_type = RTF_TASK_ATTACH;
-    t->c->req.payload.ids.rsvid = t->task_id;
-    t->c->req.payload.ids.pid = pid;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    if (rtf_task_communicate(t->c) < 0)
+    req.req_type = RTF_TASK_ATTACH;
+    req.payload.ids.rsvid = t->task_id;
+    req.payload.ids.pid = pid;
+
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (t->c->rep.rep_type == RTF_TASK_ATTACH_ERR)
+    if (rep.rep_type == RTF_TASK_ATTACH_ERR)
         return RTF_FAIL;
 
+    t->node = rep.payload.attach.node;
+
+    // the memory policy can be set only by the thread itself, failing to set
+    // it does not undo the attach
+    if (pid == syscall(SYS_gettid))
+        rtf_task_bind_node(t);
+
     return RTF_OK;
 }
 
+int rtf_task_bind_node(struct rtf_task *t)
+{
+    unsigned long mask[NODE_MASK_LONGS];
+
+    if (t->node < 0 || t->node >= NODE_MASK_LONGS * NODE_MASK_BITS)
+        return RTF_FAIL;
+
+    memset(mask, 0, sizeof(mask));
+    mask[t->node / NODE_MASK_BITS] = 1UL << (t->node % NODE_MASK_BITS);
+
+    // the kernel reads one bit less than the number given
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+            NODE_MASK_LONGS * NODE_MASK_BITS + 1) < 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+int rtf_task_attach_batch(struct rtf_task *t, pid_t *pids, int *results,
+    unsigned int num)
+{
+    struct rtf_request req;
+    struct rtf_ids *ids;
+    unsigned int i, j, n;
+    rtf_id_t *rsvids;
+    int *res;
+    int attached = 0;
+
+    ids = malloc((num < RTF_BATCH_MAX ? num : RTF_BATCH_MAX) *
+                 sizeof(struct rtf_ids));
+
+    if (ids == NULL && num > 0)
+        return RTF_ERROR;
+
+    // sets larger than RTF_BATCH_MAX are sent in chunks, and if one fails the
+    // threads attached by the previous ones are detached
+    for (i = 0; i < num; i += n)
+    {
+        n = num - i < RTF_BATCH_MAX ? num - i : RTF_BATCH_MAX;
+        req.req_type = RTF_TASK_ATTACH_BATCH;
+
+        for (j = 0; j < n; j++)
+        {
+            ids[j].rsvid = t[i + j].task_id;
+            ids[j].pid = pids[i + j];
+        }
+
+        if (rtf_task_communicate_batch(&req, ids, n, sizeof(struct rtf_ids),
+                (void **) &rsvids) < 0)
+        {
+            for (j = 0; j < i; j++)
+                if (results[j] == RTF_OK)
+                    rtf_task_detach(&t[j]);
+
+            free(ids);
+            return RTF_ERROR;
+        }
+
+        res = (int *) (rsvids + n);
+
+        for (j = 0; j < n; j++)
+        {
+            results[i + j] = res[j] == RTF_OK ? RTF_OK : RTF_FAIL;
+
+            if (results[i + j] == RTF_OK)
+                attached++;
+        }
+
+        free(rsvids);
+    }
+
+    free(ids);
+    return attached;
+}
+
 int rtf_task_detach(struct rtf_task *t)
 {
-    t->c->req.req_type = RTF_TASK_DETACH;
-    t->c->req.payload.ids.rsvid = t->task_id;
+    struct rtf_request req;
+    struct rtf_reply rep;
 
-    if (rtf_task_communicate(t->c) < 0)
+    req.req_type = RTF_TASK_DETACH;
+    req.payload.ids.rsvid = t->task_id;
+
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (t->c->rep.rep_type == RTF_TASK_DETACH_ERR)
+    if (rep.rep_type == RTF_TASK_DETACH_ERR)
         return RTF_FAIL;
 
     return RTF_OK;
@@ -407,18 +1198,71 @@ int rtf_task_detach(struct rtf_task *t)
 
 int rtf_task_release(struct rtf_task *t)
 {
-    t->c->req.req_type = RTF_TASK_DESTROY;
-    t->c->req.payload.ids.rsvid = t->task_id;
+    struct rtf_request req;
+    struct rtf_reply rep;
+
+    req.req_type = RTF_TASK_DESTROY;
+    req.payload.ids.rsvid = t->task_id;
 
-    if (rtf_task_communicate(t->c) < 0)
+    if (rtf_task_communicate(&req, &rep) < 0)
         return RTF_ERROR;
 
-    if (t->c->rep.rep_type == RTF_TASK_DESTROY_ERR)
+    if (rep.rep_type == RTF_TASK_DESTROY_ERR)
         return RTF_FAIL;
 
     return RTF_OK;
 }
 
+// -----------------------------------------------------------------------------
+// ASYNCHRONOUS COMMUNICATION WITH DAEMON
+// -----------------------------------------------------------------------------
+
+void rtf_async_init(struct rtf_async *a, rtf_async_cb callback, void *arg)
+{
+    memset(a, 0, sizeof(struct rtf_async));
+    a->callback = callback;
+    a->arg = arg;
+}
+
+int rtf_task_create_async(struct rtf_task *t, struct rtf_params *p,
+    struct rtf_async *a)
+{
+    struct rtf_request req;
+
+    req.req_type = RTF_TASK_CREATE;
+    memcpy(&(t->p), p, sizeof(struct rtf_params));
+    memcpy(&(req.payload.param), p, sizeof(struct rtf_params));
+
+    a->t = t;
+    a->rep = NULL;
+
+    return rtf_async_submit(&req, NULL, 0, a);
+}
+
+int rtf_task_attach_async(struct rtf_task *t, pid_t pid, struct rtf_async *a)
+{
+    struct rtf_request req;
+
+    req.req_type = RTF_TASK_ATTACH;
+    req.payload.ids.rsvid = t->task_id;
+    req.payload.ids.pid = pid;
+
+    a->t = t;
+    a->rep = NULL;
+
+    return rtf_async_submit(&req, NULL, 0, a);
+}
+
+int rtf_async_poll(struct rtf_async *a)
+{
+    return rtf_async_progress(a, 0);
+}
+
+int rtf_async_wait(struct rtf_async *a)
+{
+    return rtf_async_progress(a, 1);
+}
+
 // -----------------------------------------------------------------------------
 // LOCAL COMMUNICATIONS
 // -----------------------------------------------------------------------------
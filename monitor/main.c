@@ -114,20 +114,82 @@ void printTasks()
     }
 }
 
+void printSnapshot(struct rtf_snapshot *s)
+{
+    struct rtf_cpu_info *cpu = s->cpus;
+    struct rtf_task_info *task;
+
+    yellow();
+    printf("> Connected clients\n");
+    printf("> Number of clients: %d\n", s->nconnected);
+    reset();
+
+    for (int i = 0; i < s->nconnected; i++)
+        printf("#%d \t PID: %d \t State: %s\n", i, s->clients[i].pid,
+            stringFromState(s->clients[i].state));
+
+    yellow();
+    printf("> Plugin registered\n");
+    printf("> Number of plugin: %d\n", s->nplugin);
+    reset();
+
+    for (int i = 0; i < s->nplugin; i++)
+    {
+        printf("#%d \t Name: %s \t CPUs: %d\n", i, s->plugins[i].name,
+            s->plugins[i].cputot);
+
+        for (int j = 0; j < s->plugins[i].cputot; j++, cpu++)
+            printf("\t CPU: #%d \t Free util : %f \t Num of tasks : %d\n",
+                cpu->cpunum, cpu->freeu, cpu->ntask);
+    }
+
+    yellow();
+    printf("> Task instances\n");
+    printf("> Number of tasks: %d\n", s->ntask);
+    reset();
+
+    for (int i = 0; i < s->ntask; i++)
+    {
+        task = &s->tasks[i];
+        printf("#%d \t TID : %d \t PPID : %d \t Priority : %d \t Period : "
+               "%d \t Util : %f \t Plugin : %s \n",
+            task->id, task->tid, task->ppid, task->priority, task->period,
+            task->util, stringFromName(task->pluginid));
+    }
+}
+
 int main()
 {
-    // connect with daemon
+    struct rtf_snapshot snapshot = RTF_SNAPSHOT_INIT;
+    int use_status;
+
+    // connect with daemon, used only if the status page is not available
     if (rtf_connect() != RTF_OK)
         printerr("> Unable to connect with RTF\n");
 
+    // the status page can be read without any request to the daemon
+    use_status = rtf_status_open() == RTF_OK;
+
     while (1)
     {
         clear();
-        printConnections();
-        printPlugins();
-        printTasks();
+
+        // otherwise ask for everything with a single request
+        if ((use_status && rtf_status_read(&snapshot) == RTF_OK) ||
+            rtf_tasks_snapshot(&snapshot) == RTF_OK)
+        {
+            printSnapshot(&snapshot);
+        }
+        else
+        {
+            printConnections();
+            printPlugins();
+            printTasks();
+        }
+
         spinner();
     }
 
+    rtf_snapshot_release(&snapshot);
     return 0;
 }
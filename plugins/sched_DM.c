@@ -0,0 +1,507 @@
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "retif_kernel.h"
+#include "retif_rta.h"
+#include "retif_taskset.h"
+#include "retif_utils.h"
+#include <math.h>
+#include <string.h>
+
+#define MAX_CPU CPU_SETSIZE
+
+// placement found by the admission test of a task
+struct dm_placement
+{
+    int plugin;
+    rtf_id_t id;
+    unsigned long generation; // of the tasks it was found with
+    int cpu;
+    int exact;
+};
+
+static double utilization[MAX_CPU]; // sum of runtime / period of the tasks
+static double hyperbolic[MAX_CPU]; // product of (u + 1) of the tasks
+static unsigned int constrained[MAX_CPU]; // tasks with deadline < period
+static uint8_t rta_valid[MAX_CPU]; // cached response times are up to date
+static uint32_t deadlines[MAX_CPU]; // distinct relative deadlines of the tasks
+
+static struct rtf_rta rta; // buffer of the response time analysis
+
+static struct dm_placement placed = {.plugin = -1};
+static unsigned long generation; // incremented whenever the tasks change
+
+//------------------------------------------------------------------------------
+// SCHEDULABILITY ANALYSIS: perform the sched. analysis under dm
+//------------------------------------------------------------------------------
+
+static double dm_util(struct rtf_task *t)
+{
+    return t->params.runtime / (double) t->params.period;
+}
+
+static void bounds_add(int cpu, struct rtf_task *t)
+{
+    utilization[cpu] += dm_util(t);
+    hyperbolic[cpu] *= dm_util(t) + 1;
+
+    if (rtf_task_get_min_declared(t) < rtf_task_get_period(t))
+        constrained[cpu]++;
+}
+
+/**
+ * @brief Recomputes the utilization, the product of (u + 1) used by the
+ * hyperbolic bound and the number of constrained deadline tasks of a CPU
+ */
+static void bounds_update(struct rtf_plugin *this, int cpu)
+{
+    iterator_t iterator;
+
+    utilization[cpu] = 0;
+    hyperbolic[cpu] = 1;
+    constrained[cpu] = 0;
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+        bounds_add(cpu, rtf_taskset_iterator_get_elem(iterator));
+}
+
+static int task_on_cpu(struct rtf_plugin *this, struct rtf_task *t, int cpu)
+{
+    return t->pluginid == this->id && (int) t->cpu == cpu;
+}
+
+static uint64_t dm_key(struct rtf_task *t)
+{
+    return rtf_task_get_min_declared(t);
+}
+
+/**
+ * @internal
+ *
+ * Response time analysis of the tasks of the CPU with @p t added, the
+ * priority key being the relative deadline. The cached response times are
+ * reused only if they are up to date and @p t is not already on the CPU with
+ * other parameters.
+ *
+ * @endinternal
+ */
+static int rta_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    int store)
+{
+    int valid = rta_valid[cpu] && !task_on_cpu(this, t, cpu);
+    int res;
+
+    res = rtf_rta_test(&rta, &this->tasks[cpu], t, dm_key, valid, store);
+
+    if (store)
+        rta_valid[cpu] = 1;
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * The analysis gives each distinct relative deadline its own priority, so a
+ * task is admitted on a CPU only if its deadline still finds a free priority
+ * in the range of the plugin. The tasks are scanned only when the CPU already
+ * uses all of them, and the old copy of @p t is left out.
+ *
+ * @endinternal
+ */
+static int dm_fits_levels(struct rtf_plugin *this, int cpu, struct rtf_task *t)
+{
+    iterator_t iterator;
+    struct rtf_task *t_dm;
+    uint64_t deadline = rtf_task_get_min_declared(t);
+    uint64_t prec_deadline = 0;
+    uint32_t levels = this->prio_max - this->prio_min + 1;
+    uint32_t distinct = 1;
+
+    if (deadlines[cpu] < levels)
+        return 1;
+
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_dm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_dm->id == t->id)
+            continue;
+
+        if (rtf_task_get_min_declared(t_dm) != prec_deadline &&
+            rtf_task_get_min_declared(t_dm) != deadline)
+            distinct++;
+
+        prec_deadline = rtf_task_get_min_declared(t_dm);
+    }
+
+    return distinct <= levels;
+}
+
+/**
+ * @internal
+ *
+ * A utilization above 1 is rejected at once. When all the deadlines are equal
+ * to the periods, deadline monotonic is rate monotonic, so the Liu & Layland
+ * and the hyperbolic bounds are tried before the response time analysis.
+ * @p exact is set if the result comes from the analysis.
+ *
+ * @endinternal
+ */
+static int dm_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    int *exact)
+{
+    double util = utilization[cpu] + dm_util(t);
+    int n = this->task_count_percpu[cpu] + 1;
+
+    *exact = 1;
+
+    if (!dm_fits_levels(this, cpu, t))
+        return RTF_NO;
+
+    if (task_on_cpu(this, t, cpu))
+        return rta_test(this, cpu, t, 0);
+
+    *exact = 0;
+
+    if (util > 1)
+        return RTF_NO;
+
+    if (constrained[cpu] == 0 &&
+        rtf_task_get_min_declared(t) == rtf_task_get_period(t))
+    {
+        if (util <= n * (exp2(1.0 / n) - 1) ||
+            hyperbolic[cpu] * (dm_util(t) + 1) <= 2)
+            return RTF_OK;
+    }
+
+    *exact = 1;
+
+    return rta_test(this, cpu, t, 0);
+}
+
+/**
+ * @internal
+ *
+ * The CPU chosen by the placement heuristic is tried first, then the others
+ * in cpulist order, so that a task is rejected only if no CPU can take it.
+ *
+ * @endinternal
+ */
+static int dm_place(struct rtf_plugin *this, struct rtf_task *t, int *exact)
+{
+    int cpu;
+
+    cpu = rtf_plugin_place_cpu(this, rtf_task_get_util(t),
+        rtf_task_get_numa_node(t));
+
+    if (dm_test(this, cpu, t, exact) == RTF_OK)
+        return cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        if (this->cpulist[i] == cpu)
+            continue;
+
+        if (dm_test(this, this->cpulist[i], t, exact) == RTF_OK)
+            return this->cpulist[i];
+    }
+
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * The daemon schedules a task right after its admission test succeeds, so
+ * the placement found by the test is kept and returned again for the same
+ * task, as long as no task has been added or removed since.
+ *
+ * @endinternal
+ */
+static int dm_place_cached(struct rtf_plugin *this, struct rtf_task *t,
+    int *exact)
+{
+    if (placed.plugin == this->id && placed.id == t->id &&
+        placed.generation == generation)
+    {
+        *exact = placed.exact;
+        return placed.cpu;
+    }
+
+    placed.cpu = dm_place(this, t, exact);
+    placed.plugin = this->id;
+    placed.id = t->id;
+    placed.generation = generation;
+    placed.exact = *exact;
+
+    return placed.cpu;
+}
+
+// -----------------------------------------------------------------------------
+// UTILITY INTERNAL METHODS
+// -----------------------------------------------------------------------------
+
+static uint8_t has_another_preference(struct rtf_plugin *this,
+    struct rtf_task *t)
+{
+    char *preferred = rtf_task_get_preferred_plugin(t);
+
+    if (preferred != NULL && strcmp(this->name, preferred) != 0)
+        return 1;
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Gives each distinct relative deadline of the CPU a priority, from the
+ * lowest of the plugin for the longest deadline, and records their number.
+ * The admission test keeps it within the priorities of the plugin; only tasks
+ * that ignore the test can exceed it, then adjacent deadlines are mapped to
+ * the same priority, keeping the order. The threads already attached whose
+ * priority changes are updated, except @p t, which is being scheduled.
+ *
+ * @endinternal
+ */
+static void assign_priorities(struct rtf_plugin *this, int cpu,
+    struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+    iterator_t iterator;
+    struct rtf_task *t_dm;
+    uint64_t prec_deadline = 0;
+    uint32_t levels = this->prio_max - this->prio_min + 1;
+    uint32_t distinct = 0;
+    uint32_t idx = 0;
+    uint32_t priority;
+
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_dm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (rtf_task_get_min_declared(t_dm) != prec_deadline)
+            distinct++;
+
+        prec_deadline = rtf_task_get_min_declared(t_dm);
+    }
+
+    deadlines[cpu] = distinct;
+    prec_deadline = 0;
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_dm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (prec_deadline != 0 &&
+            rtf_task_get_min_declared(t_dm) != prec_deadline)
+            idx++;
+
+        prec_deadline = rtf_task_get_min_declared(t_dm);
+        priority = this->prio_min +
+                   (distinct <= levels ? idx : idx * levels / distinct);
+
+        if (t_dm->schedprio == priority && t_dm != t)
+            continue;
+
+        rtf_task_set_real_priority(t_dm, priority);
+
+        if (t_dm == t || t_dm->tid == 0 ||
+            rtf_kernel_get_policy(this->kernel, t_dm->tid) != SCHED_FIFO)
+            continue;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.policy = SCHED_FIFO;
+        attr.priority = priority;
+        rtf_kernel_set_attr(this->kernel, t_dm->tid, &attr);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// SKELETON PLUGIN METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Used by plugin to initializes itself
+ */
+int rtf_plg_task_init(struct rtf_plugin *this)
+{
+    int cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        cpu = this->cpulist[i];
+        utilization[cpu] = 0;
+        hyperbolic[cpu] = 1;
+        constrained[cpu] = 0;
+        rta_valid[cpu] = 0;
+        deadlines[cpu] = 0;
+    }
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to perform a new task admission test
+ */
+int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    int test_res;
+    int exact;
+
+    // if task did not specified period will be rejected
+    if (rtf_task_get_period(t) == 0)
+        return RTF_NO;
+
+    if (rtf_task_get_ignore_admission(t))
+        test_res = RTF_OK;
+    else if (dm_place_cached(this, t, &exact) >= 0)
+        test_res = RTF_OK;
+    else
+        test_res = RTF_NO;
+
+    // if not preferred plugin support is partial
+    if (has_another_preference(this, t) && test_res == RTF_OK)
+        test_res = RTF_PARTIAL;
+
+    return test_res;
+}
+
+/**
+ * @brief Used by plugin to perform a new admission test when task modifies
+ * parameters
+ */
+int rtf_plg_task_change(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    int test_res;
+
+    // simulate test without task utilization in
+    if (t->pluginid == this->id && t->acceptedu != 0)
+        rtf_plugin_util_add(this, t->cpu, t->acceptedu);
+
+    test_res = rtf_plg_task_accept(this, ts, t);
+
+    // restore utilization
+    if (t->pluginid == this->id && t->acceptedu != 0)
+        rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
+
+    return test_res;
+}
+
+/**
+ * @brief Used by plugin to set the task as accepted
+ */
+void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    float task_util;
+    int exact;
+    int cpu;
+
+    task_util = rtf_task_get_util(t);
+
+    // tasks that skip the admission test are placed anyway
+    if ((cpu = dm_place_cached(this, t, &exact)) < 0)
+    {
+        cpu = rtf_plugin_place_cpu(this, task_util, rtf_task_get_numa_node(t));
+        exact = 1;
+    }
+
+    // the response times are cached only when they are computed anyway
+    if (exact)
+        rta_test(this, cpu, t, 1);
+    else
+        rta_valid[cpu] = 0;
+
+    rtf_task_set_cpu(t, cpu);
+    t->pluginid = this->id;
+
+    rtf_taskset_add_sorted_rdl(&this->tasks[cpu], t);
+    assign_priorities(this, cpu, t);
+
+    t->acceptedt = rtf_task_get_runtime(t);
+    t->acceptedu = task_util != -1 ? task_util : 0;
+    rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
+    this->task_count_percpu[t->cpu]++;
+    bounds_add(cpu, t);
+    generation++;
+}
+
+/**
+ * @brief Used by plugin to set rt scheduler for a task
+ */
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, t->cpu) < 0)
+        return RTF_ERROR;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_FIFO;
+    attr.priority = t->schedprio;
+
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to reset scheduler (other) for a task
+ */
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
+        return RTF_ERROR;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
+
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to perform a release of previous accepted task
+ */
+int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    if (t->acceptedu != 0)
+        rtf_plugin_util_add(this, t->cpu, t->acceptedu);
+
+    rtf_taskset_remove_by_rsvid(&this->tasks[t->cpu], t->id);
+
+    // the parameters of the task may have changed since it was accepted, and
+    // the response times of the others can only decrease: all of them are
+    // recomputed from the remaining tasks
+    bounds_update(this, t->cpu);
+    rta_valid[t->cpu] = 0;
+    assign_priorities(this, t->cpu, NULL);
+    generation++;
+
+    t->pluginid = -1;
+    this->task_count_percpu[t->cpu]--;
+
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
+        SCHED_FIFO) // means no attached flow of ex.
+        return RTF_OK;
+
+    return rtf_plg_task_detach(this, t);
+}
@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 
+#include "retif_kernel.h"
 #include "retif_plugin.h"
 #include "retif_taskset.h"
 #include "retif_types.h"
@@ -17,88 +18,232 @@
 #include <sys/sysinfo.h>
 #include <unistd.h>
 
-// -----------------------------------------------------------------------------
-// LIBC FOR SCHED_DEADLINE
-// -----------------------------------------------------------------------------
+#define QPA_MAX_STEPS 100000 // steps of the analysis before rejecting
 
-// unfortunately on many distros is not present the libc for SCHED_DEADLINE
-// what follows may be removed in future
+// task of a CPU as seen by the processor demand analysis
+struct dbf_entry
+{
+    uint64_t runtime;
+    uint64_t deadline; // relative deadline, not after the period
+    uint64_t period;
+};
 
-#ifdef __x86_64__
-#define __NR_sched_setattr 314
-#define __NR_sched_getattr 315
-#endif
+// placement found by the admission test of a task with a given runtime
+struct edf_placement
+{
+    int plugin;
+    rtf_id_t id;
+    unsigned long generation; // of the tasks it was found with
+    uint64_t runtime;
+    int cpu;
+};
 
-#ifdef __i386__
-#define __NR_sched_setattr 351
-#define __NR_sched_getattr 352
-#endif
+static struct dbf_entry *dbf_buf;
+static int dbf_cap;
 
-#ifdef __arm__
-#define __NR_sched_setattr 380
-#define __NR_sched_getattr 381
-#endif
+// with the minimum runtime and with the desired one
+static struct edf_placement placed[2] = {{.plugin = -1}, {.plugin = -1}};
+static unsigned long generation; // incremented whenever the tasks change
 
-struct sched_attr
-{
-    __u32 size;
-    __u32 sched_policy;
-    __u64 sched_flags;
-    __s32 sched_nice;
-    __u32 sched_priority;
-    __u64 sched_runtime;
-    __u64 sched_deadline;
-    __u64 sched_period;
-};
+// -----------------------------------------------------------------------------
+// PROCESSOR DEMAND ANALYSIS
+// -----------------------------------------------------------------------------
 
 /**
- * @brief Sets the scheduling policy and attributes for the thread specified
+ * @internal
+ *
+ * Copies the tasks of the CPU in dbf_buf, with @p t added with the given
+ * runtime. If @p t is already on the CPU, its old copy is left out. Returns
+ * the number of entries, -1 in case of errors.
+ *
+ * @endinternal
  */
-int sched_setattr(pid_t pid, const struct sched_attr *attr, unsigned int flags)
+static int dbf_collect(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    uint64_t runtime)
 {
-    return syscall(__NR_sched_setattr, pid, attr, flags);
+    iterator_t iterator;
+    struct rtf_task *t_edf;
+    struct dbf_entry *buf;
+    int size = rtf_taskset_get_size(&this->tasks[cpu]) + 1;
+    int n = 0;
+
+    if (size > dbf_cap)
+    {
+        buf = realloc(dbf_buf, size * sizeof(struct dbf_entry));
+
+        if (buf == NULL)
+            return -1;
+
+        dbf_buf = buf;
+        dbf_cap = size;
+    }
+
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_edf = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_edf->id == t->id)
+            continue;
+
+        dbf_buf[n++] = (struct dbf_entry) {t_edf->acceptedt,
+            rtf_task_get_min_declared(t_edf), rtf_task_get_period(t_edf)};
+    }
+
+    dbf_buf[n++] = (struct dbf_entry) {runtime, rtf_task_get_min_declared(t),
+        rtf_task_get_period(t)};
+
+    return n;
 }
 
-// -----------------------------------------------------------------------------
-// UTILITY INTERNAL METHODS
-// -----------------------------------------------------------------------------
+// demand of the jobs with both release and deadline in [0, x]
+static uint64_t dbf(struct dbf_entry *buf, int n, uint64_t x)
+{
+    uint64_t h = 0;
+
+    for (int i = 0; i < n; i++)
+        if (x >= buf[i].deadline)
+            h += ((x - buf[i].deadline) / buf[i].period + 1) * buf[i].runtime;
+
+    return h;
+}
+
+// latest absolute deadline before x, 0 if none
+static uint64_t dbf_prev_deadline(struct dbf_entry *buf, int n, uint64_t x)
+{
+    uint64_t d = 0;
+    uint64_t di;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (x <= buf[i].deadline)
+            continue;
+
+        di = buf[i].deadline +
+             (x - buf[i].deadline - 1) / buf[i].period * buf[i].period;
+
+        if (di > d)
+            d = di;
+    }
+
+    return d;
+}
 
 /**
- * @brief Given pointer to plugin struct @p this, retrieve least loaded cpu
+ * @internal
+ *
+ * Length of the synchronous busy period, 0 if it does not converge within
+ * QPA_MAX_STEPS iterations.
+ *
+ * @endinternal
  */
-static uint32_t least_loaded_cpu(struct rtf_plugin *this)
+static uint64_t dbf_busy_period(struct dbf_entry *buf, int n)
 {
-    int cpu_num;
-    float free_edf_max;
-    int free_edf_max_cpu;
+    uint64_t w = 0;
+    uint64_t next;
 
-    free_edf_max_cpu = this->cpulist[0];
-    free_edf_max = this->util_free_percpu[free_edf_max_cpu];
+    for (int i = 0; i < n; i++)
+        w += buf[i].runtime;
 
-    for (int i = 1; i < this->cputot; i++)
+    for (int step = 0; step < QPA_MAX_STEPS; step++)
     {
-        cpu_num = this->cpulist[i];
+        next = 0;
 
-        if (this->util_free_percpu[cpu_num] > free_edf_max)
-            free_edf_max_cpu = cpu_num;
+        for (int i = 0; i < n; i++)
+            next += (w + buf[i].period - 1) / buf[i].period * buf[i].runtime;
+
+        if (next == w)
+            return w;
+
+        w = next;
     }
 
-    return free_edf_max_cpu;
+    return 0;
 }
 
-static float eval_util_missing(struct rtf_plugin *this, float task_util)
+/**
+ * @internal
+ *
+ * Quick Processor-demand Analysis (Zhang and Burns) of the tasks of the CPU
+ * with @p t added. With implicit deadlines only, a utilization up to 1 is
+ * already exact. Otherwise the demand is checked backwards from the end of
+ * the testing interval, which is the shorter of the synchronous busy period
+ * and the bound of George et al., jumping each time to the demand itself
+ * when it is below the current instant. If the analysis takes too long, the
+ * task is rejected.
+ *
+ * @endinternal
+ */
+static int qpa_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    uint64_t runtime)
 {
-    int cpu_min;
+    uint64_t dmin = UINT64_MAX;
+    uint64_t dmax = 0;
+    uint64_t limit;
+    uint64_t busy;
+    uint64_t x;
+    uint64_t h;
+    double util = 0;
+    double slack = 0;
+    int constrained = 0;
+    int n;
+
+    if ((n = dbf_collect(this, cpu, t, runtime)) < 0)
+        return RTF_NO;
 
-    for (int i = 0; i < this->cputot; i++)
-        if (task_util <= this->util_free_percpu[this->cpulist[i]])
-            return 0;
+    for (int i = 0; i < n; i++)
+    {
+        util += dbf_buf[i].runtime / (double) dbf_buf[i].period;
+        slack += (dbf_buf[i].period - dbf_buf[i].deadline) *
+                 (dbf_buf[i].runtime / (double) dbf_buf[i].period);
+        constrained |= dbf_buf[i].deadline < dbf_buf[i].period;
+        dmin = dbf_buf[i].deadline < dmin ? dbf_buf[i].deadline : dmin;
+        dmax = dbf_buf[i].deadline > dmax ? dbf_buf[i].deadline : dmax;
+    }
 
-    cpu_min = least_loaded_cpu(this);
+    if (util > 1)
+        return RTF_NO;
 
-    return task_util - this->util_free_percpu[cpu_min];
+    if (!constrained)
+        return RTF_OK;
+
+    busy = dbf_busy_period(dbf_buf, n);
+
+    if (util < 1 && slack / (1 - util) < UINT64_MAX)
+    {
+        limit = slack / (1 - util) > dmax ? slack / (1 - util) : dmax;
+
+        if (busy != 0 && busy < limit)
+            limit = busy;
+    }
+    else if (busy != 0)
+        limit = busy;
+    else
+        return RTF_NO;
+
+    x = dbf_prev_deadline(dbf_buf, n, limit + 1);
+
+    for (int step = 0; step < QPA_MAX_STEPS; step++)
+    {
+        h = dbf(dbf_buf, n, x);
+
+        if (h > x)
+            return RTF_NO;
+
+        if (h <= dmin)
+            return RTF_OK;
+
+        x = h < x ? h : dbf_prev_deadline(dbf_buf, n, x);
+    }
+
+    return RTF_NO;
 }
 
+// -----------------------------------------------------------------------------
+// UTILITY INTERNAL METHODS
+// -----------------------------------------------------------------------------
+
 static uint8_t has_another_preference(struct rtf_plugin *this,
     struct rtf_task *t)
 {
@@ -110,28 +255,95 @@ static uint8_t has_another_preference(struct rtf_plugin *this,
     return 0;
 }
 
-static int utilization_test(struct rtf_plugin *this, float task_util)
+/**
+ * @internal
+ *
+ * Checks if the task fits the CPU with the given runtime, using the
+ * schedulability test selected for the plugin: the density test compares
+ * runtime / min(deadline, period) with the free utilization of the CPU, the
+ * processor demand analysis is exact also for constrained deadlines.
+ *
+ * @endinternal
+ */
+static int edf_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    uint64_t runtime)
 {
-    float missing_util = eval_util_missing(this, task_util);
+    float util = runtime / (float) rtf_task_get_min_declared(t);
 
-    if (missing_util == 0)
+    if (this->admission != ADMISSION_QPA &&
+        util <= this->util_free_percpu[cpu])
         return RTF_OK;
-    else
+
+    if (this->admission == ADMISSION_DENSITY)
         return RTF_NO;
+
+    return qpa_test(this, cpu, t, runtime);
 }
 
-static int desired_utilization_test(struct rtf_plugin *this, float task_util,
-    float task_des_util)
+/**
+ * @internal
+ *
+ * Returns the CPU where the task fits with the given runtime, -1 if none.
+ * The CPU chosen by the placement heuristic is tried first. With the density
+ * test alone, the task fits some CPU only if it fits the most free one, so
+ * the others are tried only by the processor demand analysis.
+ *
+ * @endinternal
+ */
+static int edf_place(struct rtf_plugin *this, struct rtf_task *t,
+    uint64_t runtime)
 {
-    float missing_util = eval_util_missing(this, task_util);
-    float missing_des_util = eval_util_missing(this, task_des_util);
+    float util = runtime / (float) rtf_task_get_min_declared(t);
+    int cpu;
 
-    if (missing_des_util == 0)
-        return RTF_OK;
-    else if (missing_des_util > 0 && missing_util == 0)
-        return RTF_PARTIAL;
-    else
-        return RTF_NO;
+    cpu = rtf_plugin_place_cpu(this, util, rtf_task_get_numa_node(t));
+
+    if (this->admission == ADMISSION_DENSITY)
+        return util <= this->util_free_percpu[rtf_plugin_most_free_cpu(this)]
+                   ? cpu
+                   : -1;
+
+    if (edf_test(this, cpu, t, runtime) == RTF_OK)
+        return cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        if (this->cpulist[i] == cpu)
+            continue;
+
+        if (edf_test(this, this->cpulist[i], t, runtime) == RTF_OK)
+            return this->cpulist[i];
+    }
+
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * The daemon schedules a task right after its admission test succeeds, so
+ * the placements found by the test, with the minimum and with the desired
+ * runtime, are kept and returned again for the same task, as long as no task
+ * has been added or removed since.
+ *
+ * @endinternal
+ */
+static int edf_place_cached(struct rtf_plugin *this, struct rtf_task *t,
+    uint64_t runtime)
+{
+    struct edf_placement *p = &placed[runtime != rtf_task_get_runtime(t)];
+
+    if (p->plugin == this->id && p->id == t->id &&
+        p->generation == generation && p->runtime == runtime)
+        return p->cpu;
+
+    p->cpu = edf_place(this, t, runtime);
+    p->plugin = this->id;
+    p->id = t->id;
+    p->generation = generation;
+    p->runtime = runtime;
+
+    return p->cpu;
 }
 
 // -----------------------------------------------------------------------------
@@ -152,30 +364,33 @@ int rtf_plg_task_init(struct rtf_plugin *this)
 int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    float task_util;
-    float task_des_util;
     int test_res;
 
-    task_util = rtf_task_get_util(t);
-    task_des_util = rtf_task_get_des_util(t);
-
     // task does not have required params
     if (rtf_task_get_ignore_admission(t))
         return RTF_NO;
     if (rtf_task_get_period(t) == 0)
         return RTF_NO;
-    if (task_util == -1)
+    if (rtf_task_get_util(t) == -1)
         return RTF_NO;
 
     // task does not require a desired higher runtime
-    if (task_des_util == -1)
+    if (rtf_task_get_des_util(t) == -1)
     {
-        test_res = utilization_test(this, task_util);
+        test_res = edf_place_cached(this, t, rtf_task_get_runtime(t)) >= 0
+                       ? RTF_OK
+                       : RTF_NO;
     }
     // task required a desired higher runtime
+    else if (edf_place_cached(this, t, rtf_task_get_des_runtime(t)) >= 0)
+    {
+        test_res = RTF_OK;
+    }
     else
     {
-        test_res = desired_utilization_test(this, task_util, task_des_util);
+        test_res = edf_place_cached(this, t, rtf_task_get_runtime(t)) >= 0
+                       ? RTF_PARTIAL
+                       : RTF_NO;
     }
 
     // if not preferred plugin support is partial
@@ -196,13 +411,13 @@ int rtf_plg_task_change(struct rtf_plugin *this, struct rtf_taskset *ts,
 
     // simulate test without task utilization in
     if (t->pluginid == this->id)
-        this->util_free_percpu[t->cpu] += t->acceptedu;
+        rtf_plugin_util_add(this, t->cpu, t->acceptedu);
 
     test_res = rtf_plg_task_accept(this, ts, t);
 
     // restore utilization
     if (t->pluginid == this->id)
-        this->util_free_percpu[t->cpu] -= t->acceptedu;
+        rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
 
     return test_res;
 }
@@ -215,52 +430,65 @@ void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
 {
     float task_util;
     float task_des_util;
+    int cpu;
 
     task_util = rtf_task_get_util(t);
     task_des_util = rtf_task_get_des_util(t);
-
-    t->cpu = least_loaded_cpu(this);
     t->pluginid = this->id;
 
     // task does not require a desired higher runtime
     if (task_des_util == -1)
     {
+        cpu = edf_place_cached(this, t, rtf_task_get_runtime(t));
+        t->cpu = cpu >= 0 ? cpu
+                          : rtf_plugin_place_cpu(this, task_util,
+                                rtf_task_get_numa_node(t));
         t->acceptedt = rtf_task_get_runtime(t);
         t->acceptedu = task_util;
     }
     // required higher desired runtime and it is available
-    else if (desired_utilization_test(this, task_util, task_des_util) == RTF_OK)
+    else if ((cpu = edf_place_cached(this, t,
+                  rtf_task_get_des_runtime(t))) >= 0)
     {
+        t->cpu = cpu;
         t->acceptedt = rtf_task_get_des_runtime(t);
-        t->acceptedu = task_util;
+        t->acceptedu = task_des_util;
     }
-    // required higher desired runtime but not available all
-    else
+    // required higher desired runtime but not available all, the density
+    // test grants what is free on the most free CPU
+    else if (this->admission == ADMISSION_DENSITY ||
+             (cpu = edf_place_cached(this, t, rtf_task_get_runtime(t))) < 0)
     {
+        t->cpu = rtf_plugin_most_free_cpu(this);
         t->acceptedt =
             this->util_free_percpu[t->cpu] * rtf_task_get_min_declared(t);
         t->acceptedu = t->acceptedt / (float) rtf_task_get_min_declared(t);
     }
+    // the exact analysis grants the minimum runtime
+    else
+    {
+        t->cpu = cpu;
+        t->acceptedt = rtf_task_get_runtime(t);
+        t->acceptedu = task_util;
+    }
 
-    this->util_free_percpu[t->cpu] -= t->acceptedu;
+    rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
     this->task_count_percpu[t->cpu]++;
+    rtf_taskset_add_top(&this->tasks[t->cpu], t);
+    generation++;
 }
 
 /**
  * @brief Used by plugin to set rt scheduler for a task
  */
-int rtf_plg_task_attach(struct rtf_task *t)
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_attr attr;
-    cpu_set_t my_set;
+    struct rtf_kernel_attr attr;
     uint64_t runtime;
     uint64_t deadline;
     uint64_t period;
 
-    CPU_ZERO(&my_set);
-    CPU_SET(t->cpu, &my_set);
-
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, t->cpu) < 0)
         return RTF_ERROR;
 
     runtime = rtf_task_get_accepted_runtime(t);
@@ -269,14 +497,12 @@ int rtf_plg_task_attach(struct rtf_task *t)
     period = rtf_task_get_period(t);
 
     memset(&attr, 0, sizeof(attr));
-    attr.size = sizeof(attr);
-
-    attr.sched_policy = SCHED_DEADLINE;
-    attr.sched_runtime = MICRO_TO_NANO(runtime);
-    attr.sched_deadline = MICRO_TO_NANO(deadline);
-    attr.sched_period = MICRO_TO_NANO(period);
+    attr.policy = SCHED_DEADLINE;
+    attr.runtime = MICRO_TO_NANO(runtime);
+    attr.deadline = MICRO_TO_NANO(deadline);
+    attr.period = MICRO_TO_NANO(period);
 
-    if (sched_setattr(t->tid, &attr, 0) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -285,22 +511,17 @@ int rtf_plg_task_attach(struct rtf_task *t)
 /**
  * @brief Used by plugin to reset scheduler (other) for a task
  */
-int rtf_plg_task_detach(struct rtf_task *t)
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
+    struct rtf_kernel_attr attr;
 
-    CPU_ZERO(&my_set);
-
-    for (int i = 0; i < get_nprocs2(); i++)
-        CPU_SET(i, &my_set);
-
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = 0;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
 
-    if (sched_setscheduler(t->tid, SCHED_OTHER, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -312,13 +533,15 @@ int rtf_plg_task_detach(struct rtf_task *t)
 int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    this->util_free_percpu[t->cpu] += t->acceptedu;
+    rtf_plugin_util_add(this, t->cpu, t->acceptedu);
     this->task_count_percpu[t->cpu]--;
+    rtf_taskset_remove_by_rsvid(&this->tasks[t->cpu], t->id);
     t->pluginid = -1;
+    generation++;
 
-    if (sched_getscheduler(t->tid) !=
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
         SCHED_DEADLINE) // means no attached flow of ex.
         return RTF_OK;
 
-    return rtf_plg_task_detach(t);
+    return rtf_plg_task_detach(this, t);
 }
@@ -1,13 +1,30 @@
 #define _GNU_SOURCE
 
+#include "retif_kernel.h"
+#include "retif_rta.h"
 #include "retif_taskset.h"
 #include "retif_types.h"
 #include "retif_utils.h"
 #include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/sysinfo.h>
 
+// placement found by the admission test of a task
+struct opa_placement
+{
+    int plugin;
+    rtf_id_t id;
+    unsigned long generation; // of the tasks it was found with
+    int cpu;
+};
+
+static struct rtf_rta opa; // buffer of the priority assignment
+
+static struct opa_placement placed = {.plugin = -1};
+static unsigned long generation; // incremented whenever the tasks change
+
 // -----------------------------------------------------------------------------
 // UTILITY INTERNAL METHODS
 // -----------------------------------------------------------------------------
@@ -28,37 +45,169 @@ uint32_t prio_remap(uint32_t max_prio_s, uint32_t min_prio_s, uint32_t prio)
     return min_prio_s + slope * (prio - min_fp_prio);
 }
 
+uint8_t has_another_preference(struct rtf_plugin *this, struct rtf_task *t)
+{
+    char *preferred = rtf_task_get_preferred_plugin(t);
+
+    if (preferred != NULL && strcmp(this->name, preferred) != 0)
+        return 1;
+
+    return 0;
+}
+
+static int opa_enabled(struct rtf_plugin *this)
+{
+    return this->admission == ADMISSION_OPA;
+}
+
+// the lowest priority is left to the tasks that ignore the admission test,
+// which would otherwise delay the tasks of the lowest level
+static int opa_levels(struct rtf_plugin *this)
+{
+    return this->prio_max - this->prio_min;
+}
+
+// -----------------------------------------------------------------------------
+// OPTIMAL PRIORITY ASSIGNMENT
+// -----------------------------------------------------------------------------
+
 /**
- * @brief Given pointer to plugin struct @p this, retrieve least loaded cpu
+ * @internal
+ *
+ * Copies the tasks of the CPU that took part in the admission test in the
+ * buffer of the assignment, with @p t added. If @p t is already on the CPU,
+ * its old copy is left out. Returns the number of entries, -1 in case of
+ * errors.
+ *
+ * @endinternal
  */
-uint32_t least_loaded_cpu(struct rtf_plugin *this)
+static int opa_collect(struct rtf_plugin *this, int cpu, struct rtf_task *t)
 {
-    int cpu_num;
-    int num_of_fp_min;
-    int num_of_fp_min_cpu;
+    iterator_t iterator;
+    struct rtf_task *t_fp;
+    int n = 0;
+
+    if (rtf_rta_reserve(&opa, rtf_taskset_get_size(&this->tasks[cpu]) + 1) < 0)
+        return -1;
 
-    num_of_fp_min_cpu = this->cpulist[0];
-    num_of_fp_min = this->task_count_percpu[num_of_fp_min_cpu];
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
 
-    for (int i = 1; i < this->cputot; i++)
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
     {
-        cpu_num = this->cpulist[i];
+        t_fp = rtf_taskset_iterator_get_elem(iterator);
 
-        if (this->task_count_percpu[cpu_num] < num_of_fp_min)
-            num_of_fp_min_cpu = cpu_num;
+        if (t_fp->id == t->id || rtf_task_get_ignore_admission(t_fp))
+            continue;
+
+        rtf_rta_fill(&(opa.buf[n++]), t_fp, 0);
     }
 
-    return num_of_fp_min_cpu;
+    rtf_rta_fill(&(opa.buf[n++]), t, 0);
+    opa.len = n;
+
+    return n;
 }
 
-uint8_t has_another_preference(struct rtf_plugin *this, struct rtf_task *t)
+static int opa_test(struct rtf_plugin *this, int cpu, struct rtf_task *t)
 {
-    char *preferred = rtf_task_get_preferred_plugin(t);
+    if (opa_collect(this, cpu, t) < 0)
+        return RTF_NO;
 
-    if (preferred != NULL && strcmp(this->name, preferred) != 0)
-        return 1;
+    if (rtf_rta_assign(&opa, opa_levels(this)) < 0)
+        return RTF_NO;
 
-    return 0;
+    return RTF_OK;
+}
+
+/**
+ * @internal
+ *
+ * Returns a CPU where the task can be added, -1 if none. The CPU chosen by
+ * the placement heuristic is tried first, then the others in cpulist order.
+ *
+ * @endinternal
+ */
+static int opa_place(struct rtf_plugin *this, struct rtf_task *t)
+{
+    int cpu;
+
+    cpu = rtf_plugin_place_cpu(this, rtf_task_get_util(t),
+        rtf_task_get_numa_node(t));
+
+    if (opa_test(this, cpu, t) == RTF_OK)
+        return cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        if (this->cpulist[i] == cpu)
+            continue;
+
+        if (opa_test(this, this->cpulist[i], t) == RTF_OK)
+            return this->cpulist[i];
+    }
+
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * The daemon schedules a task right after its admission test succeeds, so
+ * the CPU found by the test is kept and returned again for the same task, as
+ * long as no task has been added or removed since. The assignment of that
+ * CPU, the last one tested, is then still in the buffer, since every test goes
+ * through here.
+ *
+ * @endinternal
+ */
+static int opa_place_cached(struct rtf_plugin *this, struct rtf_task *t)
+{
+    if (placed.plugin == this->id && placed.id == t->id &&
+        placed.generation == generation)
+        return placed.cpu;
+
+    placed.cpu = opa_place(this, t);
+    placed.plugin = this->id;
+    placed.id = t->id;
+    placed.generation = generation;
+
+    return placed.cpu;
+}
+
+/**
+ * @internal
+ *
+ * Assigns the priorities computed by the last opa_test() on the CPU, also
+ * to the threads already attached, since the new task may have moved some
+ * tasks to another level.
+ *
+ * @endinternal
+ */
+static void opa_apply(struct rtf_plugin *this, int n, struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+    struct rtf_task *t_fp;
+    uint32_t priority;
+
+    for (int i = 0; i < n; i++)
+    {
+        t_fp = opa.buf[i].task;
+        priority = this->prio_min + 1 + opa.buf[i].level;
+
+        if (t_fp->schedprio == priority && t_fp != t)
+            continue;
+
+        rtf_task_set_real_priority(t_fp, priority);
+
+        if (t_fp == t || t_fp->tid == 0 ||
+            rtf_kernel_get_policy(this->kernel, t_fp->tid) != SCHED_FIFO)
+            continue;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.policy = SCHED_FIFO;
+        attr.priority = priority;
+        rtf_kernel_set_attr(this->kernel, t_fp->tid, &attr);
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -79,7 +228,17 @@ int rtf_plg_task_init(struct rtf_plugin *this)
 int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    if (!rtf_task_get_ignore_admission(t) && rtf_task_get_priority(t) == 0)
+    // the priority is assigned by the plugin, from the timing parameters
+    if (opa_enabled(this) && !rtf_task_get_ignore_admission(t))
+    {
+        if (rtf_task_get_period(t) == 0 || rtf_task_get_runtime(t) == 0)
+            return RTF_NO;
+
+        if (opa_place_cached(this, t) < 0)
+            return RTF_NO;
+    }
+    else if (!rtf_task_get_ignore_admission(t) &&
+             rtf_task_get_priority(t) == 0)
         return RTF_PARTIAL;
 
     if (has_another_preference(this, t))
@@ -105,37 +264,58 @@ void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
     uint32_t priority;
+    int cpu;
+
+    if (opa_enabled(this) && !rtf_task_get_ignore_admission(t) &&
+        rtf_task_get_period(t) != 0 && rtf_task_get_runtime(t) != 0 &&
+        (cpu = opa_place_cached(this, t)) >= 0)
+    {
+        // the assignment of the chosen CPU is the last one computed
+        rtf_task_set_cpu(t, cpu);
+        t->pluginid = this->id;
+        opa_apply(this, opa.len, t);
+
+        t->acceptedu = rtf_task_get_runtime(t) / (float) rtf_task_get_period(t);
+        rtf_plugin_util_add(this, cpu, -t->acceptedu);
+        this->task_count_percpu[cpu]++;
+        rtf_taskset_add_top(&this->tasks[cpu], t);
+        generation++;
+        return;
+    }
 
     priority = rtf_task_get_priority(t);
-    rtf_task_set_cpu(t, least_loaded_cpu(this));
+    rtf_task_set_cpu(t,
+        rtf_plugin_least_loaded_cpu(this, PLUGIN_LOAD_COUNT, 0,
+            rtf_task_get_numa_node(t)));
     t->pluginid = this->id;
 
-    if (priority == 0)
+    if (priority == 0 || opa_enabled(this))
         rtf_task_set_real_priority(t, this->prio_min);
     else
         rtf_task_set_real_priority(t,
             prio_remap(this->prio_max, this->prio_min, priority));
 
+    t->acceptedu = 0;
     this->task_count_percpu[t->cpu]++;
+    rtf_taskset_add_top(&this->tasks[t->cpu], t);
+    generation++;
 }
 
 /**
  * @brief Used by plugin to set rt scheduler for a task
  */
-int rtf_plg_task_attach(struct rtf_task *t)
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
-
-    CPU_ZERO(&my_set);
-    CPU_SET(t->cpu, &my_set);
+    struct rtf_kernel_attr attr;
 
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, t->cpu) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = t->schedprio;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_FIFO;
+    attr.priority = t->schedprio;
 
-    if (sched_setscheduler(t->tid, SCHED_FIFO, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -144,22 +324,17 @@ int rtf_plg_task_attach(struct rtf_task *t)
 /**
  * @brief Used by plugin to reset scheduler (other) for a task
  */
-int rtf_plg_task_detach(struct rtf_task *t)
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
-
-    CPU_ZERO(&my_set);
-
-    for (int i = 0; i < get_nprocs2(); i++)
-        CPU_SET(i, &my_set);
+    struct rtf_kernel_attr attr;
 
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = 0;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
 
-    if (sched_setscheduler(t->tid, SCHED_OTHER, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -171,12 +346,16 @@ int rtf_plg_task_detach(struct rtf_task *t)
 int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
+    // the others keep their levels, which are still feasible
+    rtf_plugin_util_add(this, t->cpu, t->acceptedu);
     this->task_count_percpu[t->cpu]--;
+    rtf_taskset_remove_by_rsvid(&this->tasks[t->cpu], t->id);
     t->pluginid = -1;
+    generation++;
 
-    if (sched_getscheduler(t->tid) !=
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
         SCHED_FIFO) // means no attached flow of ex.
         return RTF_OK;
 
-    return rtf_plg_task_detach(t);
+    return rtf_plg_task_detach(this, t);
 }
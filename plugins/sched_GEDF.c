@@ -0,0 +1,623 @@
+#define _GNU_SOURCE
+
+#include "retif_kernel.h"
+#include "retif_plugin.h"
+#include "retif_taskset.h"
+#include "retif_types.h"
+#include "retif_utils.h"
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CPU CPU_SETSIZE
+#define CGROUP_PREFIX "/retif." // name of the partition, before the plugin one
+#define CGROUP_PATH_MAX 1024 // longest cgroup path read from procfs
+
+// process moved in the cgroup of a cluster
+struct gedf_proc
+{
+    struct hnode entry;
+    pid_t tgid;
+    int cluster;
+    int threads; // attached threads of the process
+    char *origin; // cgroup the process was taken from, under the cgroup fs
+    struct gedf_proc *prev;
+    struct gedf_proc *next; // next process in the cgroup of the cluster
+};
+
+// each cluster is identified by its first CPU, where its tasks are kept
+static double dens_sum[MAX_CPU]; // density of the accepted tasks
+static double dens_max[MAX_CPU]; // highest density of an accepted task
+static char *cg_dir[MAX_CPU]; // cgroup of the cluster, under the cgroup fs
+static struct gedf_proc *cg_procs[MAX_CPU]; // processes in the cgroup
+
+static struct hmap procs; // processes in the cgroup of a cluster, by tgid
+static struct hmap attached; // process of each attached task, by id
+
+// -----------------------------------------------------------------------------
+// UTILITY INTERNAL METHODS
+// -----------------------------------------------------------------------------
+
+static uint8_t has_another_preference(struct rtf_plugin *this,
+    struct rtf_task *t)
+{
+    char *preferred = rtf_task_get_preferred_plugin(t);
+
+    if (preferred != NULL && strcmp(this->name, preferred) != 0)
+        return 1;
+
+    return 0;
+}
+
+static int gedf_cluster(struct rtf_plugin *this)
+{
+    return this->cpulist[0];
+}
+
+// a cluster with all the CPUs of the system needs no cgroup of its own
+static int gedf_partitioned(struct rtf_plugin *this)
+{
+    return this->cputot < this->kernel->num_of_cpu;
+}
+
+// writes @p value in the file @p file of the cgroup directory @p dir
+static int gedf_write(struct rtf_plugin *this, const char *dir,
+    const char *file, const char *value)
+{
+    char *path = malloc(strlen(dir) + strlen(file) + 1);
+    int res;
+
+    if (path == NULL)
+        return -1;
+
+    strcpy(path, dir);
+    strcat(path, file);
+    res = rtf_kernel_write_string(this->kernel, path, value);
+    free(path);
+
+    return res;
+}
+
+// highest density of the tasks of the cluster, @p skip excluded
+static double gedf_max_density(struct rtf_plugin *this, struct rtf_task *skip)
+{
+    iterator_t iterator;
+    struct rtf_task *t_edf;
+    double max = 0;
+
+    iterator = rtf_taskset_iterator_init(&this->tasks[gedf_cluster(this)]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_edf = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_edf != skip && t_edf->acceptedu > max)
+            max = t_edf->acceptedu;
+    }
+
+    return max;
+}
+
+/**
+ * @internal
+ *
+ * Highest density that a new task can have in the cluster. Global EDF on m
+ * CPUs meets all the deadlines if the total density is at most
+ * m - (m - 1) * the highest density (Goossens, Funk and Baruah, extended to
+ * constrained deadlines by Bertogna et al.). Solving it for the new task
+ * gives (m - sum) / m if the task has the highest density, the remaining
+ * slack m - sum - (m - 1) * max otherwise.
+ *
+ * @endinternal
+ */
+static double gedf_free_density(struct rtf_plugin *this)
+{
+    int c = gedf_cluster(this);
+    int m = this->cputot;
+    double d = (m - dens_sum[c]) / m;
+
+    if (d < dens_max[c])
+        d = m - dens_sum[c] - (m - 1) * dens_max[c];
+
+    return d < 1 ? d : 1;
+}
+
+// spreads the density of a task over the CPUs of the cluster
+static void gedf_util_add(struct rtf_plugin *this, float util)
+{
+    for (int i = 0; i < this->cputot; i++)
+        rtf_plugin_util_add(this, this->cpulist[i], util / this->cputot);
+}
+
+/**
+ * @internal
+ *
+ * Creates the cgroup of the cluster and makes it a cpuset partition, so that
+ * its CPUs form a root domain of their own, the one that SCHED_DEADLINE
+ * balances the tasks in. A cluster with all the CPUs of the system is
+ * already the default root domain and does not need it.
+ *
+ * @endinternal
+ */
+static int gedf_partition(struct rtf_plugin *this)
+{
+    int c = gedf_cluster(this);
+    char cpus[8 * MAX_CPU];
+    int len = 0;
+
+    if (!gedf_partitioned(this))
+        return 0;
+
+    for (int i = 0; i < this->cputot; i++)
+        len += snprintf(cpus + len, sizeof(cpus) - len, "%s%d",
+            i > 0 ? "," : "", this->cpulist[i]);
+
+    if (gedf_write(this, this->cgroup, "/cgroup.subtree_control",
+            "+cpuset") != 0 ||
+        rtf_kernel_make_dir(this->kernel, cg_dir[c]) != 0 ||
+        gedf_write(this, cg_dir[c], "/cpuset.cpus", cpus) != 0 ||
+        gedf_write(this, cg_dir[c], "/cpuset.cpus.partition", "root") != 0)
+        return -1;
+
+    return 0;
+}
+
+// moves the process @p pid in the cgroup directory @p dir
+static int gedf_move(struct rtf_plugin *this, const char *dir, pid_t pid)
+{
+    char value[16];
+
+    snprintf(value, sizeof(value), "%d", pid);
+
+    return gedf_write(this, dir, "/cgroup.procs", value);
+}
+
+// process of the thread @p tid, -1 if it cannot be read
+static pid_t gedf_tgid(struct rtf_plugin *this, pid_t tid)
+{
+    char path[64];
+    char line[32];
+
+    snprintf(path, sizeof(path), "/proc/%d/status", tid);
+
+    if (rtf_kernel_read_line(this->kernel, path, "Tgid:", line,
+            sizeof(line)) != 0)
+        return -1;
+
+    return atoi(line);
+}
+
+// cgroup of the process @p pid under the cgroup fs, NULL if not available
+static char *gedf_origin(struct rtf_plugin *this, pid_t pid)
+{
+    char path[64];
+    char line[CGROUP_PATH_MAX];
+    char *origin;
+
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+
+    if (rtf_kernel_read_line(this->kernel, path, "0::", line,
+            sizeof(line)) != 0)
+        return NULL;
+
+    origin = malloc(strlen(this->cgroup) + strlen(line) + 1);
+
+    if (origin == NULL)
+        return NULL;
+
+    strcpy(origin, this->cgroup);
+
+    if (strcmp(line, "/") != 0)
+        strcat(origin, line);
+
+    return origin;
+}
+
+/**
+ * @internal
+ *
+ * Returns 1 if a thread of the process, other than @p tid, has a real-time
+ * policy, that is it is attached to another plugin, 0 if none, -1 if the
+ * threads cannot be listed.
+ *
+ * @endinternal
+ */
+static int gedf_foreign_threads(struct rtf_plugin *this, pid_t tgid,
+    pid_t tid)
+{
+    pid_t *tids;
+    int policy;
+    int res = 0;
+    int n;
+
+    if ((n = rtf_kernel_get_threads(this->kernel, tgid, &tids)) < 0)
+        return -1;
+
+    for (int i = 0; i < n && res == 0; i++)
+    {
+        if (tids[i] == tid)
+            continue;
+
+        policy = rtf_kernel_get_policy(this->kernel, tids[i]);
+        res = policy == SCHED_FIFO || policy == SCHED_RR ||
+              policy == SCHED_DEADLINE;
+    }
+
+    free(tids);
+
+    return res;
+}
+
+/**
+ * @internal
+ *
+ * Moves the process of the task in the cgroup of the cluster, the first time
+ * one of its threads is attached, and records the cgroup it comes from.
+ * Threads can be moved only together with their process between cgroups of
+ * different domains, so the threads of a process can be attached only to one
+ * cluster, and not while another thread of the process is attached to another
+ * plugin, as it would be moved in the cluster as well.
+ *
+ * @endinternal
+ */
+static int gedf_enter(struct rtf_plugin *this, struct rtf_task *t)
+{
+    int c = gedf_cluster(this);
+    struct gedf_proc *p;
+    pid_t tgid;
+
+    if (!gedf_partitioned(this) || hmap_search(&attached, t->id) != NULL)
+        return 0;
+
+    if ((tgid = gedf_tgid(this, t->tid)) < 0)
+        return -1;
+
+    p = hmap_search(&procs, tgid);
+
+    if (p != NULL && p->cluster != c)
+        return -1;
+
+    if (p == NULL)
+    {
+        if (gedf_foreign_threads(this, tgid, t->tid) != 0)
+            return -1;
+
+        if ((p = calloc(1, sizeof(struct gedf_proc))) == NULL)
+            return -1;
+
+        p->origin = gedf_origin(this, tgid);
+
+        if (p->origin == NULL || gedf_move(this, cg_dir[c], tgid) != 0)
+        {
+            free(p->origin);
+            free(p);
+            return -1;
+        }
+
+        p->tgid = tgid;
+        p->cluster = c;
+        p->next = cg_procs[c];
+
+        if (p->next != NULL)
+            p->next->prev = p;
+
+        cg_procs[c] = p;
+        hmap_link(&procs, &(p->entry), tgid, p);
+    }
+
+    p->threads++;
+    hmap_add(&attached, t->id, p);
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Moves the process back to the cgroup it came from, or to the root cgroup if
+ * that one has been removed in the meantime, and forgets it.
+ *
+ * @endinternal
+ */
+static int gedf_restore(struct rtf_plugin *this, struct gedf_proc *p)
+{
+    int res;
+
+    hmap_unlink(&procs, p->tgid, p);
+
+    if (p->prev != NULL)
+        p->prev->next = p->next;
+    else
+        cg_procs[p->cluster] = p->next;
+
+    if (p->next != NULL)
+        p->next->prev = p->prev;
+
+    res = gedf_move(this, p->origin, p->tgid);
+
+    if (res != 0)
+        res = gedf_move(this, this->cgroup, p->tgid);
+
+    free(p->origin);
+    free(p);
+
+    return res;
+}
+
+// moves the process back, with its last thread detached
+static int gedf_leave(struct rtf_plugin *this, struct rtf_task *t)
+{
+    struct gedf_proc *p = hmap_remove(&attached, t->id, NULL);
+
+    if (p == NULL || --p->threads > 0)
+        return 0;
+
+    return gedf_restore(this, p);
+}
+
+// -----------------------------------------------------------------------------
+// SKELETON PLUGIN METHODS
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Used by plugin to initializes itself
+ */
+int rtf_plg_task_init(struct rtf_plugin *this)
+{
+    int c = gedf_cluster(this);
+
+    hmap_init(&procs);
+    hmap_init(&attached);
+    dens_sum[c] = 0;
+    dens_max[c] = 0;
+    cg_procs[c] = NULL;
+
+    free(cg_dir[c]);
+    cg_dir[c] = malloc(strlen(this->cgroup) + strlen(CGROUP_PREFIX) +
+                       strlen(this->name) + 1);
+
+    if (cg_dir[c] == NULL)
+        return RTF_ERROR;
+
+    strcpy(cg_dir[c], this->cgroup);
+    strcat(cg_dir[c], CGROUP_PREFIX);
+    strcat(cg_dir[c], this->name);
+
+    if (gedf_partition(this) != 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to perform a new task admission test
+ */
+int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    double free_density = gedf_free_density(this);
+    int test_res;
+
+    // task does not have required params
+    if (rtf_task_get_ignore_admission(t))
+        return RTF_NO;
+    if (rtf_task_get_period(t) == 0)
+        return RTF_NO;
+    if (rtf_task_get_util(t) == -1)
+        return RTF_NO;
+
+    if (rtf_task_get_util(t) > free_density)
+        test_res = RTF_NO;
+    // task does not require a desired higher runtime or it is available
+    else if (rtf_task_get_des_util(t) == -1 ||
+             rtf_task_get_des_util(t) <= free_density)
+        test_res = RTF_OK;
+    else
+        test_res = RTF_PARTIAL;
+
+    // if not preferred plugin support is partial
+    if (has_another_preference(this, t) && test_res == RTF_OK)
+        test_res = RTF_PARTIAL;
+
+    return test_res;
+}
+
+/**
+ * @brief Used by plugin to perform a new admission test when task modifies
+ * parameters
+ */
+int rtf_plg_task_change(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    int c = gedf_cluster(this);
+    double sum = dens_sum[c];
+    double max = dens_max[c];
+    int test_res;
+
+    // simulate test without task density in
+    if (t->pluginid == this->id)
+    {
+        dens_sum[c] -= t->acceptedu;
+
+        if (t->acceptedu >= max)
+            dens_max[c] = gedf_max_density(this, t);
+    }
+
+    test_res = rtf_plg_task_accept(this, ts, t);
+
+    // restore density
+    dens_sum[c] = sum;
+    dens_max[c] = max;
+
+    return test_res;
+}
+
+/**
+ * @brief Used by plugin to set the task as accepted
+ */
+void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    int c = gedf_cluster(this);
+    uint64_t free_runtime;
+
+    free_runtime = gedf_free_density(this) * rtf_task_get_min_declared(t);
+    t->pluginid = this->id;
+    t->cpu = c;
+
+    // the desired runtime is granted as far as the cluster allows
+    if (rtf_task_get_des_util(t) == -1 ||
+        free_runtime <= rtf_task_get_runtime(t))
+        t->acceptedt = rtf_task_get_runtime(t);
+    else if (free_runtime < rtf_task_get_des_runtime(t))
+        t->acceptedt = free_runtime;
+    else
+        t->acceptedt = rtf_task_get_des_runtime(t);
+
+    t->acceptedu = t->acceptedt / (float) rtf_task_get_min_declared(t);
+    dens_sum[c] += t->acceptedu;
+
+    if (t->acceptedu > dens_max[c])
+        dens_max[c] = t->acceptedu;
+
+    gedf_util_add(this, -t->acceptedu);
+    this->task_count_percpu[c]++;
+    rtf_taskset_add_top(&this->tasks[c], t);
+}
+
+/**
+ * @brief Used by plugin to set rt scheduler for a task
+ */
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+    cpu_set_t set;
+
+    // the kernel migrates the task among all the CPUs of the cluster
+    CPU_ZERO(&set);
+
+    for (int i = 0; i < this->cputot; i++)
+        CPU_SET(this->cpulist[i], &set);
+
+    if (gedf_enter(this, t) < 0)
+        return RTF_ERROR;
+
+    if (rtf_kernel_set_affinity_set(this->kernel, t->tid, &set) < 0)
+        return RTF_ERROR;
+
+    runtime = rtf_task_get_accepted_runtime(t);
+    deadline = rtf_task_get_deadline(t) != 0 ? rtf_task_get_deadline(t)
+                                             : rtf_task_get_period(t);
+    period = rtf_task_get_period(t);
+
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_DEADLINE;
+    attr.runtime = MICRO_TO_NANO(runtime);
+    attr.deadline = MICRO_TO_NANO(deadline);
+    attr.period = MICRO_TO_NANO(period);
+
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to reset scheduler (other) for a task
+ */
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
+{
+    struct rtf_kernel_attr attr;
+
+    // a SCHED_DEADLINE task cannot leave its root domain
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
+
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
+        return RTF_ERROR;
+
+    if (gedf_leave(this, t) < 0)
+        return RTF_ERROR;
+
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
+        return RTF_ERROR;
+
+    return RTF_OK;
+}
+
+/**
+ * @brief Used by plugin to perform a release of previous accepted task
+ */
+int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
+    struct rtf_task *t)
+{
+    int c = gedf_cluster(this);
+
+    gedf_util_add(this, t->acceptedu);
+    this->task_count_percpu[c]--;
+    rtf_taskset_remove_by_rsvid(&this->tasks[c], t->id);
+    t->pluginid = -1;
+
+    // rounding errors are dropped as soon as the cluster is empty
+    dens_sum[c] -= t->acceptedu;
+
+    if (rtf_taskset_get_size(&this->tasks[c]) == 0)
+        dens_sum[c] = 0;
+
+    if (t->acceptedu >= dens_max[c])
+        dens_max[c] = gedf_max_density(this, NULL);
+
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
+        SCHED_DEADLINE) // means no attached flow of ex.
+        return gedf_leave(this, t) < 0 ? RTF_ERROR : RTF_OK;
+
+    return rtf_plg_task_detach(this, t);
+}
+
+/**
+ * @brief Used by plugin to undo its changes to the system, when the daemon
+ * stops
+ *
+ * The processes still in the cgroup of the cluster are moved back, which is
+ * possible only after their SCHED_DEADLINE threads leave the policy, then
+ * the partition is turned back into a member of its parent and removed.
+ */
+void rtf_plg_task_destroy(struct rtf_plugin *this)
+{
+    int c = gedf_cluster(this);
+    struct rtf_kernel_attr attr;
+    pid_t *tids;
+    int n;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
+
+    while (cg_procs[c] != NULL)
+    {
+        n = rtf_kernel_get_threads(this->kernel, cg_procs[c]->tgid, &tids);
+
+        for (int i = 0; i < n; i++)
+            if (rtf_kernel_get_policy(this->kernel, tids[i]) ==
+                SCHED_DEADLINE)
+                rtf_kernel_set_attr(this->kernel, tids[i], &attr);
+
+        if (n >= 0)
+            free(tids);
+
+        gedf_restore(this, cg_procs[c]);
+    }
+
+    if (gedf_partitioned(this))
+    {
+        gedf_write(this, cg_dir[c], "/cpuset.cpus.partition", "member");
+        rtf_kernel_remove_dir(this->kernel, cg_dir[c]);
+    }
+
+    free(cg_dir[c]);
+    cg_dir[c] = NULL;
+}
@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 //#include <stdio.h>
+#include "retif_kernel.h"
+#include "retif_rta.h"
 #include "retif_taskset.h"
 #include "retif_utils.h"
 #include <limits.h>
@@ -16,96 +18,353 @@
     INT_MAX // as defined in /proc/sys/kernel/sched_rt_period_us
 #define PERIOD_MIN_US 1
 
-#define MAX_CPU 32
+#define MAX_CPU CPU_SETSIZE
 #define MAX_PRIO 100
 
+// placement found by the admission test of a task
+struct rm_placement
+{
+    int plugin;
+    rtf_id_t id;
+    unsigned long generation; // of the tasks it was found with
+    int cpu;
+    int exact;
+};
+
 static unsigned int dist_prio[MAX_CPU] = {0};
+static double utilization[MAX_CPU]; // sum of runtime / period of the tasks
+static double hyperbolic[MAX_CPU]; // product of (u + 1) of the tasks
+static unsigned int constrained[MAX_CPU]; // tasks with deadline < period
+static uint8_t rta_valid[MAX_CPU]; // cached response times are up to date
+static uint8_t chain[MAX_CPU]; // the periods of the tasks divide each other
+static uint8_t merged[MAX_CPU]; // some distinct periods share a priority
+
+static struct rtf_rta rta; // buffer of the response time analysis
+
+static struct rm_placement placed = {.plugin = -1};
+static unsigned long generation; // incremented whenever the tasks change
 
 //------------------------------------------------------------------------------
-// HYPERBOLIC BOUND: perform the sched. analysis under fp
+// SCHEDULABILITY ANALYSIS: perform the sched. analysis under fp
 //------------------------------------------------------------------------------
 
+static double rm_util(struct rtf_task *t)
+{
+    return t->params.runtime / (double) t->params.period;
+}
+
+static void bounds_add(int cpu, struct rtf_task *t)
+{
+    utilization[cpu] += rm_util(t);
+    hyperbolic[cpu] *= rm_util(t) + 1;
+
+    if (rtf_task_get_min_declared(t) < rtf_task_get_period(t))
+        constrained[cpu]++;
+}
+
 /**
- * @brief Hyperbolic bound analysis for the taskset
+ * @brief Recomputes the utilization, the product of (u + 1) used by the
+ * hyperbolic bound, the number of constrained deadline tasks and of distinct
+ * periods of a CPU and whether their periods form a harmonic chain
  */
-unsigned int hyperbolic_bound(struct rtf_taskset *ts)
+static void bounds_update(struct rtf_plugin *this, int cpu)
 {
-    float res;
     iterator_t iterator;
     struct rtf_task *t;
+    uint64_t prec_period = 0;
 
-    res = 1;
-    iterator = rtf_taskset_iterator_init(ts);
+    utilization[cpu] = 0;
+    hyperbolic[cpu] = 1;
+    constrained[cpu] = 0;
+    dist_prio[cpu] = 0;
+    chain[cpu] = 1;
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
 
+    // sorted by decreasing period, each one must divide the previous one
     for (; iterator != NULL; iterator = iterator_get_next(iterator))
     {
         t = rtf_taskset_iterator_get_elem(iterator);
+        bounds_add(cpu, t);
 
-        if (t->params.period == 0 || t->params.runtime == 0)
-            continue;
+        if (rtf_task_get_period(t) != prec_period)
+            dist_prio[cpu]++;
+
+        if (prec_period != 0 && prec_period % rtf_task_get_period(t) != 0)
+            chain[cpu] = 0;
 
-        res *= (t->params.runtime / (float) t->params.period) + 1;
+        prec_period = rtf_task_get_period(t);
     }
+}
+
+/**
+ * @internal
+ *
+ * Checks if the tasks of the CPU with @p t added form a harmonic chain. As
+ * they already do, it is enough that the period of @p t is a multiple of the
+ * next shorter period and divides the next longer one.
+ *
+ * @endinternal
+ */
+static int harmonic_with(struct rtf_plugin *this, int cpu, struct rtf_task *t)
+{
+    iterator_t iterator;
+    struct rtf_task *t_rm;
+    uint64_t period = rtf_task_get_period(t);
+    uint64_t above = 0;
 
-    if (res > 2)
+    if (!chain[cpu])
         return 0;
 
-    return 1;
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
+
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
+    {
+        t_rm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_rm->id == t->id)
+            continue;
+
+        if (rtf_task_get_period(t_rm) >= period)
+        {
+            above = rtf_task_get_period(t_rm);
+            continue;
+        }
+
+        return (above == 0 || above % period == 0) &&
+               period % rtf_task_get_period(t_rm) == 0;
+    }
+
+    return above == 0 || above % period == 0;
 }
 
-// -----------------------------------------------------------------------------
-// UTILITY INTERNAL METHODS
-// -----------------------------------------------------------------------------
+static int task_on_cpu(struct rtf_plugin *this, struct rtf_task *t, int cpu)
+{
+    return t->pluginid == this->id && (int) t->cpu == cpu;
+}
+
+static uint64_t rm_key(struct rtf_task *t)
+{
+    return rtf_task_get_period(t);
+}
 
 /**
- * @brief Given min/max plugin prio, normalize @p prio in that window
+ * @internal
+ *
+ * Response time analysis of the tasks of the CPU with @p t added, the
+ * priority key being the period. The cached response times are reused only
+ * if they are up to date and @p t is not already on the CPU with other
+ * parameters.
+ *
+ * @endinternal
  */
-uint32_t prio_remap(uint32_t max_prio_s, uint32_t min_prio_s, uint32_t prio,
-    unsigned cpu)
+static int rta_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    int store)
 {
-    float slope;
+    int valid = rta_valid[cpu] && !task_on_cpu(this, t, cpu);
+    int res;
 
-    slope = (max_prio_s - min_prio_s + 1) / (float) (dist_prio[cpu] - 1);
+    res = rtf_rta_test(&rta, &this->tasks[cpu], t, rm_key, valid, store);
 
-    return min_prio_s + slope * prio;
+    if (store)
+        rta_valid[cpu] = 1;
+
+    return res;
 }
 
 /**
- * @brief Given pointer to plugin struct @p this, retrieve least loaded cpu
+ * @internal
+ *
+ * The analysis and the bounds give each distinct period its own priority, so
+ * a task is admitted on a CPU only if its period still finds a free priority
+ * in the range of the plugin. The tasks are scanned only when the CPU already
+ * uses all of them, and the old copy of @p t is left out.
+ *
+ * @endinternal
  */
-static uint32_t least_loaded_cpu(struct rtf_plugin *this)
+static int rm_fits_levels(struct rtf_plugin *this, int cpu, struct rtf_task *t)
 {
-    int cpu_num;
-    float free_rm_max;
-    int free_rm_max_cpu;
+    iterator_t iterator;
+    struct rtf_task *t_rm;
+    uint64_t period = rtf_task_get_period(t);
+    uint64_t prec_period = 0;
+    uint32_t levels = this->prio_max - this->prio_min + 1;
+    uint32_t distinct = 1;
 
-    free_rm_max_cpu = this->cpulist[0];
-    free_rm_max = this->util_free_percpu[free_rm_max_cpu];
+    if (dist_prio[cpu] < levels)
+        return 1;
+
+    iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
 
-    for (int i = 1; i < this->cputot; i++)
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
     {
-        cpu_num = this->cpulist[i];
+        t_rm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (t_rm->id == t->id)
+            continue;
 
-        if (this->util_free_percpu[cpu_num] > free_rm_max)
-            free_rm_max_cpu = cpu_num;
+        if (rtf_task_get_period(t_rm) != prec_period &&
+            rtf_task_get_period(t_rm) != period)
+            distinct++;
+
+        prec_period = rtf_task_get_period(t_rm);
     }
 
-    return free_rm_max_cpu;
+    return distinct <= levels;
 }
 
-static float eval_util_missing(struct rtf_plugin *this, float task_util)
+/**
+ * @internal
+ *
+ * A task whose period finds no free priority is rejected at once, as is a
+ * utilization above 1. The Liu & Layland and the hyperbolic bounds hold only
+ * for implicit deadlines: they are tried next, being O(1), then the bound of
+ * harmonic periods, which is 1. The response time analysis is run only if
+ * they fail, or if the task is already on the CPU with other parameters,
+ * which the bounds do not account for. @p exact is set if the result comes
+ * from the analysis.
+ *
+ * @endinternal
+ */
+static int rm_test(struct rtf_plugin *this, int cpu, struct rtf_task *t,
+    int *exact)
 {
-    int cpu_min;
+    double util = utilization[cpu] + rm_util(t);
+    int n = this->task_count_percpu[cpu] + 1;
+
+    *exact = 1;
+
+    if (!rm_fits_levels(this, cpu, t))
+        return RTF_NO;
+
+    if (task_on_cpu(this, t, cpu))
+        return rta_test(this, cpu, t, 0);
+
+    *exact = 0;
+
+    if (util > 1)
+        return RTF_NO;
+
+    if (constrained[cpu] == 0 &&
+        rtf_task_get_min_declared(t) == rtf_task_get_period(t))
+    {
+        if (util <= n * (exp2(1.0 / n) - 1) ||
+            hyperbolic[cpu] * (rm_util(t) + 1) <= 2 ||
+            harmonic_with(this, cpu, t))
+            return RTF_OK;
+    }
+
+    *exact = 1;
+
+    return rta_test(this, cpu, t, 0);
+}
+
+/**
+ * @internal
+ *
+ * Returns the most loaded CPU that the task fits keeping its periods a
+ * harmonic chain, -1 if none. Empty CPUs are chosen last, so that each chain
+ * is filled before starting a new one.
+ *
+ * @endinternal
+ */
+static int rm_place_harmonic(struct rtf_plugin *this, struct rtf_task *t)
+{
+    double util;
+    double best_util = -1;
+    int best = -1;
+    int cpu;
+
+    if (rtf_task_get_min_declared(t) < rtf_task_get_period(t))
+        return -1;
 
     for (int i = 0; i < this->cputot; i++)
-        if (task_util <= this->util_free_percpu[this->cpulist[i]])
-            return 0;
+    {
+        cpu = this->cpulist[i];
+        util = utilization[cpu] + rm_util(t);
+
+        if (constrained[cpu] != 0 || task_on_cpu(this, t, cpu) || util > 1 ||
+            utilization[cpu] <= best_util || !harmonic_with(this, cpu, t) ||
+            !rm_fits_levels(this, cpu, t))
+            continue;
+
+        best_util = utilization[cpu];
+        best = cpu;
+    }
+
+    return best;
+}
+
+/**
+ * @internal
+ *
+ * With the harmonic placement, the CPUs where the task keeps the periods a
+ * harmonic chain are tried first. Then the CPU chosen by the placement
+ * heuristic is tried, then the others in cpulist order, so that a task is
+ * rejected only if no CPU can take it.
+ *
+ * @endinternal
+ */
+static int rm_place(struct rtf_plugin *this, struct rtf_task *t, int *exact)
+{
+    float task_util = rtf_task_get_util(t);
+    int cpu;
+
+    if (this->placement == PLACEMENT_HARMONIC &&
+        (cpu = rm_place_harmonic(this, t)) >= 0)
+    {
+        *exact = 0;
+        return cpu;
+    }
+
+    cpu = rtf_plugin_place_cpu(this, task_util, rtf_task_get_numa_node(t));
+
+    if (rm_test(this, cpu, t, exact) == RTF_OK)
+        return cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        if (this->cpulist[i] == cpu)
+            continue;
 
-    cpu_min = least_loaded_cpu(this);
+        if (rm_test(this, this->cpulist[i], t, exact) == RTF_OK)
+            return this->cpulist[i];
+    }
 
-    return task_util - this->util_free_percpu[cpu_min];
+    return -1;
 }
 
+/**
+ * @internal
+ *
+ * The daemon schedules a task right after its admission test succeeds, so
+ * the placement found by the test is kept and returned again for the same
+ * task, as long as no task has been added or removed since.
+ *
+ * @endinternal
+ */
+static int rm_place_cached(struct rtf_plugin *this, struct rtf_task *t,
+    int *exact)
+{
+    if (placed.plugin == this->id && placed.id == t->id &&
+        placed.generation == generation)
+    {
+        *exact = placed.exact;
+        return placed.cpu;
+    }
+
+    placed.cpu = rm_place(this, t, exact);
+    placed.plugin = this->id;
+    placed.id = t->id;
+    placed.generation = generation;
+    placed.exact = *exact;
+
+    return placed.cpu;
+}
+
+// -----------------------------------------------------------------------------
+// UTILITY INTERNAL METHODS
+// -----------------------------------------------------------------------------
+
 static uint8_t has_another_preference(struct rtf_plugin *this,
     struct rtf_task *t)
 {
@@ -117,16 +376,6 @@ static uint8_t has_another_preference(struct rtf_plugin *this,
     return 0;
 }
 
-static int utilization_test(struct rtf_plugin *this, float task_util)
-{
-    float missing_util = eval_util_missing(this, task_util);
-
-    if (missing_util == 0)
-        return RTF_OK;
-    else
-        return RTF_NO;
-}
-
 // static int count_unique_periods(struct rtf_plugin* this, struct rtf_taskset*
 // ts, unsigned free_cpu)
 // {
@@ -155,57 +404,126 @@ static int utilization_test(struct rtf_plugin *this, float task_util)
 //     return dist_prio;
 // }
 
-static void assign_priorities(struct rtf_plugin *this, unsigned int cpu)
+/**
+ * @internal
+ *
+ * Sets the priority of a task of the CPU. The thread, if already attached,
+ * is updated at once, unless it is @p t, which is being scheduled and is
+ * attached afterwards.
+ *
+ * @endinternal
+ */
+static void set_priority(struct rtf_plugin *this, struct rtf_task *t_rm,
+    uint32_t priority, struct rtf_task *t)
 {
-    unsigned int curr_prio; // real prio
-    unsigned int prec_period; // user data
-    unsigned int dist_prio_idx;
+    struct rtf_kernel_attr attr;
 
+    if (t_rm->schedprio == priority)
+        return;
+
+    rtf_task_set_real_priority(t_rm, priority);
+
+    if (t_rm == t || t_rm->tid == 0 ||
+        rtf_kernel_get_policy(this->kernel, t_rm->tid) != SCHED_FIFO)
+        return;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_FIFO;
+    attr.priority = priority;
+    rtf_kernel_set_attr(this->kernel, t_rm->tid, &attr);
+}
+
+/**
+ * @internal
+ *
+ * Spreads the distinct periods of the CPU evenly over the priorities of the
+ * plugin, with the same gap around each one, so that the periods added later
+ * are likely to find a free priority between their neighbours. The admission
+ * test keeps the distinct periods within the priorities; only the tasks that
+ * skip it can exceed them, and then adjacent periods share a priority,
+ * keeping the order.
+ *
+ * @endinternal
+ */
+static void spread_priorities(struct rtf_plugin *this, unsigned int cpu,
+    struct rtf_task *t)
+{
     iterator_t iterator;
     struct rtf_task *t_rm;
-
-    curr_prio = this->prio_min - 1;
-    prec_period = -1;
-    dist_prio_idx = 0;
+    uint64_t prec_period = 0;
+    uint32_t levels = this->prio_max - this->prio_min + 1;
+    uint32_t distinct = dist_prio[cpu];
+    uint32_t idx = 0;
+    uint32_t priority;
 
     iterator = rtf_taskset_iterator_init(&this->tasks[cpu]);
 
-    if (dist_prio[cpu] > (this->prio_max - this->prio_min) + 1)
+    // sorted by decreasing period, that is by increasing priority
+    for (; iterator != NULL; iterator = iterator_get_next(iterator))
     {
-        for (; iterator != NULL; iterator = iterator_get_next(iterator))
-        {
-            t_rm = rtf_taskset_iterator_get_elem(iterator);
-
-            if (prec_period == rtf_task_get_period(t_rm))
-            {
-                rtf_task_set_real_priority(t_rm, curr_prio);
-            }
-            else
-            {
-                curr_prio = prio_remap(this->prio_max, this->prio_min,
-                    dist_prio_idx++, cpu);
-                rtf_task_set_real_priority(t_rm, curr_prio);
-                prec_period = rtf_task_get_period(t_rm);
-            }
-        }
+        t_rm = rtf_taskset_iterator_get_elem(iterator);
+
+        if (prec_period != 0 && rtf_task_get_period(t_rm) != prec_period)
+            idx++;
+
+        prec_period = rtf_task_get_period(t_rm);
+
+        if (distinct <= levels)
+            priority = (2 * idx + 1) * levels / (2 * distinct);
+        else
+            priority = idx * levels / distinct;
+
+        set_priority(this, t_rm, this->prio_min + priority, t);
     }
-    else
+
+    merged[cpu] = distinct > levels;
+}
+
+/**
+ * @internal
+ *
+ * Gives a priority to @p t, just inserted in the taskset of the CPU at
+ * @p node. A task with the period of another one shares its priority;
+ * otherwise the task takes the middle of the gap between the priorities of
+ * the next longer and the next shorter periods, so that no other task is
+ * touched. Only when the gap is empty are all the priorities of the CPU
+ * spread again.
+ *
+ * @endinternal
+ */
+static void insert_priority(struct rtf_plugin *this, unsigned int cpu,
+    struct node_ptr *node, struct rtf_task *t)
+{
+    struct rtf_task *next = NULL;
+    struct rtf_task *prev = NULL;
+    int64_t lo = (int64_t) this->prio_min - 1;
+    int64_t hi = (int64_t) this->prio_max + 1;
+
+    if (node->next != NULL)
+        next = (struct rtf_task *) node->next->elem;
+
+    // the tasks with the same period come after the new one
+    if (next != NULL && rtf_task_get_period(next) == rtf_task_get_period(t))
     {
-        for (; iterator != NULL; iterator = iterator_get_next(iterator))
-        {
-            t_rm = rtf_taskset_iterator_get_elem(iterator);
-
-            if (prec_period == rtf_task_get_period(t_rm))
-            {
-                rtf_task_set_real_priority(t_rm, curr_prio);
-            }
-            else
-            {
-                rtf_task_set_real_priority(t_rm, ++curr_prio);
-                prec_period = rtf_task_get_period(t_rm);
-            }
-        }
+        rtf_task_set_real_priority(t, rtf_task_get_real_priority(next));
+        return;
     }
+
+    if (node->prev != NULL)
+        prev = (struct rtf_task *) node->prev->elem;
+
+    dist_prio[cpu]++;
+
+    if (prev != NULL)
+        lo = rtf_task_get_real_priority(prev);
+
+    if (next != NULL)
+        hi = rtf_task_get_real_priority(next);
+
+    if (hi - lo > 1)
+        rtf_task_set_real_priority(t, (lo + hi) / 2);
+    else
+        spread_priorities(this, cpu, t);
 }
 
 // -----------------------------------------------------------------------------
@@ -217,6 +535,20 @@ static void assign_priorities(struct rtf_plugin *this, unsigned int cpu)
  */
 int rtf_plg_task_init(struct rtf_plugin *this)
 {
+    int cpu;
+
+    for (int i = 0; i < this->cputot; i++)
+    {
+        cpu = this->cpulist[i];
+        dist_prio[cpu] = 0;
+        utilization[cpu] = 0;
+        hyperbolic[cpu] = 1;
+        constrained[cpu] = 0;
+        rta_valid[cpu] = 0;
+        chain[cpu] = 1;
+        merged[cpu] = 0;
+    }
+
     return RTF_OK;
 }
 
@@ -226,10 +558,8 @@ int rtf_plg_task_init(struct rtf_plugin *this)
 int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    float task_util;
     int test_res;
-
-    task_util = rtf_task_get_util(t);
+    int exact;
 
     // if task did not specified period will be rejected
     if (rtf_task_get_period(t) == 0)
@@ -237,7 +567,7 @@ int rtf_plg_task_accept(struct rtf_plugin *this, struct rtf_taskset *ts,
 
     if (rtf_task_get_ignore_admission(t))
         test_res = RTF_OK;
-    else if (utilization_test(this, task_util) == RTF_OK)
+    else if (rm_place_cached(this, t, &exact) >= 0)
         test_res = RTF_OK;
     else
         test_res = RTF_NO;
@@ -260,13 +590,13 @@ int rtf_plg_task_change(struct rtf_plugin *this, struct rtf_taskset *ts,
 
     // simulate test without task utilization in
     if (t->pluginid == this->id && t->acceptedu != 0)
-        this->util_free_percpu[t->cpu] += t->acceptedu;
+        rtf_plugin_util_add(this, t->cpu, t->acceptedu);
 
     test_res = rtf_plg_task_accept(this, ts, t);
 
     // restore utilization
     if (t->pluginid == this->id && t->acceptedu != 0)
-        this->util_free_percpu[t->cpu] -= t->acceptedu;
+        rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
 
     return test_res;
 }
@@ -278,59 +608,55 @@ void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
     float task_util;
-    unsigned int cpu;
+    int exact;
+    int cpu;
 
-    cpu = least_loaded_cpu(this);
     task_util = rtf_task_get_util(t);
 
-    rtf_task_set_cpu(t, cpu);
-    t->pluginid = this->id;
-
-    struct node_ptr *inserted = rtf_taskset_add_sorted_pr(&this->tasks[cpu], t);
-
-    if (inserted->next != NULL)
+    // tasks that skip the admission test are placed anyway
+    if ((cpu = rm_place_cached(this, t, &exact)) < 0)
     {
-        struct rtf_task *next = (struct rtf_task *) inserted->next->elem;
-
-        if (rtf_task_get_period(next) == t->params.period)
-        {
-            rtf_task_set_real_priority(t, rtf_task_get_real_priority(next));
-        }
-        else
-        {
-            dist_prio[cpu]++;
-            assign_priorities(this, cpu);
-        }
+        cpu = rtf_plugin_place_cpu(this, task_util, rtf_task_get_numa_node(t));
+        exact = 1;
     }
+
+    chain[cpu] = harmonic_with(this, cpu, t);
+
+    // the response times are cached only when they are computed anyway
+    if (exact)
+        rta_test(this, cpu, t, 1);
     else
-    {
-        dist_prio[cpu]++;
-        assign_priorities(this, cpu);
-    }
+        rta_valid[cpu] = 0;
+
+    rtf_task_set_cpu(t, cpu);
+    t->pluginid = this->id;
+
+    insert_priority(this, cpu, rtf_taskset_add_sorted_pr(&this->tasks[cpu], t),
+        t);
 
     t->acceptedt = rtf_task_get_runtime(t);
     t->acceptedu = task_util != -1 ? task_util : 0;
-    this->util_free_percpu[t->cpu] -= t->acceptedu;
+    rtf_plugin_util_add(this, t->cpu, -t->acceptedu);
     this->task_count_percpu[t->cpu]++;
+    bounds_add(cpu, t);
+    generation++;
 }
 
 /**
  * @brief Used by plugin to set rt scheduler for a task
  */
-int rtf_plg_task_attach(struct rtf_task *t)
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
-
-    CPU_ZERO(&my_set);
-    CPU_SET(t->cpu, &my_set);
+    struct rtf_kernel_attr attr;
 
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, t->cpu) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = t->schedprio;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_FIFO;
+    attr.priority = t->schedprio;
 
-    if (sched_setscheduler(t->tid, SCHED_FIFO, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -339,22 +665,17 @@ int rtf_plg_task_attach(struct rtf_task *t)
 /**
  * @brief Used by plugin to reset scheduler (other) for a task
  */
-int rtf_plg_task_detach(struct rtf_task *t)
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
+    struct rtf_kernel_attr attr;
 
-    CPU_ZERO(&my_set);
-
-    for (int i = 0; i < get_nprocs2(); i++)
-        CPU_SET(i, &my_set);
-
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = 0;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
 
-    if (sched_setscheduler(t->tid, SCHED_OTHER, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -366,32 +687,28 @@ int rtf_plg_task_detach(struct rtf_task *t)
 int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    iterator_t iterator;
-    struct rtf_task *t_rm;
-
-    iterator = rtf_taskset_iterator_init(&this->tasks[t->cpu]);
-
-    for (; iterator != NULL; iterator = iterator_get_next(iterator))
-    {
-        t_rm = rtf_taskset_iterator_get_elem(iterator);
-        if (t_rm->params.period == t->params.period && t_rm->id != t->id)
-        {
-            dist_prio[t->cpu]--;
-            break;
-        }
-    }
-
     if (t->acceptedu != 0)
-        this->util_free_percpu[t->cpu] += t->acceptedu;
+        rtf_plugin_util_add(this, t->cpu, t->acceptedu);
 
     rtf_taskset_remove_by_rsvid(&this->tasks[t->cpu], t->id);
 
+    // the parameters of the task may have changed since it was accepted, and
+    // the response times of the others can only decrease: all of them are
+    // recomputed from the remaining tasks, which keep their priorities
+    bounds_update(this, t->cpu);
+    rta_valid[t->cpu] = 0;
+    generation++;
+
+    if (merged[t->cpu] &&
+        dist_prio[t->cpu] <= this->prio_max - this->prio_min + 1)
+        spread_priorities(this, t->cpu, NULL);
+
     t->pluginid = -1;
     this->task_count_percpu[t->cpu]--;
 
-    if (sched_getscheduler(t->tid) !=
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
         SCHED_FIFO) // means no attached flow of ex.
         return RTF_OK;
 
-    return rtf_plg_task_detach(t);
+    return rtf_plg_task_detach(this, t);
 }
@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 
+#include "retif_kernel.h"
 #include "retif_taskset.h"
 #include "retif_types.h"
 #include "retif_utils.h"
@@ -12,7 +13,7 @@
 // UTILITY INTERNAL METHODS
 // -----------------------------------------------------------------------------
 
-#define MAX_CPU 32
+#define MAX_CPU CPU_SETSIZE
 #define MAX_PRIO 100
 
 #define GET_BIT_VAL(bitval, bitpos) (((0x1 << bitpos) & bitval) >> bitpos)
@@ -98,29 +99,6 @@ uint32_t prio_remap(uint32_t max_prio_s, uint32_t min_prio_s, uint32_t prio)
     return min_prio_s + slope * (prio - min_rr_prio);
 }
 
-/**
- * @brief Given pointer to plugin struct @p this, retrieve least loaded cpu
- */
-uint32_t least_loaded_cpu(struct rtf_plugin *this)
-{
-    int cpu_num;
-    int num_of_rr_min;
-    int num_of_rr_min_cpu;
-
-    num_of_rr_min_cpu = this->cpulist[0];
-    num_of_rr_min = this->task_count_percpu[num_of_rr_min_cpu];
-
-    for (int i = 1; i < this->cputot; i++)
-    {
-        cpu_num = this->cpulist[i];
-
-        if (this->task_count_percpu[cpu_num] < num_of_rr_min)
-            num_of_rr_min_cpu = cpu_num;
-    }
-
-    return num_of_rr_min_cpu;
-}
-
 static void assign_priorities(struct rtf_plugin *this, unsigned int cpu)
 {
     unsigned int curr_prio; // real prio
@@ -216,7 +194,9 @@ int rtf_plg_task_change(struct rtf_plugin *this, struct rtf_taskset *ts,
 void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
     struct rtf_task *t)
 {
-    unsigned int cpu = least_loaded_cpu(this);
+    unsigned int cpu =
+        rtf_plugin_least_loaded_cpu(this, PLUGIN_LOAD_COUNT, 0,
+            rtf_task_get_numa_node(t));
 
     rtf_task_set_cpu(t, cpu);
 
@@ -248,20 +228,18 @@ void rtf_plg_task_schedule(struct rtf_plugin *this, struct rtf_taskset *ts,
 /**
  * @brief Used by plugin to set rt scheduler for a task
  */
-int rtf_plg_task_attach(struct rtf_task *t)
+int rtf_plg_task_attach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
+    struct rtf_kernel_attr attr;
 
-    CPU_ZERO(&my_set);
-    CPU_SET(t->cpu, &my_set);
-
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, t->cpu) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = t->schedprio;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_RR;
+    attr.priority = t->schedprio;
 
-    if (sched_setscheduler(t->tid, SCHED_RR, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -270,22 +248,17 @@ int rtf_plg_task_attach(struct rtf_task *t)
 /**
  * @brief Used by plugin to reset scheduler (other) for a task
  */
-int rtf_plg_task_detach(struct rtf_task *t)
+int rtf_plg_task_detach(struct rtf_plugin *this, struct rtf_task *t)
 {
-    struct sched_param attr;
-    cpu_set_t my_set;
-
-    CPU_ZERO(&my_set);
-
-    for (int i = 0; i < get_nprocs2(); i++)
-        CPU_SET(i, &my_set);
+    struct rtf_kernel_attr attr;
 
-    if (sched_setaffinity(t->tid, sizeof(cpu_set_t), &my_set) < 0)
+    if (rtf_kernel_set_affinity(this->kernel, t->tid, KERNEL_ALL_CPUS) < 0)
         return RTF_ERROR;
 
-    attr.sched_priority = 0;
+    memset(&attr, 0, sizeof(attr));
+    attr.policy = SCHED_OTHER;
 
-    if (sched_setscheduler(t->tid, SCHED_OTHER, &attr) < 0)
+    if (rtf_kernel_set_attr(this->kernel, t->tid, &attr) < 0)
         return RTF_ERROR;
 
     return RTF_OK;
@@ -307,8 +280,9 @@ int rtf_plg_task_release(struct rtf_plugin *this, struct rtf_taskset *ts,
     rtf_taskset_remove_by_rsvid(&this->tasks[t->cpu], t->id);
     t->pluginid = -1;
 
-    if (sched_getscheduler(t->tid) != SCHED_RR) // means no attached flow of ex.
+    if (rtf_kernel_get_policy(this->kernel, t->tid) !=
+        SCHED_RR) // means no attached flow of ex.
         return RTF_OK;
 
-    return rtf_plg_task_detach(t);
+    return rtf_plg_task_detach(this, t);
 }